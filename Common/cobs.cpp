@@ -4,6 +4,8 @@
 
 #include "include/cobs.h"
 
+#include <cstring>
+
 
 void cobsUMP::processSerial(uint8_t serialByte){
     //Process COBS
@@ -40,6 +42,102 @@ uint32_t cobsUMP::readUMP() {
     return outUMP;
 }
 
+size_t cobsUMP::decode(const uint8_t *bytes, size_t numBytes, uint32_t *words, size_t maxWords, size_t &numWords)
+{
+    const uint8_t *in = bytes;
+    const uint8_t *const end = bytes + numBytes;
+    numWords = 0;
+    frameEnded = false;
+
+    while (in != end)
+    {
+        // with the output full, only a delimiter right behind the last word is consumed
+        if ((numWords == maxWords) && (blockLeft || *in))
+            break;
+
+        if (!blockLeft)
+        {
+            const uint8_t code = *in++;
+            if (!code)
+            {
+                // frame delimiter
+                if (wordBytes)
+                    ++truncatedFrames;
+                blockLeft = 0;
+                zeroPending = false;
+                wordBytes = 0;
+                word = 0;
+                frameEnded = true;
+                break;
+            }
+
+            // the zero replaced by the previous code byte
+            if (zeroPending)
+            {
+                word <<= 8;
+                if (++wordBytes == 4)
+                {
+                    words[numWords++] = word;
+                    wordBytes = 0;
+                    word = 0;
+                }
+            }
+            blockLeft = code - 1;
+            zeroPending = (code != 0xFF);
+            continue;
+        }
+
+        // data bytes up to the end of the block, a zero in there is a delimiter of a broken frame
+        size_t run = (size_t(end - in) < blockLeft) ? size_t(end - in) : blockLeft;
+        if (const void *zero = memchr(in, 0, run))
+        {
+            run = static_cast<const uint8_t *>(zero) - in;
+            blockLeft = uint8_t(run);
+            zeroPending = false;
+        }
+        const uint8_t *const runEnd = in + run;
+
+        // complete a started word
+        while (wordBytes && (in != runEnd))
+        {
+            word = (word << 8) | *in++;
+            if (++wordBytes == 4)
+            {
+                words[numWords++] = word;
+                wordBytes = 0;
+                word = 0;
+            }
+        }
+
+        // whole words
+        while ((runEnd - in >= 4) && (numWords < maxWords))
+        {
+            words[numWords++] = (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | in[3];
+            in += 4;
+        }
+
+        // start of the next word, unless the output is full
+        if (numWords < maxWords)
+        {
+            while (in != runEnd)
+            {
+                word = (word << 8) | *in++;
+                ++wordBytes;
+            }
+        }
+
+        blockLeft -= uint8_t(run - (runEnd - in));
+    }
+
+    return size_t(in - bytes);
+}
+
+uint32_t cobsUMP::takeTruncatedFrames()
+{
+    const uint32_t n = truncatedFrames;
+    truncatedFrames = 0;
+    return n;
+}
 
 uint8_t cobsUMP::encode(const void *data, uint8_t length, uint8_t *buffer)
 {
@@ -4,6 +4,7 @@
 
 #ifndef COBS_H
 #define COBS_H
+#include <cstddef>
 #include <cstdint>
 
 class cobsUMP {
@@ -14,12 +15,30 @@ private:
     bool umpAvail = false;
     //void sendBufferUMP(uint8_t* buffer, uint8_t length);
 
+    // bulk decoder state
+    uint8_t blockLeft = 0;     // data bytes left in the current block, 0: next byte is a code byte
+    bool zeroPending = false;  // the current block ends with an implicit zero
+    bool frameEnded = false;
+    uint8_t wordBytes = 0;     // bytes in word
+    uint32_t word = 0;
+    uint32_t truncatedFrames = 0;
+
 public:
 
     void processSerial(uint8_t serialByte);
     bool availableUMP();
     uint32_t readUMP();
 
+    //! decode COBS frames into big endian 32 bit words, frames may be split across calls
+    //! decoding stops after a frame delimiter or when maxWords words are decoded (a delimiter
+    //! right behind the last word still gets consumed), returns the number of bytes consumed,
+    //! numWords the number of words decoded
+    size_t decode(const uint8_t *bytes, size_t numBytes, uint32_t *words, size_t maxWords, size_t &numWords);
+    //! true if the last decode call stopped at a frame delimiter
+    bool endOfFrame() const { return frameEnded; }
+    //! frames that did not end on a word boundary since the last call, their partial word is dropped
+    uint32_t takeTruncatedFrames();
+
     //void sendUMP(uint32_t * ump, uint8_t size);
     static uint8_t encode(const void *data, uint8_t length, uint8_t *buffer);
 
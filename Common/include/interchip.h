@@ -31,6 +31,9 @@
 #define ENCODER 0xB0
 
 #include "pico/stdlib.h"
+#include "hardware/spi.h"
+
+#define PROTOZOA_INTERLINK_SPI spi0
 
 class interchip {
 private:
@@ -3,7 +3,6 @@
 //
 #include "hardware/spi.h"
 
-#define PROTOZOA_INTERLINK_SPI spi0
 #define PROTOZOA_SPI_RX_PIN 4
 #define PROTOZOA_SPI_TX_PIN 7
 #define PROTOZOA_SPI_CLK_PIN 6
@@ -0,0 +1,103 @@
+#ifndef BLOCKPOOL_H
+#define BLOCKPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#else
+#include <mutex>
+#endif
+
+//! Fixed size block allocator
+/***
+ *
+ * numBlocks blocks of blockSize bytes in static storage, allocation and
+ * deallocation are O(1) free list operations. The free list is protected by
+ * a short spin lock section (a hardware spin lock with interrupts disabled
+ * on the RP2040), so blocks can be taken and returned from tasks on both
+ * cores as well as from interrupt handlers.
+ *
+ * The pool is constant initialized (blocks are handed out from the untouched
+ * tail before the free list is used), so it is safe to use from static
+ * initializers in any translation unit.
+ *
+ ***/
+template <size_t blockSize, uint16_t numBlocks>
+class BlockPool
+{
+public:
+  static constexpr size_t size { blockSize };
+
+  //! returns nullptr if all blocks are in use
+  void *allocate()
+  {
+    Lock lock { m_lock };
+
+    Block *b = m_free;
+    if (b)
+      m_free = b->next;
+    else if (m_numTouched < numBlocks)
+      b = &m_blocks[m_numTouched++];
+    else
+    {
+      ++m_numFailed;
+      return nullptr;
+    }
+
+    if (++m_numUsed > m_highWater)
+      m_highWater = m_numUsed;
+    return b->data;
+  }
+
+  void deallocate(void *p)
+  {
+    Lock lock { m_lock };
+
+    Block *b = static_cast<Block*>(p);
+    b->next = m_free;
+    m_free = b;
+    --m_numUsed;
+  }
+
+  bool owns(const void *p) const
+  {
+    return (p >= static_cast<const void*>(&m_blocks[0])) && (p < static_cast<const void*>(&m_blocks[numBlocks]));
+  }
+
+  uint16_t numUsed() const { return m_numUsed; }
+  uint16_t highWater() const { return m_highWater; } //!< most blocks in use at a time
+  uint32_t numFailed() const { return m_numFailed; } //!< allocations failed as the pool was exhausted
+
+private:
+  union Block
+  {
+    Block *next;
+    alignas(std::max_align_t) uint8_t data[blockSize];
+  };
+
+#if PICO_ON_DEVICE
+  struct SpinLock {};
+  struct Lock
+  {
+    explicit Lock(SpinLock&) : irqState(spin_lock_blocking(lock())) {}
+    ~Lock() { spin_unlock(lock(), irqState); }
+    static spin_lock_t *lock() { return spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST); }
+    uint32_t irqState;
+  };
+#else
+  using SpinLock = std::mutex;
+  using Lock = std::lock_guard<std::mutex>;
+#endif
+
+  Block m_blocks[numBlocks] {};
+  Block *m_free { nullptr };
+  uint16_t m_numTouched { 0 };
+  uint16_t m_numUsed { 0 };
+  uint16_t m_highWater { 0 };
+  uint32_t m_numFailed { 0 };
+  SpinLock m_lock;
+};
+
+#endif // BLOCKPOOL_H
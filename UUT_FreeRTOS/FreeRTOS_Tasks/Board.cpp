@@ -0,0 +1,56 @@
+#include "Board.h"
+
+#if PICO_ON_DEVICE
+#include "pico/time.h"
+#include "pico/unique_id.h"
+#else
+#include <chrono>
+#endif
+
+#if PICO_ON_DEVICE
+
+uint32_t board::timeUs()
+{
+    return time_us_32();
+}
+
+uint64_t board::timeUs64()
+{
+    return time_us_64();
+}
+
+std::string_view board::idString()
+{
+    constexpr size_t strLength = 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1;
+    static char idStr[strLength];
+    if (!idStr[0])
+        pico_get_unique_board_id_string(idStr, strLength);
+    return std::string_view(idStr, strLength - 1);
+}
+
+#else
+
+static std::string_view fakeId { "E660000000000000" };
+
+uint64_t board::timeUs64()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t board::timeUs()
+{
+    return uint32_t(timeUs64());
+}
+
+std::string_view board::idString()
+{
+    return fakeId;
+}
+
+void board::setFakeIdString(std::string_view id)
+{
+    fakeId = id;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <string_view>
+
+//! Board services used by the UMP stack
+/***
+ *
+ * UMPProcessing and its helpers reach the hardware through these functions
+ * only. On the RP2040 they map to the pico SDK. Host builds (unit tests,
+ * the UMP replay driver) get a free running microsecond clock and a fake
+ * board id instead, so the stack compiles and runs on Linux.
+ *
+ ***/
+namespace board {
+
+//! free running microseconds, wraps (time_us_32 on the RP2040)
+uint32_t timeUs();
+uint64_t timeUs64();
+
+//! unique board id as hex string, e.g. for the product instance id
+std::string_view idString();
+
+#if !PICO_ON_DEVICE
+//! host builds: replace the fake board id, id has to outlive its use
+void setFakeIdString(std::string_view id);
+#endif
+
+} // namespace board
+
+#endif // BOARD_H
@@ -7,6 +7,7 @@
 #include "hardware/uart.h"
 #include "hardware/pio.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 
 #include "uart_rx.pio.h"
 #include "uart_tx.pio.h"
@@ -14,6 +15,10 @@
 #include "uart_rx.pio.h"
 #include "uart_tx.pio.h"
 
+#include "Board.h"
+#include "JitterReduction.h"
+#include "Pins.h"
+#include "UMPSources.h"
 #include "dump_packet.h"
 
 #include <midi/midi1_byte_stream.h>
@@ -23,32 +28,47 @@
 
 void setupCME(bool);
 
+static TaskHandle_t widiTask = nullptr;
+
+static void uart_rx_irq_handler()
+{
+    // RX interrupts are level triggered, re-enabled once the FIFO got drained
+    uart_set_irq_enables(uart1, false, false);
+    notifyTaskFromISR(widiTask);
+}
+
+static JRIngressStamp widiIngressStamp;
+
 midi::midi1_byte_stream_parser BT2UMP(
     CMEWidiGroup,
     [](midi::universal_packet p) {
         TRACE_INCOMING_PACKET("CME Widi In", p);
 
-        CMEWidiReceiveBuffer.write(p);
+        widiIngressStamp.write(CMEWidiReceiveBuffer, p, board::timeUs());
     }
 );
 
-UMPRingBuffer<256> CMEWidiReceiveBuffer;
-UMPRingBuffer<256> CMEWidiSendBuffer;
-static uint16_t sendReadPtr = 0;
+UMPRingBuffer<1024> CMEWidiReceiveBuffer;
+PrioritySendQueue<1024> CMEWidiSendBuffer;
+static const uint8_t widiSource = umpSources.add(CMEWidiReceiveBuffer, "CME Widi In", midi::protocol::midi1);
 
 extern "C" void pvrCMEWidiCore(void * /*pvParameters*/)
 {
     midi::universal_packet p;
     uint8_t bs_buffer[8];
 
+    widiTask = xTaskGetCurrentTaskHandle();
+    CMEWidiSendBuffer.addReader(notifyTask, widiTask);
+
     setupCME(false); // Set to true to have Full Rate
 
+    irq_set_exclusive_handler(UART1_IRQ, uart_rx_irq_handler);
+    irq_set_enabled(UART1_IRQ, true);
+
     printf("CME Widi task initialized.\n");
 
     while (1)
     {
-        taskYIELD();
-
         // Read Expansion Port
         while (uart_is_readable(uart1))
         {
@@ -62,8 +82,10 @@ extern "C" void pvrCMEWidiCore(void * /*pvParameters*/)
 
             BT2UMP.feed(ch);
         }
+        uart_set_irq_enables(uart1, true, false);
 
-        while (CMEWidiSendBuffer.read(sendReadPtr, p))
+        // clock first, SysEx dumps only when nothing else is waiting
+        while (CMEWidiSendBuffer.read(p, board::timeUs()))
         {
             TRACE_OUTGOING_PACKET("CME Widi Out", p);
 
@@ -71,24 +93,29 @@ extern "C" void pvrCMEWidiCore(void * /*pvParameters*/)
             uint8_t *s = bs_buffer;
             while (bytes--) uart_putc_raw(uart1, *s++);
         }
+        dump_dropped("CME Widi Out", CMEWidiSendBuffer);
+
+        // wait for received bytes, packets to send or a stalled SysEx message to be given up
+        const uint32_t untilWake = CMEWidiSendBuffer.untilSysexGivenUp(board::timeUs());
+        ulTaskNotifyTake(pdTRUE, ticksUntil(untilWake));
     }
 }
 
 #define CME_UART            uart1
-#define CME_UART_TX         8 // GPIO8
-#define CME_UART_RX         9 // GPIO9
+#define CME_UART_TX         ExpansionUartTxPin
+#define CME_UART_RX         ExpansionUartRxPin
 
 #define MIDI1_BAUD_RATE 31250
 #define CMEFULL_BAUD_RATE 400000
 #define BT_BAUD_RATE CMEFULL_BAUD_RATE
 
 //--- CME Defines do not change
-#define CME_ON_PIN 10
-#define CME_BUTTON_PIN 11
-#define CME_STATUS_1_PIN 16
-#define CME_STATUS_2_PIN 15
-#define CME_HSDISABLE_PIN 2
-#define CME_RESET_PIN 3
+#define CME_ON_PIN CMEOnPin
+#define CME_BUTTON_PIN CMEButtonPin
+#define CME_STATUS_1_PIN CMEStatus1Pin
+#define CME_STATUS_2_PIN CMEStatus2Pin
+#define CME_HSDISABLE_PIN CMEHSDisablePin
+#define CME_RESET_PIN CMEResetPin
 
 void setupCME(bool fullRate)
 {
@@ -11,10 +11,11 @@ void pvrCMEWidiCore(void *pvParameters);
 #ifdef __cplusplus
 }
 
+#include "PrioritySendQueue.h"
 #include "UMPRingBuffer.h"
 
-extern UMPRingBuffer<256> CMEWidiSendBuffer;
-extern UMPRingBuffer<256> CMEWidiReceiveBuffer;
+extern PrioritySendQueue<1024> CMEWidiSendBuffer;
+extern UMPRingBuffer<1024> CMEWidiReceiveBuffer;
 
 #endif
 
@@ -0,0 +1,57 @@
+#include "ControlState.h"
+
+#include <cstdio>
+
+ControlState controlState;
+
+//! snprintf appending to dst, length is set to size once dst overflows
+template <typename... Args>
+static void append(char *dst, size_t size, size_t &length, const char *format, Args... args)
+{
+    if (length >= size)
+        return;
+
+    const int n = snprintf(dst + length, size - length, format, args...);
+    length = ((n < 0) || (length + n >= size)) ? size : length + n;
+}
+
+size_t ControlState::toJSON(const Snapshot &s, char *dst, size_t size)
+{
+    size_t length = 0;
+
+    append(dst, size, length, "{\"pots\":[");
+    for (uint8_t p = 0; p < numPots; ++p)
+        append(dst, size, length, p ? ",%u" : "%u", unsigned(s.pots[p]));
+    append(dst, size, length, "],\"caps\":[");
+    for (uint8_t c = 0; c < numCaps; ++c)
+        append(dst, size, length, c ? ",%s" : "%s", ((s.caps >> c) & 1) ? "true" : "false");
+    append(dst, size, length, "]}");
+
+    return (length < size) ? length : 0;
+}
+
+size_t ControlState::toJSONPatch(const Snapshot &from, const Snapshot &to, char *dst, size_t size)
+{
+    size_t length = 0;
+    char separator = '{';
+
+    for (uint8_t p = 0; p < numPots; ++p)
+    {
+        if (from.pots[p] != to.pots[p])
+        {
+            append(dst, size, length, "%c\"/pots/%u\":%u", separator, unsigned(p), unsigned(to.pots[p]));
+            separator = ',';
+        }
+    }
+    for (uint8_t c = 0; c < numCaps; ++c)
+    {
+        if (((from.caps ^ to.caps) >> c) & 1)
+        {
+            append(dst, size, length, "%c\"/caps/%u\":%s", separator, unsigned(c), ((to.caps >> c) & 1) ? "true" : "false");
+            separator = ',';
+        }
+    }
+    append(dst, size, length, (separator == '{') ? "{}" : "}");
+
+    return (length < size) ? length : 0;
+}
@@ -0,0 +1,95 @@
+#ifndef CONTROLSTATE_H
+#define CONTROLSTATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//! Current values of the ProtoZOA controls (pots and CAP buttons)
+/***
+ *
+ * Written by PicoMainTask only, read by the UMP endpoints on either core,
+ * e.g. to answer Property Exchange requests and notify subscribers of the
+ * X-ControlState resource. A sequence counter (odd while an update is in
+ * progress) lets readers take consistent snapshots without locking, and
+ * doubles as change indicator: every update yields a new version.
+ *
+ ***/
+class ControlState
+{
+public:
+    static constexpr uint8_t numPots { 2 };
+    static constexpr uint8_t numCaps { 7 };
+
+    struct Snapshot
+    {
+        uint16_t pots[numPots] {}; //!< 12 bit
+        uint8_t caps { 0 };        //!< bit n set while CAP n is touched
+        uint32_t version { 0 };
+    };
+
+    void setPot(uint8_t pot, uint16_t value)
+    {
+        if (pot >= numPots)
+            return;
+
+        beginUpdate();
+        m_pots[pot].store(value, std::memory_order_relaxed);
+        endUpdate();
+    }
+
+    void setCap(uint8_t cap, bool touched)
+    {
+        if (cap >= numCaps)
+            return;
+
+        beginUpdate();
+        const uint8_t caps = m_caps.load(std::memory_order_relaxed);
+        m_caps.store(touched ? (caps | (1u << cap)) : (caps & ~(1u << cap)), std::memory_order_relaxed);
+        endUpdate();
+    }
+
+    uint32_t version() const { return m_version.load(std::memory_order_acquire) & ~1u; }
+
+    Snapshot snapshot() const
+    {
+        Snapshot s;
+        uint32_t version;
+        do
+        {
+            while ((version = m_version.load(std::memory_order_acquire)) & 1)
+                ;
+            for (uint8_t p = 0; p < numPots; ++p)
+                s.pots[p] = m_pots[p].load(std::memory_order_relaxed);
+            s.caps = m_caps.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (m_version.load(std::memory_order_relaxed) != version);
+
+        s.version = version;
+        return s;
+    }
+
+    //! JSON representation, returns the length or 0 if dst is too small
+    static size_t toJSON(const Snapshot&, char *dst, size_t size);
+    //! JSON object with the JSON pointers and values of all controls changed from -> to
+    static size_t toJSONPatch(const Snapshot &from, const Snapshot &to, char *dst, size_t size);
+
+private:
+    void beginUpdate()
+    {
+        m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void endUpdate()
+    {
+        m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> m_version { 0 };
+    std::atomic<uint16_t> m_pots[numPots] {};
+    std::atomic<uint8_t> m_caps { 0 };
+};
+
+extern ControlState controlState;
+
+#endif // CONTROLSTATE_H
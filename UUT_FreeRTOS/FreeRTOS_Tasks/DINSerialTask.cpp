@@ -4,80 +4,194 @@
 #include "FreeRTOS_Tasks.h"
 #include "task.h"
 
-#include "uart_rx.pio.h"
-#include "uart_tx.pio.h"
-
+#include "Board.h"
+#include "JitterReduction.h"
+#include "PIOUartDMA.h"
+#include "RunningStatusEncoder.h"
+#include "UMPScheduler.h"
+#include "UMPSources.h"
 #include "dump_packet.h"
 
 #include <midi/midi1_byte_stream.h>
 #include <midi/data_message.h>
 
+#include <array>
+#include <utility>
+
 #include <stdio.h>
 
-static void pio_rx_init(PIO piorx, uint smrx)
+static constexpr uint dinBaudRate { 31250 };
+
+#if PROTOZOA_DIN_ACTIVE_SENSING
+static constexpr uint32_t activeSensingUs { RunningStatusEncoder::defaultActiveSensingUs };
+#else
+static constexpr uint32_t activeSensingUs { 0 };
+#endif
+
+static TaskHandle_t dinTask = nullptr;
+
+static void notifyDINTask(void *)
 {
-    // Set up the state machine we're going to use to receive them.
-    uint offset = pio_add_program(piorx, &uart_rx_program);
-    uart_rx_program_init(piorx, smrx, offset, 13, 31250);
+    notifyTaskFromISR(dinTask);
 }
 
-static void pio_tx_init(PIO piotx, uint smtx)
+UMPRingBuffer<1024> DINPortReceiveBuffer;
+PrioritySendQueue<dinSendQueueCapacity> DINPortSendBuffers[numDINPorts];
+static const uint8_t dinSource = umpSources.add(DINPortReceiveBuffer, "DIN Serial In", midi::protocol::midi1);
+static JRIngressStamp dinIngressStamp;
+
+static void receivePacket(midi::universal_packet p)
 {
-    uint offset = pio_add_program(piotx, &uart_tx_program);
-    uart_tx_program_init(piotx, smtx, offset, 12, 31250);
+    TRACE_INCOMING_PACKET("DIN Serial In", p);
+    dinIngressStamp.write(DINPortReceiveBuffer, p, board::timeUs());
 }
 
-PIO pio = pio0;
-uint smRx = 0;
-uint smTx = 1;
+template <size_t... Port>
+static std::array<midi::midi1_byte_stream_parser, sizeof...(Port)> makeParsers(std::index_sequence<Port...>)
+{
+    return { midi::midi1_byte_stream_parser(dinPortConfigs[Port].inGroup, receivePacket)... };
+}
 
-midi::midi1_byte_stream_parser DIN2UMP(
-    DINPortInGroup,
-    [](midi::universal_packet p) {
-        TRACE_INCOMING_PACKET("DIN Serial In", p);
-        DINPortReceiveBuffer.write(p);
+// one parser, UART and running status per port, the parsers stamp the input group of their port
+static auto DIN2UMP = makeParsers(std::make_index_sequence<numDINPorts>{});
+static PIOUartDMA dinPorts[numDINPorts];
+static RunningStatusEncoder UMP2DIN[numDINPorts];
+
+// true if the bytes of p fit into the port's send queue
+static bool hasRoom(uint8_t port, const midi::universal_packet &p)
+{
+    return dinPorts[port].txSpace() >= (RunningStatusEncoder::isRealtime(p) ? 1 : RunningStatusEncoder::maxBytes);
+}
+
+// false if the port has no room for p, it stays queued then
+static bool sendPacket(uint8_t port, const midi::universal_packet &p, uint32_t now)
+{
+    uint8_t bs_buffer[RunningStatusEncoder::maxBytes];
+
+#if PROTOZOA_DIN_REALTIME_PRIORITY
+    // clock and transport bytes overtake the queued bytes, even in the middle of a message,
+    // they leave the running status alone
+    if (RunningStatusEncoder::isRealtime(p))
+    {
+        UMP2DIN[port].encode(p, bs_buffer, now);
+        if (dinPorts[port].writeUrgent(bs_buffer[0]))
+            return true;
+        return hasRoom(port, p) && dinPorts[port].write(bs_buffer, 1);
     }
-);
+#endif
 
-UMPRingBuffer<256> DINPortReceiveBuffer;
-UMPRingBuffer<256> DINPortSendBuffer;
-static uint16_t sendReadPtr = 0; 
+    if (!hasRoom(port, p))
+        return false;
+
+    const auto bytes = UMP2DIN[port].encode(p, bs_buffer, now);
+    return dinPorts[port].write(bs_buffer, bytes);
+}
+
+static const char *const dinOutNames[] = { "DIN Serial Out", "DIN2 Serial Out", "DIN3 Serial Out", "DIN4 Serial Out" };
+static_assert(numDINPorts <= sizeof(dinOutNames) / sizeof(dinOutNames[0]));
 
 extern "C" void pvrDINSerial(void * /*pvParameters*/)
 {
-    midi::universal_packet p;
-    uint8_t bs_buffer[8];
+    uint8_t rx_buffer[64];
+#if PROTOZOA_TRACE_OUTGOING_TRAFFIC
+    constexpr uint32_t statsIntervalUs { 10000000 };
+    uint32_t statsUs = board::timeUs();
+#endif
+
+    dinTask = xTaskGetCurrentTaskHandle();
+    for (auto &queue : DINPortSendBuffers)
+        queue.addReader(notifyTask, dinTask);
+
+    // releases JR timestamped UMPs to the DIN / Widi send buffers
+    umpScheduler.init();
 
     //---------- Setup MIDI Din Ports
-    // Setup pio for receive
-    pio_rx_init(pio, smRx);
-    // Setup pio for transmit
-    pio_tx_init(pio, smTx);
+    // received bytes and sent bytes are moved by DMA, the task is notified
+    // when bytes got received and when a send queue has room again
+    for (size_t port = 0; port < numDINPorts; ++port)
+    {
+        const DINPortConfig &config = dinPortConfigs[port];
+        dinPorts[port].init(config.pio ? pio1 : pio0, config.smRx, config.pinRx, config.smTx, config.pinTx,
+                            dinBaudRate, notifyDINTask, nullptr);
+        UMP2DIN[port] = RunningStatusEncoder(RunningStatusEncoder::defaultStatusRefreshUs, activeSensingUs);
+    }
 
-    printf("5-pin DIN task initialized.\n");
+    printf("5-pin DIN task initialized, %u port(s).\n", unsigned(numDINPorts));
 
     while (1)
     {
-        taskYIELD();
+        // Read from DIN Ports
+        for (size_t port = 0; port < numDINPorts; ++port)
+        {
+            do
+            {
+                size_t n;
+                while ((n = dinPorts[port].read(rx_buffer, sizeof(rx_buffer))) != 0)
+                {
+                    for (size_t i = 0; i < n; ++i)
+                    {
+                        if (rx_buffer[i] == 0xFE)
+                            continue; // Skip ActiveSense
+
+                        DIN2UMP[port].feed(rx_buffer[i]);
+                    }
+                }
+            } while (!dinPorts[port].armReceiveNotification());
+        }
 
-        // Read from DIN Port
-        while ( !pio_sm_is_rx_fifo_empty(pio, smRx) )
+        // queue as long as a complete message fits into the port's send queue, the DMA clocks
+        // the bytes out. Every port has its own send buffer, a full port holds back only its own
+        // packets until it drained, keeping their order. Real time messages come first and skip
+        // the port queue (PROTOZOA_DIN_REALTIME_PRIORITY), SysEx waits for channel voice
+        // messages. A packet leaves the send buffer once sent.
+        for (size_t port = 0; port < numDINPorts; ++port)
         {
-            // Get a character from the buffer
-            uint8_t ch = uart_rx_program_getc(pio, smRx);
-            if(ch == 0xFE)
-                continue; // Skip ActiveSense
-            
-            DIN2UMP.feed(ch);
+            auto &queue = DINPortSendBuffers[port];
+            midi::universal_packet p;
+            while (queue.peek(p, board::timeUs()))
+            {
+                const uint32_t now = board::timeUs();
+                if (!sendPacket(port, p, now))
+                    break;
+
+                queue.consume(now);
+                TRACE_OUTGOING_PACKET(dinOutNames[port], p);
+            }
+            dump_dropped(dinOutNames[port], queue);
         }
 
-        while (DINPortSendBuffer.read(sendReadPtr, p))
+#if PROTOZOA_TRACE_OUTGOING_TRAFFIC
+        if (board::timeUs() - statsUs >= statsIntervalUs)
         {
-            TRACE_OUTGOING_PACKET("DIN Serial Out", p);
-                        
-            auto bytes = midi::to_midi1_byte_stream(p, bs_buffer);
-            uint8_t *s = bs_buffer;
-            while (bytes--) uart_tx_program_putc(pio, smTx, *s++);
+            for (size_t port = 0; port < numDINPorts; ++port)
+            {
+                dump_delay_stats(dinOutNames[port], DINPortSendBuffers[port]);
+                DINPortSendBuffers[port].resetDelayStats();
+            }
+            statsUs = board::timeUs();
         }
+#endif
+
+        // active sensing on idle ports
+        const uint32_t now = board::timeUs();
+        uint32_t untilWake = UINT32_MAX;
+        for (size_t port = 0; port < numDINPorts; ++port)
+        {
+            uint32_t us = DINPortSendBuffers[port].untilSysexGivenUp(now);
+            if (us < untilWake)
+                untilWake = us;
+
+            uint8_t fe;
+            if (UMP2DIN[port].idle(&fe, now))
+                dinPorts[port].write(&fe, 1);
+
+            us = UMP2DIN[port].untilIdle(now);
+            if (us < untilWake)
+                untilWake = us;
+        }
+
+        // wait for received bytes, packets to send, room in a send queue, the next active sensing
+        // or a stalled SysEx message to be given up
+        ulTaskNotifyTake(pdTRUE, ticksUntil(untilWake));
     }
 }
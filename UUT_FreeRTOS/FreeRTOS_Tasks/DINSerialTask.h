@@ -12,10 +12,94 @@ void pvrDINSerial(void *pvParameters);
 #ifdef __cplusplus
 }
 
+#include "Groups.h"
+#include "Pins.h"
+#include "PrioritySendQueue.h"
 #include "UMPRingBuffer.h"
 
-extern UMPRingBuffer<256> DINPortSendBuffer;
-extern UMPRingBuffer<256> DINPortReceiveBuffer;
+#include <cstddef>
+#include <cstdint>
+
+//! one 5-pin DIN in/out pair, served by two state machines of a PIO block
+struct DINPortConfig
+{
+    uint8_t pio;      //!< PIO block 0 or 1
+    uint8_t smRx;
+    uint8_t pinRx;
+    uint8_t smTx;
+    uint8_t pinTx;
+    uint8_t inGroup;  //!< UMP group of the bytes received
+    uint8_t outGroup; //!< UMP group of the bytes sent
+};
+
+// The RP2040 has 8 state machines, so at most four pairs. The additional
+// pairs use GPIOs no other board function claims, see Pins.h.
+static constexpr DINPortConfig dinPortConfigs[] = {
+    { 0, 0, DINPortRxPin, 1, DINPortTxPin, DINPortInGroup, DINPortsGroup },
+#if PROTOZOA_DIN_PORTS >= 2
+    { 0, 2, DINPort2RxPin, 3, DINPort2TxPin, DINPort2Group, DINPort2Group },
+#endif
+#if PROTOZOA_DIN_PORTS >= 3
+    { 1, 0, DINPort3RxPin, 1, DINPort3TxPin, DINPort3Group, DINPort3Group },
+#endif
+#if PROTOZOA_DIN_PORTS >= 4
+    { 1, 2, DINPort4RxPin, 3, DINPort4TxPin, DINPort4Group, DINPort4Group },
+#endif
+};
+static constexpr size_t numDINPorts { sizeof(dinPortConfigs) / sizeof(dinPortConfigs[0]) };
+
+// pins of the other board functions, whether enabled in this build or not
+static constexpr uint8_t nonDINPins[] = {
+    StdioTxPin, StdioRxPin,
+    InterchipRxPin, InterchipClkPin, InterchipTxPin,
+    ExpansionUartTxPin, ExpansionUartRxPin,
+    CMEHSDisablePin, CMEResetPin, CMEOnPin, CMEButtonPin, CMEStatus1Pin, CMEStatus2Pin,
+    LEDPin, EntropyADCPin,
+};
+
+constexpr bool dinPinsCollide()
+{
+    for (size_t port = 0; port < numDINPorts; ++port)
+    {
+        const DINPortConfig &config = dinPortConfigs[port];
+        if (config.pinRx == config.pinTx)
+            return true;
+        for (const uint8_t pin : nonDINPins)
+            if ((config.pinRx == pin) || (config.pinTx == pin))
+                return true;
+        for (size_t other = 0; other < port; ++other)
+        {
+            const DINPortConfig &o = dinPortConfigs[other];
+            if ((config.pinRx == o.pinRx) || (config.pinRx == o.pinTx) || (config.pinTx == o.pinRx) || (config.pinTx == o.pinTx))
+                return true;
+        }
+    }
+    return false;
+}
+static_assert(!dinPinsCollide(), "DIN port pins collide with each other or another board function, see Pins.h");
+
+//! port index of an output group, numDINPorts if no port sends the group
+constexpr size_t dinPortOfGroup(uint8_t group)
+{
+    for (size_t port = 0; port < numDINPorts; ++port)
+        if (dinPortConfigs[port].outGroup == group)
+            return port;
+    return numDINPorts;
+}
+
+// a send queue per port, so a full port holds back only its own packets,
+// the received bytes of all ports share a buffer, the group tells the port
+static constexpr uint16_t dinSendQueueCapacity { (numDINPorts > 1) ? 512 : 1024 };
+extern PrioritySendQueue<dinSendQueueCapacity> DINPortSendBuffers[numDINPorts];
+extern UMPRingBuffer<1024> DINPortReceiveBuffer;
+
+//! queue p for the port of its group, packets of other groups are ignored
+inline void writeDINPort(const midi::universal_packet &p)
+{
+    const size_t port = dinPortOfGroup(p.group());
+    if (port < numDINPorts)
+        DINPortSendBuffers[port].write(p);
+}
 #endif
 
 #endif // DINSERIALTASK_H
@@ -0,0 +1,269 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//----------------------------------------------------
+/// streaming zlib (RFC 1950) / deflate (RFC 1951) compressor for small devices
+/***
+ *
+ * LZ77 with hash chains over a small sliding window, encoded as a single
+ * block with the fixed Huffman codes, so no code tables have to be built
+ * or sent. For short JSON documents the fixed codes lose little against
+ * dynamic ones, while the complete state stays below 2 kB (window_size 256)
+ * and every byte costs a bounded amount of work.
+ *
+ * The window size is advertised in the zlib header, so decoders can size
+ * their history accordingly. Compressed bytes are passed to sink one at a
+ * time, call finish() after the last input byte.
+ *
+ ***/
+template <typename Sink, uint16_t window_size = 256>
+class DeflateEncoder {
+public:
+  static_assert((window_size >= 256) && (window_size <= 32768) && ((window_size & (window_size - 1)) == 0),
+                "window_size must be a power of two between 256 and 32768");
+
+  explicit DeflateEncoder(Sink &s) : sink(s)
+  {
+    sink(cmf);
+    sink(flg);
+
+    put_bits(1, 1); // BFINAL
+    put_bits(1, 2); // BTYPE fixed Huffman codes
+  }
+
+  void operator()(uint8_t b)
+  {
+    update_adler(b);
+
+    if (end == buffer_size)
+      slide();
+    buffer[end++] = b;
+
+    while (end - pos >= max_match)
+      compress_next();
+  }
+
+  void write(const uint8_t *data, size_t n)
+  {
+    while (n--)
+      (*this)(*data++);
+  }
+
+  void finish()
+  {
+    while (pos < end)
+      compress_next();
+
+    put_symbol(256); // end of block
+
+    if (num_bits)
+      sink(uint8_t(bits));
+    bits = 0;
+    num_bits = 0;
+
+    const uint32_t adler = (adler_b << 16) | adler_a;
+    sink(uint8_t(adler >> 24));
+    sink(uint8_t(adler >> 16));
+    sink(uint8_t(adler >> 8));
+    sink(uint8_t(adler));
+  }
+
+private:
+  static constexpr uint16_t min_match { 3 };
+  static constexpr uint16_t max_match { 258 };
+  static constexpr uint8_t max_chain { 8 };
+  static constexpr uint16_t buffer_size { 2 * window_size + max_match };
+  static constexpr uint16_t hash_size { 256 };
+  static constexpr uint16_t window_mask { window_size - 1 };
+
+  // zlib header
+  static constexpr uint8_t log2(uint32_t v) { return (v > 1) ? 1 + log2(v >> 1) : 0; }
+  static constexpr uint8_t cmf { uint8_t(((log2(window_size) - 8) << 4) | 8) };
+  static constexpr uint8_t flg { uint8_t((31 - (cmf * 256) % 31) % 31) };
+
+  // length / distance codes
+  static constexpr uint16_t length_base[29] {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  static constexpr uint8_t length_extra[29] {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  static constexpr uint16_t distance_base[30] {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+  static constexpr uint8_t distance_extra[30] {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+  static constexpr std::array<uint8_t, max_match + 1> make_length_codes()
+  {
+    std::array<uint8_t, max_match + 1> codes {};
+    for (uint8_t c = 0; c < 28; ++c)
+      for (uint16_t l = length_base[c]; l < length_base[c] + (1u << length_extra[c]); ++l)
+        codes[l] = c;
+    codes[max_match] = 28;
+    return codes;
+  }
+  static constexpr auto length_codes = make_length_codes();
+
+  Sink &sink;
+
+  uint8_t buffer[buffer_size];
+  uint16_t head[hash_size] {};     // most recent position + 1 per hash
+  uint16_t prev[window_size] {};   // previous position + 1 with the same hash
+  uint16_t pos { 0 };
+  uint16_t end { 0 };
+
+  uint32_t bits { 0 };
+  uint8_t num_bits { 0 };
+
+  uint32_t adler_a { 1 };
+  uint32_t adler_b { 0 };
+
+  void update_adler(uint8_t b)
+  {
+    adler_a += b;
+    if (adler_a >= 65521)
+      adler_a -= 65521;
+    adler_b += adler_a;
+    if (adler_b >= 65521)
+      adler_b -= 65521;
+  }
+
+  uint8_t hash(uint16_t p) const
+  {
+    const uint32_t v = buffer[p] | (buffer[p + 1] << 8) | (uint32_t(buffer[p + 2]) << 16);
+    return uint8_t((v * 2654435761u) >> 24);
+  }
+
+  void insert(uint16_t p)
+  {
+    if (p + min_match > end)
+      return;
+
+    const uint8_t h = hash(p);
+    prev[p & window_mask] = head[h];
+    head[h] = p + 1;
+  }
+
+  /// drop history older than the window, keeps positions congruent modulo window_size
+  void slide()
+  {
+    const uint16_t shift = (pos - window_size) & ~window_mask;
+
+    memmove(buffer, buffer + shift, end - shift);
+    pos -= shift;
+    end -= shift;
+
+    for (auto &h : head)
+      h = (h > shift) ? h - shift : 0;
+    for (auto &p : prev)
+      p = (p > shift) ? p - shift : 0;
+  }
+
+  void compress_next()
+  {
+    const uint16_t avail = end - pos;
+    const uint16_t max_length = (avail < max_match) ? avail : max_match;
+
+    uint16_t best_length = 0;
+    uint16_t best_distance = 0;
+
+    if (max_length >= min_match)
+    {
+      uint16_t candidate = head[hash(pos)];
+      for (uint8_t chain = max_chain; candidate && chain; --chain)
+      {
+        const uint16_t q = candidate - 1;
+        const uint16_t distance = pos - q;
+        if ((q >= pos) || (distance > window_size))
+          break;
+
+        uint16_t length = 0;
+        while ((length < max_length) && (buffer[q + length] == buffer[pos + length]))
+          ++length;
+
+        if (length > best_length)
+        {
+          best_length = length;
+          best_distance = distance;
+          if (length == max_length)
+            break;
+        }
+
+        const uint16_t next = prev[q & window_mask];
+        if (next >= candidate)
+          break; // stale entry
+        candidate = next;
+      }
+    }
+
+    if (best_length >= min_match)
+    {
+      put_match(best_length, best_distance);
+      for (uint16_t i = 0; i < best_length; ++i)
+        insert(pos + i);
+      pos += best_length;
+    }
+    else
+    {
+      put_symbol(buffer[pos]);
+      insert(pos);
+      ++pos;
+    }
+  }
+
+  void put_bits(uint32_t value, uint8_t n)
+  {
+    bits |= value << num_bits;
+    num_bits += n;
+    while (num_bits >= 8)
+    {
+      sink(uint8_t(bits));
+      bits >>= 8;
+      num_bits -= 8;
+    }
+  }
+
+  /// Huffman codes are sent most significant bit first
+  void put_code(uint16_t code, uint8_t length)
+  {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; ++i)
+      reversed |= ((code >> i) & 1) << (length - 1 - i);
+    put_bits(reversed, length);
+  }
+
+  void put_symbol(uint16_t s)
+  {
+    if (s < 144)
+      put_code(0x30 + s, 8);
+    else if (s < 256)
+      put_code(0x190 + s - 144, 9);
+    else if (s < 280)
+      put_code(s - 256, 7);
+    else
+      put_code(0xC0 + s - 280, 8);
+  }
+
+  void put_match(uint16_t length, uint16_t distance)
+  {
+    const uint8_t lc = length_codes[length];
+    put_symbol(257 + lc);
+    put_bits(length - length_base[lc], length_extra[lc]);
+
+    uint8_t dc = 29;
+    while (distance_base[dc] > distance)
+      --dc;
+    put_code(dc, 5);
+    put_bits(distance - distance_base[dc], distance_extra[dc]);
+  }
+};
+
+//----------------------------------------------------
@@ -0,0 +1,176 @@
+#include "Entropy.h"
+
+#if PICO_ON_DEVICE
+#include "Pins.h"
+
+#include "hardware/adc.h"
+#include "hardware/structs/rosc.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "pico/unique_id.h"
+#else
+#include <chrono>
+#endif
+
+EntropyPool entropy;
+
+static constexpr uint32_t rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void quarterRound(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d)
+{
+    a += b; d ^= a; d = rotl(d, 16);
+    c += d; b ^= c; b = rotl(b, 12);
+    a += b; d ^= a; d = rotl(d, 8);
+    c += d; b ^= c; b = rotl(b, 7);
+}
+
+//! the pool words rotated through all quarter round positions
+void EntropyPool::mix(uint32_t sample)
+{
+    m_pool[0] ^= sample;
+    quarterRound(m_pool[0], m_pool[1], m_pool[2], m_pool[3]);
+    quarterRound(m_pool[1], m_pool[2], m_pool[3], m_pool[0]);
+    quarterRound(m_pool[2], m_pool[3], m_pool[0], m_pool[1]);
+    quarterRound(m_pool[3], m_pool[0], m_pool[1], m_pool[2]);
+}
+
+#if PICO_ON_DEVICE
+//! ROSC random bits are sampled from the free running oscillator, n <= 32
+static uint32_t roscBits(unsigned n)
+{
+    uint32_t bits = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        bits = (bits << 1) | (rosc_hw->randombit & 1);
+        // a few cycles between reads reduce the correlation of consecutive bits
+        for (volatile int d = 0; d < 4; ++d)
+            ;
+    }
+    return bits;
+}
+#endif
+
+//! called with the lock held
+void EntropyPool::seed()
+{
+#if PICO_ON_DEVICE
+    pico_unique_board_id_t id;
+    pico_get_unique_board_id(&id);
+    for (size_t i = 0; i < PICO_UNIQUE_BOARD_ID_SIZE_BYTES; i += 4)
+        mix(id.id[i] | (id.id[i + 1] << 8) | (id.id[i + 2] << 16) | (uint32_t(id.id[i + 3]) << 24));
+
+    mix(time_us_32());
+    // ROSC bits carry roughly half a bit of entropy each
+    for (int i = 0; i < 8; ++i)
+        mix(roscBits(32));
+    m_entropyBits += 128;
+#else
+    const auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    mix(uint32_t(now));
+    mix(uint32_t(uint64_t(now) >> 32));
+    mix(uint32_t(reinterpret_cast<uintptr_t>(this)));
+#endif
+
+    m_seeded = true;
+}
+
+void EntropyPool::addSample(uint32_t sample, uint8_t bits)
+{
+    Lock lock { m_lock };
+
+    mix(sample);
+    m_entropyBits = (m_entropyBits + bits > 256) ? 256 : m_entropyBits + bits;
+}
+
+uint32_t EntropyPool::random32()
+{
+    Lock lock { m_lock };
+
+    if (!m_seeded)
+        seed();
+
+    // output from a copy of the pool, then fold the output back (forward secrecy)
+    uint32_t s[4] { m_pool[0], m_pool[1], m_pool[2], m_pool[3] ^ ++m_counter };
+    for (int r = 0; r < 4; ++r)
+    {
+        quarterRound(s[0], s[1], s[2], s[3]);
+        quarterRound(s[1], s[2], s[3], s[0]);
+    }
+    const uint32_t result = s[0] ^ s[2];
+    mix(s[1] ^ s[3]);
+
+    return result;
+}
+
+uint32_t EntropyPool::random(uint32_t max)
+{
+    if (max == UINT32_MAX)
+        return random32();
+
+    // rejection sampling, no modulo bias
+    const uint32_t range = max + 1;
+    const uint32_t limit = UINT32_MAX - (UINT32_MAX % range);
+    uint32_t r;
+    do
+    {
+        r = random32();
+    } while (r >= limit);
+
+    return r % range;
+}
+
+uint32_t EntropyPool::makeMUID(const uint32_t *avoid, size_t numAvoid)
+{
+    while (true)
+    {
+        const uint32_t muid = random32() & 0x0FFFFFFF;
+        if (muid >= 0x0FFFFF00)
+            continue; // reserved
+
+        bool inUse = false;
+        for (size_t i = 0; i < numAvoid; ++i)
+            inUse |= (avoid[i] == muid);
+        if (!inUse)
+            return muid;
+    }
+}
+
+void EntropyPool::gather()
+{
+#if PICO_ON_DEVICE
+    static bool adcReady = false;
+    if (!adcReady)
+    {
+        // GPIO26 / ADC0 is left floating, its lowest bits are noise
+        adc_init();
+        adc_gpio_init(EntropyADCPin);
+        adc_select_input(0);
+        adcReady = true;
+    }
+
+    uint32_t noise = 0;
+    for (int i = 0; i < 8; ++i)
+        noise = (noise << 4) ^ adc_read();
+
+    addSample(noise ^ time_us_32(), 8);
+    addSample(roscBits(32), 16);
+#endif
+}
+
+extern "C" void entropyIdleHook(void)
+{
+#if PICO_ON_DEVICE
+    // the idle tasks of both cores call the hook, core 0 owns the ADC
+    if (get_core_num() != 0)
+        return;
+
+    // sample every 10 ms, the idle hook itself runs far more often
+    static uint32_t lastGather = 0;
+    const uint32_t now = time_us_32();
+    if (now - lastGather < 10000)
+        return;
+    lastGather = now;
+#endif
+
+    entropy.gather();
+}
@@ -0,0 +1,90 @@
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! gathers entropy in the background, call from the FreeRTOS idle hook (never blocks)
+void entropyIdleHook(void);
+
+#ifdef __cplusplus
+}
+
+#include <cstddef>
+#include <cstdint>
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#else
+#include <mutex>
+#endif
+
+//! Entropy pool serving random numbers and MUIDs without blocking
+/***
+ *
+ * Raw samples (ROSC random bits, the noise of a floating ADC input, timer
+ * values) are mixed into a 128 bit pool with ChaCha quarter rounds, which
+ * conditions biased and correlated hardware samples. Outputs are derived
+ * from the pool and a counter, and every output is fed back into the pool,
+ * so outputs do not reveal earlier ones.
+ *
+ * The pool seeds itself on first use with the board id, the time and a
+ * short burst of ROSC bits, which takes microseconds, not seconds, so MUIDs
+ * can be drawn from static initializers. entropyIdleHook keeps adding
+ * samples while the system runs, e.g. before a MUID gets replaced after an
+ * invalidate_muid.
+ *
+ * Thread and interrupt safe (a spin lock section on the RP2040).
+ *
+ ***/
+class EntropyPool
+{
+public:
+    //! mix in a raw sample carrying about entropyBits bits of entropy
+    void addSample(uint32_t sample, uint8_t entropyBits);
+
+    uint32_t random32();
+    //! uniformly distributed in [0, max]
+    uint32_t random(uint32_t max);
+
+    //! random 28 bit MUID outside the reserved range (0x0FFFFF00 - 0x0FFFFFFF),
+    //! different from the numAvoid MUIDs in avoid (e.g. an invalidated one)
+    uint32_t makeMUID(const uint32_t *avoid = nullptr, size_t numAvoid = 0);
+
+    //! estimated entropy mixed in so far, saturates at 256
+    uint16_t entropyBits() const { return m_entropyBits; }
+
+    //! sample the hardware sources once, called by entropyIdleHook
+    void gather();
+
+private:
+#if PICO_ON_DEVICE
+    struct SpinLock {};
+    struct Lock
+    {
+        explicit Lock(SpinLock&) : irqState(spin_lock_blocking(lock())) {}
+        ~Lock() { spin_unlock(lock(), irqState); }
+        static spin_lock_t *lock() { return spin_lock_instance(PICO_SPINLOCK_ID_STRIPED_FIRST); }
+        uint32_t irqState;
+    };
+#else
+    using SpinLock = std::mutex;
+    using Lock = std::lock_guard<std::mutex>;
+#endif
+
+    void seed();
+    void mix(uint32_t sample);
+
+    uint32_t m_pool[4] { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    uint32_t m_counter { 0 };
+    uint16_t m_entropyBits { 0 };
+    bool m_seeded { false };
+    SpinLock m_lock;
+};
+
+extern EntropyPool entropy;
+
+#endif // __cplusplus
+
+#endif // ENTROPY_H
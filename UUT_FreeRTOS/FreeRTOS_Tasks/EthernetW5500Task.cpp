@@ -1,6 +1,7 @@
 #include "EthernetW5500Task.h"
 
 #include "FreeRTOS.h"
+#include "FreeRTOS_Tasks.h"
 #include "task.h"
 
 #include <stdio.h>
@@ -12,7 +13,7 @@ extern "C" void pvrEthernetW5500(void * /*pvParameters*/)
     while (1)
     {
         // TODO: move Ethernet W5500 code to here
-        taskYIELD();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 
 }
@@ -2,6 +2,9 @@
 #define FREERTOS_TASKS_H
 
 #include "FreeRTOS.h"
+#include "task.h"
+
+#include "Groups.h"
 
 // Task Priorities
 #define BLINK_TASK_PRIORITY       (tskIDLE_PRIORITY + 2)
@@ -14,17 +17,29 @@
 #define USB_CDC_SERIAL_PRIORITY   (tskIDLE_PRIORITY + 1)
 #define USB_MIDI_TASK_PRIORITY    (tskIDLE_PRIORITY + 1)
 
-enum Groups
+// I/O tasks block on task notifications (ulTaskNotifyTake) given by interrupts,
+// TinyUSB callbacks and ring buffer writes. The timeout only covers work due
+// at a given time, see UMPProcessing::sendPendingUMPs.
+static inline TickType_t ticksUntil(uint32_t us)
+{
+    return (us == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(us / 1000 + 1);
+}
+
+// Wake up a task from an interrupt handler
+static inline void notifyTaskFromISR(TaskHandle_t task)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+// Wake up a task, usable as UMPReaderNotifyProc from tasks and interrupt handlers
+static inline void notifyTask(void *task)
 {
-  MainGroup       = 0x00,
-  DINPortsGroup   = 0x01,
- #if PROTOZOA_EXPANSION_CME_WIDI_CORE
-  DINPortInGroup  = 0x01,
-  CMEWidiGroup    = 0x02,
- #else
-  DINPortInGroup  = 0x02,
-  DINPortOutGroup = 0x01,
- #endif
-};
+    if (portCHECK_IF_IN_ISR())
+        notifyTaskFromISR((TaskHandle_t)task);
+    else
+        xTaskNotifyGive((TaskHandle_t)task);
+}
 
 #endif // FREERTOS_TASKS_H
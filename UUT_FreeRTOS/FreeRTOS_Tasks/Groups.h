@@ -0,0 +1,31 @@
+#ifndef GROUPS_H
+#define GROUPS_H
+
+#ifndef PROTOZOA_DIN_PORTS
+#define PROTOZOA_DIN_PORTS 1
+#endif
+
+// Function block / UMP group assignment of the board
+enum Groups
+{
+  MainGroup       = 0x00,
+  DINPortsGroup   = 0x01,
+ #if PROTOZOA_EXPANSION_CME_WIDI_CORE
+  DINPortInGroup  = 0x01,
+  CMEWidiGroup    = 0x02,
+ #else
+  DINPortInGroup  = 0x02,
+  DINPortOutGroup = 0x01,
+ #endif
+ #if PROTOZOA_DIN_PORTS >= 2
+  DINPort2Group   = 0x03,
+ #endif
+ #if PROTOZOA_DIN_PORTS >= 3
+  DINPort3Group   = 0x04,
+ #endif
+ #if PROTOZOA_DIN_PORTS >= 4
+  DINPort4Group   = 0x05,
+ #endif
+};
+
+#endif // GROUPS_H
@@ -0,0 +1,139 @@
+#ifndef JITTERREDUCTION_H
+#define JITTERREDUCTION_H
+
+#include <midi/universal_packet.h>
+
+#include <cstdint>
+
+//! Jitter Reduction Clock / Timestamp utility messages
+namespace jr {
+
+// JR time is counted in ticks of 1/31250 s
+constexpr uint32_t usPerTick { 32 };
+
+constexpr uint8_t clockStatus { 0x1 };
+constexpr uint8_t timestampStatus { 0x2 };
+
+// Stream Configuration / Endpoint Info extension bits
+constexpr uint8_t transmit { 0x01 };
+constexpr uint8_t receive { 0x02 };
+
+constexpr uint16_t ticks(uint32_t us) { return uint16_t(us / usPerTick); }
+
+constexpr uint8_t status(const midi::universal_packet &p) { return (p.data[0] >> 20) & 0x0F; }
+constexpr uint16_t time(const midi::universal_packet &p) { return uint16_t(p.data[0]); }
+
+constexpr midi::universal_packet makeClock(uint16_t senderClock)
+{
+    return midi::universal_packet{ (uint32_t(clockStatus) << 20) | senderClock };
+}
+constexpr midi::universal_packet makeTimestamp(uint16_t timestamp)
+{
+    return midi::universal_packet{ (uint32_t(timestampStatus) << 20) | timestamp };
+}
+constexpr bool isTimestamp(uint32_t word0) { return (word0 >> 20) == timestampStatus; }
+
+} // namespace jr
+
+//! Stamps the UMPs written to a source ring with their ingress time
+/***
+ *
+ * A JR Timestamp of the local time is written ahead of every run of
+ * packets arriving within the same JR tick. Endpoints with Jitter
+ * Reduction enabled pass it on ahead of those packets, however long they
+ * waited in the ring, the others skip it (see UMPProcessing::forwardUMPs).
+ *
+ * One per ring, used by the ring's writer only.
+ *
+ ***/
+class JRIngressStamp
+{
+public:
+    template <typename Ring>
+    void write(Ring &ring, const midi::universal_packet &p, uint32_t now)
+    {
+        const uint16_t ticks = jr::ticks(now);
+        if (!m_stamped || (ticks != m_ticks))
+        {
+            ring.write(jr::makeTimestamp(ticks));
+            m_ticks = ticks;
+            m_stamped = true;
+        }
+        ring.write(p);
+    }
+
+private:
+    bool m_stamped { false };
+    uint16_t m_ticks { 0 };
+};
+
+//! Maps JR Timestamps of a sender to local time
+/***
+ *
+ * Every JR Clock received gives an estimate of the offset between the
+ * sender clock and local time, delayed by the transport. The smallest
+ * offset of the last two windows of clocks is the least delayed one and
+ * is used for the mapping, which removes transport jitter while still
+ * following drift.
+ *
+ * Local times are free running microseconds (e.g. time_us_32), all
+ * comparisons have to be wrap around safe.
+ *
+ ***/
+class JRClockReceiver
+{
+public:
+    static constexpr uint8_t windowSize { 8 };
+
+    void reset() { m_synced = false; }
+
+    void clock(uint16_t senderClock, uint32_t now)
+    {
+        if (m_synced)
+            m_senderTime += uint16_t(senderClock - m_senderClock) * jr::usPerTick;
+        else
+            m_senderTime = senderClock * jr::usPerTick;
+        m_senderClock = senderClock;
+
+        const uint32_t offset = now - m_senderTime;
+        if (!m_synced)
+        {
+            m_windowMin = m_prevWindowMin = offset;
+            m_numClocks = 0;
+            m_synced = true;
+        }
+        else if ((m_numClocks == 0) || earlier(offset, m_windowMin))
+        {
+            m_windowMin = offset;
+        }
+
+        if (++m_numClocks == windowSize)
+        {
+            m_prevWindowMin = m_windowMin;
+            m_numClocks = 0;
+        }
+    }
+
+    //! local time of timestamp, false until the first JR Clock arrived
+    bool localTime(uint16_t timestamp, uint32_t &time) const
+    {
+        if (!m_synced)
+            return false;
+
+        const uint32_t offset = earlier(m_prevWindowMin, m_windowMin) ? m_prevWindowMin : m_windowMin;
+        time = m_senderTime + int16_t(timestamp - m_senderClock) * int32_t(jr::usPerTick) + offset;
+        return true;
+    }
+
+    static bool earlier(uint32_t a, uint32_t b) { return int32_t(a - b) < 0; }
+
+private:
+    bool m_synced { false };
+    uint8_t m_numClocks { 0 };
+    uint16_t m_senderClock { 0 };
+    uint32_t m_senderTime { 0 };    // sender clock in microseconds, unwrapped
+    uint32_t m_windowMin { 0 };
+    uint32_t m_prevWindowMin { 0 };
+};
+
+#endif // JITTERREDUCTION_H
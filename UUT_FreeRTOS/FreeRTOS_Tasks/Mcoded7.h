@@ -0,0 +1,89 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------
+/// streaming Mcoded7 encoder
+/***
+ *
+ * Every group of up to 7 bytes is sent as a byte holding their most
+ * significant bits (first byte in bit 6) followed by the 7 low bits of
+ * each byte. Encoded bytes are passed to sink one at a time, call
+ * flush() after the last input byte.
+ *
+ ***/
+template <typename Sink>
+class Mcoded7Encoder {
+public:
+  explicit Mcoded7Encoder(Sink &s) : sink(s) {}
+
+  static constexpr size_t encoded_size(size_t n) { return n + (n + 6) / 7; }
+
+  void operator()(uint8_t b)
+  {
+    group[num_bytes++] = b;
+    if (num_bytes == 7)
+      flush();
+  }
+
+  void write(const uint8_t *data, size_t n)
+  {
+    while (n--)
+      (*this)(*data++);
+  }
+
+  void flush()
+  {
+    if (!num_bytes)
+      return;
+
+    uint8_t msbs = 0;
+    for (uint8_t i = 0; i < num_bytes; ++i)
+      msbs |= (group[i] >> 7) << (6 - i);
+
+    sink(msbs);
+    for (uint8_t i = 0; i < num_bytes; ++i)
+      sink(uint8_t(group[i] & 0x7F));
+
+    num_bytes = 0;
+  }
+
+private:
+  Sink &sink;
+  uint8_t group[7];
+  uint8_t num_bytes { 0 };
+};
+
+//----------------------------------------------------
+/// streaming Mcoded7 decoder, the counterpart of Mcoded7Encoder
+template <typename Sink>
+class Mcoded7Decoder {
+public:
+  explicit Mcoded7Decoder(Sink &s) : sink(s) {}
+
+  void operator()(uint8_t b)
+  {
+    if (pos == 0)
+      msbs = b;
+    else
+      sink(uint8_t(b | (((msbs >> (7 - pos)) & 1) << 7)));
+
+    pos = (pos == 7) ? 0 : pos + 1;
+  }
+
+  void write(const uint8_t *data, size_t n)
+  {
+    while (n--)
+      (*this)(*data++);
+  }
+
+private:
+  Sink &sink;
+  uint8_t msbs { 0 };
+  uint8_t pos { 0 };
+};
+
+//----------------------------------------------------
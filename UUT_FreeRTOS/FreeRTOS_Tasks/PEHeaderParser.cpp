@@ -1,48 +1,80 @@
 #include "PEHeaderParser.h"
+#include "PerfectHash.h"
 
 #include <cstring>
+#include <iterator>
 
 //----------------------------------------------------
 
-const PEHeaderParser::ResourceEntry PEHeaderParser::resources[] = {
-  { Resource::ResourceList, "ResourceList", 12 },
-  { Resource::DeviceInfo,   "DeviceInfo",   10 },
-  { Resource::ChannelList,  "ChannelList",  11 },
-  { Resource::ChCtrlList,   "ChCtrlList",   10 },
-  { Resource::ProgramList,  "ProgramList",  11 },
+static constexpr Keyword<Resource> resource_names[] = {
+  { Resource::ResourceList, "ResourceList" },
+  { Resource::DeviceInfo,   "DeviceInfo" },
+  { Resource::ChannelList,  "ChannelList" },
+  { Resource::ChCtrlList,   "ChCtrlList" },
+  { Resource::ProgramList,  "ProgramList" },
+  { Resource::XControlState, "X-ControlState" },
+  { Resource::XSettings,    "X-Settings" },
 };
-
-const PEHeaderParser::OptionEntry PEHeaderParser::options[] = {
-  { Option::What::Limit,    "limit",    5 },
-  { Option::What::Offset,   "offset",   6 },
-  { Option::What::ID,       "id",       2 },
-  { Option::What::Encoding, "encoding", 8 },
+static_assert(std::size(resource_names) == static_cast<size_t>(Resource::__count__)-1, "missing resource name");
+
+static constexpr Keyword<Option::What> option_names[] = {
+  { Option::What::Limit,    "limit" },
+  { Option::What::Offset,   "offset" },
+  { Option::What::ID,       "id" },
+  { Option::What::Encoding, "encoding" },
+  { Option::What::Encoding, "mutualEncoding" },
+  { Option::What::Command,     "command" },
+  { Option::What::SubscribeId, "subscribeId" },
+  { Option::What::SetPartial,  "setPartial" },
+  { Option::What::Resource,    "resource" },
 };
 
+static constexpr PerfectHash resources { resource_names };
+static_assert(resources.valid(), "no perfect hash for the resource names");
+
+static constexpr PerfectHash options { option_names };
+static_assert(options.valid(), "no perfect hash for the option names");
+
 //----------------------------------------------------
-/// extract resource (first header line)
+/// extract resource, usually the first header field
 int PEHeaderParser::get_resource(Resource &res)
 {
   if ((length > 13) && (strncmp("{\"resource\":\"", cur, 13) == 0))
   {
     advance(13); // skip JSON tag
 
-    for (const auto &c : resources)
+    const auto name_length = quoted_length();
+    if (!name_length)
+      return -1; // malformed header
+
+    if (const auto c = resources.find(cur, name_length))
     {
-      const auto byte_cnt = c.length+1;
+      advance(name_length+1);
+      res = c->value;
+      return 0;
+    }
+    return -2; // resource not supported
+  }
 
-      if ((length > byte_cnt) &&
-          (cur[c.length]=='"') &&
-          (strncmp(c.string, cur, c.length) == 0))
-      {
-        advance(byte_cnt);
-        res = c.resource;
-        return 0;
-      }
+  // any other field first, look for the resource among all of them,
+  // get_next_option then starts over with the first field
+  PEHeaderParser fields { *this };
+  Option o;
+  int result;
+  while ((result = fields.get_next_option(o)) == 0)
+  {
+    if (o.what != Option::What::Resource)
+      continue;
+
+    if (const auto c = resources.find(o.value.string, o.value.length))
+    {
+      res = c->value;
+      return 0;
     }
+    return o.value.length ? -2 : -1;
   }
 
-  return -1; // invalid resource or malformed header
+  return -1; // no resource or malformed header
 }
 
 //----------------------------------------------------
@@ -70,62 +102,106 @@ int PEHeaderParser::get_status(unsigned &status)
 }
 
 //----------------------------------------------------
-/// get next header option (second and following header lines)
+/// get next header option (following the resource, or the first header field)
 int PEHeaderParser::get_next_option(Option &option)
 {
-  if (!length)
-    return -1; // invalid option or malformed header
-  else if (*cur=='}')
+  for (;;)
   {
-    advance(1);
-    return 1; // end of header, no more options
-  }
+    if (!length)
+      return -1; // invalid option or malformed header
+    else if (*cur=='}')
+    {
+      advance(1);
+      return 1; // end of header, no more options
+    }
 
-  if ((length>5) && (cur[0]==',') && (cur[1]=='"'))
-  {
-    advance(2); // skip comma and quote
+    if ((length<=5) || ((cur[0]!=',') && (cur[0]!='{')) || (cur[1]!='"'))
+      return -1; // malformed header
+    advance(2); // skip comma (or opening brace) and quote
 
-    for (const auto &p : options)
+    const auto name_length = quoted_length();
+    if (!name_length)
+      return -1; // malformed header
+
+    const auto p = options.find(cur, name_length);
+    advance(name_length+1);
+
+    if (!length || (*cur!=':'))
+      return -1; // error, exit early
+    advance(1);
+
+    if (!p)
     {
-      const auto byte_cnt = p.length+1;
+      // header properties we do not know are ignored, whatever their value
+      if (!skip_value())
+        return -1;
+      continue;
+    }
+
+    option.what = p->value;
 
-      if ((length > byte_cnt) &&
-          (cur[p.length]=='"') && 
-          (strncmp(p.string, cur, p.length) == 0))
+    if (length && (*cur=='"'))
+      advance(1); // skip quote
+
+    // extract value
+    option.value.string = cur;
+    option.value.length = 0;
+
+    for ( ; length; ++cur,--length,++option.value.length)
+    {
+      if ((*cur=='}') || (*cur==','))
+        return 0;
+      else if (*cur=='"')
       {
-        advance(byte_cnt);
-
-        option.what = p.what;
-
-        if (*cur!=':')
-          break; // error, exit early
-        cur++;
-        --length;
-
-        if (*cur=='"')
-          advance(1); // skip quote
-
-        // extract value
-        option.value.string = cur;
-        option.value.length = 0;
-
-        for ( ; length; ++cur,--length,++option.value.length)
-        {
-          if ((*cur=='}') || (*cur==',')) 
-            return 0;
-          else if (*cur=='"')
-          {
-            advance(1); // skip quote
-            return 0;
-          }
-        }
-
-        break; // error, exit early
+        advance(1); // skip quote
+        return 0;
       }
     }
+
+    return -1; // invalid option or malformed header
   }
+}
+
+//----------------------------------------------------
+/// skip a value up to the next field or the end of the header, false if malformed
+bool PEHeaderParser::skip_value()
+{
+  unsigned depth = 0;
+  bool quoted = false;
 
-  return -1; // invalid option or malformed header
+  for ( ; length; advance(1))
+  {
+    const char c = *cur;
+    if (quoted)
+    {
+      if (c=='\\')
+        advance(1); // skip the escaped character
+      else if (c=='"')
+        quoted = false;
+    }
+    else if (c=='"')
+      quoted = true;
+    else if ((c=='{') || (c=='['))
+      ++depth;
+    else if ((c=='}') || (c==']'))
+    {
+      if (!depth)
+        return c=='}'; // end of header, left for get_next_option
+      --depth;
+    }
+    else if ((c==',') && !depth)
+      return true;
+  }
+
+  return false;
+}
+
+//----------------------------------------------------
+/// length of the name up to the closing quote, 0 if the quote is missing or ends the header
+size_t PEHeaderParser::quoted_length() const
+{
+  const auto quote = static_cast<const char*>(memchr(cur, '"', length));
+  return (quote && (quote + 1 < cur + length)) ? size_t(quote - cur) : 0;
 }
 
 //----------------------------------------------------
@@ -14,6 +14,8 @@ enum class Resource : uint8_t {
   ChannelList,
   ChCtrlList,
   ProgramList,
+  XControlState,
+  XSettings,
   __count__
 };
 
@@ -27,6 +29,10 @@ struct Option {
     Offset,
     ID,
     Encoding,
+    Command,
+    SubscribeId,
+    SetPartial,
+    Resource,
     __count__
   } what { What::None };
 
@@ -53,6 +59,10 @@ struct Option {
  * compile to around 950 instructions and do not include any syntax and sanity
  * checks at all.
  * 
+ * Resource and option names are looked up in compile time generated perfect
+ * hash tables (see PerfectHash.h), so the lookup cost does not grow with
+ * the number of supported resources.
+ * 
  ***/
 class PEHeaderParser {
 public:
@@ -60,28 +70,20 @@ public:
     cur(data), length(len)
   {}
 
+  /// 0: found, -1: no resource or malformed header, -2: resource not supported
   int get_resource(Resource&);
   int get_status(unsigned&);
+  /// 0: next option, 1: end of header, -1: malformed header
+  /// also parses the first header field of headers without resource (e.g. subscription end),
+  /// fields that are no known option are skipped
   int get_next_option(Option&);
 
 private:
   const char *cur { nullptr };
   size_t length { 0 };
 
-  struct ResourceEntry {
-    Resource resource;
-    const char *string;
-    size_t length;
-  };
-  static const ResourceEntry resources[static_cast<unsigned>(Resource::__count__)-1];
-
-  struct OptionEntry {
-    Option::What what;
-    const char *string;
-    size_t length;
-  };
-  static const OptionEntry options[static_cast<unsigned>(Option::What::__count__)-1];
-
+  size_t quoted_length() const;
+  bool skip_value();
   void advance(size_t);
 };
 
@@ -0,0 +1,89 @@
+#include "PEMessage.h"
+
+//----------------------------------------------------
+
+static uint32_t read_muid(const uint8_t *p)
+{
+  return p[0] | (p[1] << 7) | (p[2] << 14) | (uint32_t(p[3]) << 21);
+}
+
+static uint16_t read_uint14(const uint8_t *p)
+{
+  return p[0] | (p[1] << 7);
+}
+
+static uint8_t *write_muid(uint8_t *p, uint32_t muid)
+{
+  for (int i = 0; i < 4; ++i, muid >>= 7)
+    *p++ = muid & 0x7F;
+  return p;
+}
+
+static uint8_t *write_uint14(uint8_t *p, size_t v)
+{
+  *p++ = v & 0x7F;
+  *p++ = (v >> 7) & 0x7F;
+  return p;
+}
+
+//----------------------------------------------------
+
+bool PEMessage::parse(const uint8_t *payload, size_t size)
+{
+  if ((size < overhead) || (payload[1] != ci_sub_id))
+    return false;
+
+  device_id = payload[0];
+  subtype = payload[2];
+  version = payload[3];
+  source_muid = read_muid(payload + 4);
+  destination_muid = read_muid(payload + 8);
+  request_id = payload[12];
+
+  const size_t header_size = read_uint14(payload + 13);
+  if (size < overhead + header_size)
+    return false;
+  header = { reinterpret_cast<const char*>(payload + 15), header_size };
+
+  const uint8_t *p = payload + 15 + header_size;
+  num_chunks = read_uint14(p);
+  chunk_number = read_uint14(p + 2);
+  const size_t data_size = read_uint14(p + 4);
+  if (size < overhead + header_size + data_size)
+    return false;
+  data = { reinterpret_cast<const char*>(p + 6), data_size };
+
+  return (chunk_number >= 1) && (chunk_number <= num_chunks);
+}
+
+//----------------------------------------------------
+
+size_t PEMessage::write(uint8_t *dst, size_t size) const
+{
+  if ((header.size() > 0x3FFF) || (data.size() > 0x3FFF) ||
+      (size < overhead + header.size() + data.size()))
+    return 0;
+
+  uint8_t *p = dst;
+  *p++ = device_id;
+  *p++ = ci_sub_id;
+  *p++ = subtype;
+  *p++ = version;
+  p = write_muid(p, source_muid);
+  p = write_muid(p, destination_muid);
+  *p++ = request_id & 0x7F;
+
+  p = write_uint14(p, header.size());
+  for (const char c : header)
+    *p++ = uint8_t(c);
+
+  p = write_uint14(p, num_chunks);
+  p = write_uint14(p, chunk_number);
+  p = write_uint14(p, data.size());
+  for (const char c : data)
+    *p++ = uint8_t(c);
+
+  return p - dst;
+}
+
+//----------------------------------------------------
@@ -0,0 +1,123 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//----------------------------------------------------
+/// MIDI-CI Property Exchange message (Set Property Data, Subscription)
+/***
+ *
+ * All Property Exchange messages share one layout following the Universal
+ * SysEx header: request id, header, number of chunks, chunk number and
+ * property data. parse() and write() operate on the SysEx payload starting
+ * with the device id (i.e. midi::sysex7::data of a Universal SysEx message),
+ * header and data of parsed messages point into the parsed payload.
+ *
+ ***/
+struct PEMessage {
+  /// Property Exchange subtypes handled here
+  enum Subtype : uint8_t {
+    set_property_data_inquiry = 0x36,
+    set_property_data_reply   = 0x37,
+    subscription_inquiry      = 0x38,
+    subscription_reply        = 0x39,
+  };
+
+  static constexpr uint8_t ci_sub_id { 0x0D };
+  static constexpr uint8_t ci_version { 0x02 };
+  /// message fields besides header and data
+  static constexpr size_t overhead { 21 };
+
+  uint8_t device_id { 0x7F };
+  uint8_t subtype { 0 };
+  uint8_t version { ci_version };
+  uint32_t source_muid { 0 };
+  uint32_t destination_muid { 0 };
+  uint8_t request_id { 0 };
+  std::string_view header;
+  uint16_t num_chunks { 1 };
+  uint16_t chunk_number { 1 };
+  std::string_view data;
+
+  /// returns false for truncated or otherwise malformed messages
+  bool parse(const uint8_t *payload, size_t size);
+  /// returns the number of bytes written, 0 if the message does not fit
+  size_t write(uint8_t *dst, size_t size) const;
+};
+
+//----------------------------------------------------
+/// reassembles the chunks of a Set Property Data inquiry
+/***
+ *
+ * Only one request is assembled at a time (we advertise a single
+ * simultaneous request), a first chunk restarts the assembly. The header of
+ * the first chunk is kept, the data of all chunks is concatenated.
+ *
+ ***/
+template <size_t max_header_size, size_t max_data_size>
+class PEChunkAssembler {
+public:
+  enum Result : uint8_t {
+    incomplete,
+    complete,
+    out_of_sequence,
+    too_large,
+  };
+
+  Result add(const PEMessage &m)
+  {
+    if (m.chunk_number == 1)
+    {
+      source_muid = m.source_muid;
+      request_id = m.request_id;
+      next_chunk = 1;
+      data_size = 0;
+
+      header_size = (m.header.size() <= max_header_size) ? m.header.size() : 0;
+      overflow = (m.header.size() > max_header_size);
+      for (size_t i = 0; i < header_size; ++i)
+        header_buffer[i] = m.header[i];
+    }
+    else if (!next_chunk || (m.chunk_number != next_chunk) ||
+             (m.source_muid != source_muid) || (m.request_id != request_id))
+    {
+      return out_of_sequence;
+    }
+
+    if (data_size + m.data.size() <= max_data_size)
+    {
+      for (size_t i = 0; i < m.data.size(); ++i)
+        data_buffer[data_size++] = uint8_t(m.data[i]);
+    }
+    else
+      overflow = true;
+
+    if (m.chunk_number < m.num_chunks)
+    {
+      ++next_chunk;
+      return incomplete;
+    }
+
+    next_chunk = 0;
+    return overflow ? too_large : complete;
+  }
+
+  std::string_view header() const { return { header_buffer, header_size }; }
+  uint8_t *data() { return data_buffer; }
+  size_t size() const { return data_size; }
+
+private:
+  uint32_t source_muid { 0 };
+  uint8_t request_id { 0 };
+  uint16_t next_chunk { 0 }; // 0: no assembly in progress
+  bool overflow { false };
+  size_t header_size { 0 };
+  size_t data_size { 0 };
+  char header_buffer[max_header_size];
+  uint8_t data_buffer[max_data_size];
+};
+
+//----------------------------------------------------
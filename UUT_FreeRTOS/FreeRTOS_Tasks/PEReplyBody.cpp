@@ -0,0 +1,109 @@
+#include "PEReplyBody.h"
+
+#include <cstring>
+
+//----------------------------------------------------
+
+static const std::string_view encodings[] = {
+  "ASCII",
+  "Mcoded7",
+  "zlib+Mcoded7",
+};
+
+Encoding parse_encoding(const char *string, size_t length)
+{
+  for (size_t e = 0; e < static_cast<size_t>(Encoding::__count__); ++e)
+  {
+    if (encodings[e] == std::string_view{ string, length })
+      return static_cast<Encoding>(e);
+  }
+
+  return Encoding::ASCII;
+}
+
+std::string_view encoding_name(Encoding e)
+{
+  return encodings[static_cast<size_t>(e)];
+}
+
+//----------------------------------------------------
+
+PEReplyBody::PEReplyBody(std::string_view v) :
+  value(v), total_size(v.size())
+{}
+
+PEReplyBody::PEReplyBody(const std::string_view *e, size_t n, size_t offset, size_t limit)
+{
+  if (offset > n)
+    offset = n;
+  if (limit > n - offset)
+    limit = n - offset;
+
+  entries = e + offset;
+  num_entries = limit;
+
+  // brackets and separators
+  total_size = 2 + (num_entries ? num_entries - 1 : 0);
+  for (size_t i = 0; i < num_entries; ++i)
+    total_size += entries[i].size();
+}
+
+//----------------------------------------------------
+
+size_t PEReplyBody::num_chunks(size_t chunk_size) const
+{
+  return total_size ? (total_size + chunk_size - 1) / chunk_size : 1;
+}
+
+//----------------------------------------------------
+/// copy a byte range of the concatenation of all pieces
+size_t PEReplyBody::read(size_t pos, char *dst, size_t max_length) const
+{
+  size_t num_copied = 0;
+  size_t piece_pos = 0;
+
+  for (size_t i = 0; (i < num_pieces()) && (num_copied < max_length); ++i)
+  {
+    const auto p = piece(i);
+    const size_t piece_end = piece_pos + p.size();
+
+    if (pos + num_copied < piece_end)
+    {
+      const size_t from = pos + num_copied - piece_pos;
+      size_t n = p.size() - from;
+      if (n > max_length - num_copied)
+        n = max_length - num_copied;
+
+      memcpy(dst + num_copied, p.data() + from, n);
+      num_copied += n;
+    }
+
+    piece_pos = piece_end;
+  }
+
+  return num_copied;
+}
+
+//----------------------------------------------------
+/// a list is "[", entry, ",", entry, ..., "]"
+size_t PEReplyBody::num_pieces() const
+{
+  if (!entries)
+    return 1;
+
+  return num_entries ? 2 * num_entries + 1 : 2;
+}
+
+std::string_view PEReplyBody::piece(size_t i) const
+{
+  if (!entries)
+    return value;
+
+  if (i == 0)
+    return "[";
+  if (i == num_pieces() - 1)
+    return "]";
+  return ((i - 1) & 1) ? std::string_view{ "," } : entries[(i - 1) / 2];
+}
+
+//----------------------------------------------------
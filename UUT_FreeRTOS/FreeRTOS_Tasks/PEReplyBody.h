@@ -0,0 +1,104 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include "Deflate.h"
+#include "Mcoded7.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//----------------------------------------------------
+/// supported body encodings (mutualEncoding)
+enum class Encoding : uint8_t {
+  ASCII = 0,
+  Mcoded7,
+  ZlibMcoded7,
+  __count__
+};
+
+/// unknown encodings fall back to ASCII
+Encoding parse_encoding(const char *string, size_t length);
+std::string_view encoding_name(Encoding);
+
+//----------------------------------------------------
+/// Property Exchange reply body, read in chunks
+/***
+ *
+ * The body is either a single JSON value or a JSON array assembled from a
+ * page (offset / limit) of list entries. Nothing is copied up front, each
+ * read copies just the requested byte range, so arbitrary large resources
+ * can be streamed out in chunks through a small, fixed size buffer.
+ *
+ * encode() streams the body through an optional zlib / Mcoded7 encoding
+ * and passes the resulting bytes to a sink one at a time.
+ *
+ ***/
+class PEReplyBody {
+public:
+  /// single JSON value
+  explicit PEReplyBody(std::string_view value);
+  /// JSON array of entries [offset, offset+limit)
+  PEReplyBody(const std::string_view *entries, size_t numEntries, size_t offset, size_t limit);
+
+  size_t size() const { return total_size; }
+  size_t num_chunks(size_t chunk_size) const;
+
+  /// copy up to max_length bytes starting at pos to dst, returns the number of bytes copied
+  size_t read(size_t pos, char *dst, size_t max_length) const;
+
+  template <typename Sink>
+  void encode(Encoding, Sink&) const;
+
+private:
+  std::string_view value;
+  const std::string_view *entries { nullptr };
+  size_t num_entries { 0 };
+  size_t total_size { 0 };
+
+  size_t num_pieces() const;
+  std::string_view piece(size_t) const;
+
+  template <typename Sink>
+  void for_each_byte(Sink&) const;
+};
+
+//----------------------------------------------------
+
+template <typename Sink>
+void PEReplyBody::for_each_byte(Sink &sink) const
+{
+  for (size_t i = 0; i < num_pieces(); ++i)
+    for (const char c : piece(i))
+      sink(uint8_t(c));
+}
+
+template <typename Sink>
+void PEReplyBody::encode(Encoding encoding, Sink &sink) const
+{
+  switch (encoding)
+  {
+  case Encoding::Mcoded7:
+  {
+    Mcoded7Encoder<Sink> mcoded7 { sink };
+    for_each_byte(mcoded7);
+    mcoded7.flush();
+    break;
+  }
+  case Encoding::ZlibMcoded7:
+  {
+    Mcoded7Encoder<Sink> mcoded7 { sink };
+    DeflateEncoder<Mcoded7Encoder<Sink>> zlib { mcoded7 };
+    for_each_byte(zlib);
+    zlib.finish();
+    mcoded7.flush();
+    break;
+  }
+  default:
+    for_each_byte(sink);
+    break;
+  }
+}
+
+//----------------------------------------------------
@@ -0,0 +1,75 @@
+#include "PESubscriptions.h"
+
+//----------------------------------------------------
+
+uint8_t PESubscriptions::start(uint32_t muid, Resource resource, const ControlState::Snapshot &current, uint32_t now)
+{
+  if (num_active == max_subscriptions)
+    return 0;
+
+  // subscribe ids cycle through 1..127, skipping those still in use
+  for (bool in_use = true; in_use; next_id = (next_id < 127) ? next_id + 1 : 1)
+  {
+    in_use = false;
+    for (const auto &s : subscriptions)
+      in_use |= (s.id == next_id);
+    if (!in_use)
+      break;
+  }
+
+  for (auto &s : subscriptions)
+  {
+    if (s.id)
+      continue;
+
+    s.muid = muid;
+    s.resource = resource;
+    s.id = next_id;
+    s.notified = current;
+    s.last_notify = now - interval; // first change is notified right away
+
+    next_id = (next_id < 127) ? next_id + 1 : 1;
+    ++num_active;
+    return s.id;
+  }
+
+  return 0;
+}
+
+//----------------------------------------------------
+
+bool PESubscriptions::end(uint32_t muid, uint8_t id)
+{
+  for (auto &s : subscriptions)
+  {
+    if (s.id && (s.id == id) && (s.muid == muid))
+    {
+      s.id = 0;
+      --num_active;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PESubscriptions::end_all(uint32_t muid)
+{
+  for (auto &s : subscriptions)
+  {
+    if (s.id && (s.muid == muid))
+    {
+      s.id = 0;
+      --num_active;
+    }
+  }
+}
+
+//----------------------------------------------------
+
+void PESubscriptions::set_notify_interval(uint32_t i)
+{
+  interval = (i < min_notify_interval) ? min_notify_interval : i;
+}
+
+//----------------------------------------------------
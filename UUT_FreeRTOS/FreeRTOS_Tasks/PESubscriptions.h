@@ -0,0 +1,105 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include "ControlState.h"
+#include "PEHeaderParser.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------
+/// Property Exchange subscriber table
+/***
+ *
+ * Keeps the subscriptions of one endpoint. Subscribers of X-ControlState
+ * are notified with the changed controls only (a "partial" notification),
+ * at most once per notify interval: changes in between are coalesced, the
+ * next notification carries the latest values. This way a subscriber never
+ * sees more traffic than the interval permits, however fast the pots move.
+ *
+ ***/
+class PESubscriptions {
+public:
+  static constexpr uint8_t max_subscriptions { 4 };
+  static constexpr uint32_t default_notify_interval { 20000 }; // us
+  static constexpr uint32_t min_notify_interval { 5000 };      // us
+
+  struct Subscription {
+    uint32_t muid { 0 };
+    Resource resource { Resource::None };
+    uint8_t id { 0 }; // 0: unused
+    uint32_t last_notify { 0 };
+    ControlState::Snapshot notified; // state the subscriber knows about
+  };
+
+  /// returns the subscribe id, 0 if all subscriptions are in use
+  uint8_t start(uint32_t muid, Resource, const ControlState::Snapshot &current, uint32_t now);
+  /// returns false for unknown subscriptions
+  bool end(uint32_t muid, uint8_t id);
+  /// drop all subscriptions of a (invalidated) MUID
+  void end_all(uint32_t muid);
+
+  /// call notify(subscription, previous) for every X-ControlState subscription due for a notification
+  template <typename Notify>
+  void poll(const ControlState::Snapshot &current, uint32_t now, Notify notify);
+
+  /// call f(subscription) for all subscriptions of resource
+  template <typename F>
+  void for_each(Resource, F f);
+
+  uint32_t notify_interval() const { return interval; }
+  void set_notify_interval(uint32_t);
+
+  bool empty() const { return num_active == 0; }
+
+private:
+  Subscription subscriptions[max_subscriptions];
+  uint8_t num_active { 0 };
+  uint8_t next_id { 1 };
+  uint32_t interval { default_notify_interval };
+};
+
+//----------------------------------------------------
+
+template <typename Notify>
+void PESubscriptions::poll(const ControlState::Snapshot &current, uint32_t now, Notify notify)
+{
+  for (auto &s : subscriptions)
+  {
+    if (!s.id || (s.resource != Resource::XControlState) || (s.notified.version == current.version))
+      continue;
+
+    if (now - s.last_notify < interval)
+      continue; // coalesce with later changes
+
+    if (s.notified.caps == current.caps)
+    {
+      bool changed = false;
+      for (uint8_t p = 0; p < ControlState::numPots; ++p)
+        changed |= (s.notified.pots[p] != current.pots[p]);
+      if (!changed)
+      {
+        s.notified.version = current.version; // changed back, nothing to report
+        continue;
+      }
+    }
+
+    const ControlState::Snapshot previous = s.notified;
+    s.notified = current;
+    s.last_notify = now;
+    notify(s, previous);
+  }
+}
+
+template <typename F>
+void PESubscriptions::for_each(Resource resource, F f)
+{
+  for (auto &s : subscriptions)
+  {
+    if (s.id && (s.resource == resource))
+      f(s);
+  }
+}
+
+//----------------------------------------------------
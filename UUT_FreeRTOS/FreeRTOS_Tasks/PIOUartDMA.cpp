@@ -0,0 +1,219 @@
+#include "PIOUartDMA.h"
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "uart_rx.pio.h"
+#include "uart_tx.pio.h"
+
+#include <cstring>
+
+static constexpr uint8_t maxUarts { 8 };
+static PIOUartDMA *uarts[maxUarts];
+static uint8_t numUarts = 0;
+
+// programs are shared by all state machines of a PIO block
+static int rxProgramOffset[NUM_PIOS] { -1, -1 };
+static int txProgramOffset[NUM_PIOS] { -1, -1 };
+
+static spin_lock_t *txLock = nullptr;
+
+// the TX FIFO is not joined, a byte written ahead waits for at most 4 bytes
+static constexpr uint txFifoDepth { 4 };
+
+void PIOUartDMA::init(PIO pio, uint smRx, uint pinRx, uint smTx, uint pinTx, uint baud,
+                      notifyProc *notify, void *context)
+{
+    m_pio = pio;
+    m_smRx = smRx;
+    m_smTx = smTx;
+    m_notify = notify;
+    m_context = context;
+
+    if (!txLock)
+    {
+        txLock = spin_lock_instance(spin_lock_claim_unused(true));
+        irq_add_shared_handler(DMA_IRQ_0, dmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+
+    const uint p = pio_get_index(pio);
+    if (rxProgramOffset[p] < 0)
+    {
+        rxProgramOffset[p] = pio_add_program(pio, &uart_rx_program);
+        txProgramOffset[p] = pio_add_program(pio, &uart_tx_program);
+
+        const uint irq = p ? PIO1_IRQ_0 : PIO0_IRQ_0;
+        irq_add_shared_handler(irq, pioIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq, true);
+    }
+
+    uart_rx_program_init(pio, smRx, rxProgramOffset[p], pinRx, baud);
+    uart_tx_program_init(pio, smTx, txProgramOffset[p], pinTx, baud);
+    // the DMA keeps the FIFO full, uart_tx joins it to 8 bytes, which writeUrgent had to wait for
+    hw_clear_bits(&pio->sm[smTx].shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_TX_BITS);
+    m_byteTimeUs = (10 * 1000000 + baud - 1) / baud;
+
+    // receive: the data byte is left justified in the FIFO word, read the uppermost byte lane
+    m_dmaRx = dma_claim_unused_channel(true);
+    dma_channel_config rx = dma_channel_get_default_config(m_dmaRx);
+    channel_config_set_transfer_data_size(&rx, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx, false);
+    channel_config_set_write_increment(&rx, true);
+    channel_config_set_ring(&rx, true, __builtin_ctz(rxBufferSize));
+    channel_config_set_dreq(&rx, pio_get_dreq(pio, smRx, false));
+    dma_channel_configure(m_dmaRx, &rx, m_rxBuffer, reinterpret_cast<const io_rw_8*>(&pio->rxf[smRx]) + 3,
+                          0xFFFFFFFF, false);
+
+    // send: byte writes get replicated to all byte lanes, uart_tx shifts out the lowest one
+    m_dmaTx = dma_claim_unused_channel(true);
+    dma_channel_config tx = dma_channel_get_default_config(m_dmaTx);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_8);
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_ring(&tx, false, __builtin_ctz(txBufferSize));
+    channel_config_set_dreq(&tx, pio_get_dreq(pio, smTx, true));
+    dma_channel_configure(m_dmaTx, &tx, &pio->txf[smTx], m_txBuffer, 0, false);
+
+    uarts[numUarts++] = this;
+    dma_channel_set_irq0_enabled(m_dmaRx, true);
+    dma_channel_set_irq0_enabled(m_dmaTx, true);
+    dma_channel_start(m_dmaRx);
+}
+
+size_t PIOUartDMA::rxHead() const
+{
+    const uintptr_t writeAddr = dma_channel_hw_addr(m_dmaRx)->write_addr;
+    return (writeAddr - reinterpret_cast<uintptr_t>(m_rxBuffer)) & (rxBufferSize - 1);
+}
+
+size_t PIOUartDMA::read(uint8_t *dst, size_t maxBytes)
+{
+    const size_t head = rxHead();
+    size_t numBytes = (head - m_rxTail) & (rxBufferSize - 1);
+    if (numBytes > maxBytes)
+        numBytes = maxBytes;
+
+    // at most two contiguous pieces
+    const size_t first = (rxBufferSize - m_rxTail < numBytes) ? rxBufferSize - m_rxTail : numBytes;
+    memcpy(dst, m_rxBuffer + m_rxTail, first);
+    memcpy(dst + first, m_rxBuffer, numBytes - first);
+
+    m_rxTail = (m_rxTail + numBytes) & (rxBufferSize - 1);
+    return numBytes;
+}
+
+bool PIOUartDMA::armReceiveNotification()
+{
+    pio_set_irq0_source_enabled(m_pio, pio_interrupt_source(pis_sm0_rx_fifo_not_empty + m_smRx), true);
+
+    // bytes the DMA moved between the last read and now raised no interrupt
+    return rxHead() == m_rxTail;
+}
+
+bool PIOUartDMA::write(const uint8_t *bytes, size_t numBytes)
+{
+    if (numBytes > txSpace())
+        return false;
+
+    // only the task writes m_txHead, the DMA interrupt only reads it
+    const size_t head = m_txHead & (txBufferSize - 1);
+    const size_t first = (txBufferSize - head < numBytes) ? txBufferSize - head : numBytes;
+    memcpy(m_txBuffer + head, bytes, first);
+    memcpy(m_txBuffer, bytes + first, numBytes - first);
+
+    const uint32_t irqState = spin_lock_blocking(txLock);
+    m_txHead = m_txHead + numBytes;
+    startSending();
+    spin_unlock(txLock, irqState);
+
+    return true;
+}
+
+bool PIOUartDMA::writeUrgent(uint8_t byte)
+{
+    // pause the send channel, a cleared EN keeps the running transfer pending
+    uint32_t irqState = spin_lock_blocking(txLock);
+    hw_clear_bits(&dma_hw->ch[m_dmaTx].al1_ctrl, DMA_CH0_CTRL_TRIG_EN_BITS);
+    spin_unlock(txLock, irqState);
+
+    // the FIFO drains by one byte per byte time. The channel may still complete
+    // a write it issued before the pause, leave a FIFO slot for that.
+    const uint32_t start = time_us_32();
+    bool fits;
+    while (!(fits = (pio_sm_get_tx_fifo_level(m_pio, m_smTx) < txFifoDepth - 1))
+           && (time_us_32() - start < 2 * m_byteTimeUs))
+        tight_loop_contents();
+    if (fits)
+        pio_sm_put(m_pio, m_smTx, byte);
+
+    irqState = spin_lock_blocking(txLock);
+    hw_set_bits(&dma_hw->ch[m_dmaTx].al1_ctrl, DMA_CH0_CTRL_TRIG_EN_BITS);
+    // the DMA interrupt may have chained a transfer meanwhile, its trigger got ignored
+    // (a completion the interrupt has not handled yet still chains normally)
+    if (m_txInFlight && !dma_channel_is_busy(m_dmaTx) && !dma_channel_get_irq0_status(m_dmaTx))
+        dma_channel_set_trans_count(m_dmaTx, m_txInFlight, true);
+    spin_unlock(txLock, irqState);
+
+    return fits;
+}
+
+void PIOUartDMA::startSending()
+{
+    if (m_txInFlight || (m_txHead == m_txTail))
+        return;
+
+    // the read ring wraps around the end of the buffer
+    m_txInFlight = m_txHead - m_txTail;
+    dma_channel_set_read_addr(m_dmaTx, m_txBuffer + (m_txTail & (txBufferSize - 1)), false);
+    dma_channel_set_trans_count(m_dmaTx, m_txInFlight, true);
+}
+
+void PIOUartDMA::dmaIrqHandler()
+{
+    for (uint8_t u = 0; u < numUarts; ++u)
+    {
+        PIOUartDMA &uart = *uarts[u];
+
+        if (dma_channel_get_irq0_status(uart.m_dmaRx))
+        {
+            // 2^32 - 1 bytes received, continue at the current write address
+            dma_channel_acknowledge_irq0(uart.m_dmaRx);
+            dma_channel_set_trans_count(uart.m_dmaRx, 0xFFFFFFFF, true);
+        }
+
+        if (dma_channel_get_irq0_status(uart.m_dmaTx))
+        {
+            dma_channel_acknowledge_irq0(uart.m_dmaTx);
+
+            // chain the bytes queued while the last transfer was running
+            spin_lock_unsafe_blocking(txLock);
+            uart.m_txTail = uart.m_txTail + uart.m_txInFlight;
+            uart.m_txInFlight = 0;
+            uart.startSending();
+            spin_unlock_unsafe(txLock);
+
+            uart.m_notify(uart.m_context);
+        }
+    }
+}
+
+void PIOUartDMA::pioIrqHandler()
+{
+    for (uint8_t u = 0; u < numUarts; ++u)
+    {
+        PIOUartDMA &uart = *uarts[u];
+
+        // RX FIFO not empty is level triggered, armReceiveNotification re-enables it.
+        // The DMA may have drained the FIFO already, so received bytes count as well.
+        const auto source = pio_interrupt_source(pis_sm0_rx_fifo_not_empty + uart.m_smRx);
+        const uint32_t bit = 1u << source;
+        if ((uart.m_pio->inte0 & bit) && ((uart.m_pio->ints0 & bit) || (uart.rxHead() != uart.m_rxTail)))
+        {
+            pio_set_irq0_source_enabled(uart.m_pio, source, false);
+            uart.m_notify(uart.m_context);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef PIOUARTDMA_H
+#define PIOUARTDMA_H
+
+#include "hardware/pio.h"
+
+#include <cstddef>
+#include <cstdint>
+
+//! UART on a pair of PIO state machines (uart_rx / uart_tx programs), fed by DMA
+/***
+ *
+ * Receiving: a DMA channel moves every byte the uart_rx state machine
+ * pushes into a ring buffer, its write pointer is the producer index. read
+ * only compares it with the consumer index, no byte is touched by the CPU
+ * before it gets parsed.
+ *
+ * Sending: write queues bytes in a ring buffer, a DMA channel clocks them
+ * out through the uart_tx state machine. Whenever a transfer completes, the
+ * DMA interrupt chains the next one for the bytes queued meanwhile. write
+ * never waits for the wire, it refuses bytes that do not fit.
+ *
+ * writeUrgent puts a single byte straight into the transmitter FIFO, ahead
+ * of all bytes waiting in the ring buffer, e.g. MIDI real time messages,
+ * which may be sent between the bytes of any other message. It waits for a
+ * FIFO slot at most two byte times (0.64 ms at 31250 baud) instead of the
+ * whole queue (up to 82 ms), and fails if none got free in time.
+ *
+ * notify is called from interrupt context when bytes got received (once
+ * per burst, re-armed by armReceiveNotification) and when queued bytes
+ * have been sent, typically to wake up the task serving the port.
+ *
+ ***/
+class PIOUartDMA
+{
+public:
+    typedef void notifyProc(void *context);
+
+    static constexpr size_t rxBufferSize { 256 }; //!< power of two
+    static constexpr size_t txBufferSize { 256 }; //!< power of two
+
+    //! load the programs (if not yet loaded on pio), claim the DMA channels and start the state machines
+    void init(PIO pio, uint smRx, uint pinRx, uint smTx, uint pinTx, uint baud,
+              notifyProc *notify, void *context);
+
+    //! copy up to maxBytes received bytes to dst, returns the number of bytes copied
+    size_t read(uint8_t *dst, size_t maxBytes);
+
+    //! queue bytes for sending, returns false (queuing nothing) if they do not fit
+    bool write(const uint8_t *bytes, size_t numBytes);
+    size_t txSpace() const { return txBufferSize - size_t(m_txHead - m_txTail); }
+
+    //! send byte ahead of the queued bytes, waits up to two byte times for room in the
+    //! transmitter FIFO, returns false if there is none
+    bool writeUrgent(uint8_t byte);
+
+    //! notify on the next received byte, call after read returned all received bytes,
+    //! returns false if bytes arrived meanwhile (read again)
+    bool armReceiveNotification();
+
+private:
+    static void dmaIrqHandler();
+    static void pioIrqHandler();
+    void startSending(); // call with the tx spin lock held
+    size_t rxHead() const;
+
+    PIO m_pio { nullptr };
+    uint m_smRx { 0 };
+    uint m_smTx { 0 };
+    int m_dmaRx { -1 };
+    int m_dmaTx { -1 };
+    uint32_t m_byteTimeUs { 0 };
+    notifyProc *m_notify { nullptr };
+    void *m_context { nullptr };
+
+    size_t m_rxTail { 0 };               // consumer index
+    volatile uint32_t m_txHead { 0 };    // free running, written by the task
+    volatile uint32_t m_txTail { 0 };    // free running, advanced by the DMA interrupt
+    volatile uint32_t m_txInFlight { 0 };
+
+    alignas(rxBufferSize) uint8_t m_rxBuffer[rxBufferSize];
+    alignas(txBufferSize) uint8_t m_txBuffer[txBufferSize];
+};
+
+#endif // PIOUARTDMA_H
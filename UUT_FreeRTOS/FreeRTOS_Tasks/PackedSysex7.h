@@ -0,0 +1,70 @@
+#ifndef PACKEDSYSEX7_H
+#define PACKEDSYSEX7_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! System exclusive message packed into SysEx7 UMPs ahead of time
+/***
+ *
+ * Replies that only differ in a few fields (MIDI-CI discovery replies, ...)
+ * are packed once, ideally by a constexpr constructor at compile time.
+ * Sending one means copying the words, patching the variable fields in
+ * place with setGroup / setByte / setMUID and handing the words to the transport:
+ * no sysex7 is assembled, nothing is allocated, and the cost no longer
+ * depends on how the message would be split into packets.
+ *
+ * bytes excludes F0 and F7, byte indices refer to bytes.
+ *
+ ***/
+template <size_t numBytes>
+class PackedSysex7
+{
+public:
+    static constexpr size_t numPackets { (numBytes + 5) / 6 };
+    static constexpr size_t numWords { 2 * numPackets };
+
+    constexpr explicit PackedSysex7(const uint8_t (&bytes)[numBytes], uint8_t group = 0)
+    {
+        for (size_t p = 0; p < numPackets; ++p)
+        {
+            const size_t remaining = numBytes - 6 * p;
+            const uint8_t status = (numPackets == 1) ? 0x0 : (p == 0) ? 0x1 : (p + 1 < numPackets) ? 0x2 : 0x3;
+            m_words[2 * p] = 0x30000000 | (uint32_t(group & 0x0F) << 24) | (uint32_t(status) << 20) |
+                             (uint32_t((remaining < 6) ? remaining : 6) << 16);
+        }
+
+        for (size_t i = 0; i < numBytes; ++i)
+            setByte(i, bytes[i]);
+    }
+
+    constexpr void setByte(size_t index, uint8_t value)
+    {
+        uint32_t &w = m_words[wordIndex(index)];
+        w = (w & ~(uint32_t(0xFF) << shift(index))) | (uint32_t(value & 0x7F) << shift(index));
+    }
+
+    constexpr void setGroup(uint8_t group)
+    {
+        for (size_t p = 0; p < numPackets; ++p)
+            m_words[2 * p] = (m_words[2 * p] & 0xF0FFFFFF) | (uint32_t(group & 0x0F) << 24);
+    }
+
+    //! 28 bit MUID, 7 bits per byte, least significant first
+    constexpr void setMUID(size_t index, uint32_t muid)
+    {
+        for (size_t i = 0; i < 4; ++i, muid >>= 7)
+            setByte(index + i, muid & 0x7F);
+    }
+
+    const uint32_t *words() const { return m_words; }
+
+private:
+    uint32_t m_words[numWords] {};
+
+    // six bytes per packet, two in the first word after the status / size byte, four in the second
+    static constexpr size_t wordIndex(size_t i) { return 2 * (i / 6) + (((i % 6) < 2) ? 0 : 1); }
+    static constexpr unsigned shift(size_t i) { return ((i % 6) < 2) ? 8 * (1 - (i % 6)) : 8 * (5 - (i % 6)); }
+};
+
+#endif // PACKEDSYSEX7_H
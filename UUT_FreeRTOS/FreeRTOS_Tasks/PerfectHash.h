@@ -0,0 +1,118 @@
+#pragma once
+
+//----------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+//----------------------------------------------------
+/// keyword and the value it stands for
+template <typename T>
+struct Keyword {
+  T value;
+  std::string_view string;
+};
+
+/// default table size, a power of two with at most 25% of the slots in use
+constexpr size_t perfect_hash_slots(size_t num_keywords)
+{
+  size_t n = 1;
+  while (n < 4 * num_keywords)
+    n <<= 1;
+  return n;
+}
+
+//----------------------------------------------------
+/// compile time generated perfect hash table for small keyword sets
+/***
+ *
+ * The hash key is the keyword length plus its first and last character,
+ * mixed with a seed that the constructor searches for at compile time until
+ * no two keywords share a slot. A lookup is one hash, one table read and
+ * a single memcmp to confirm, independent of the number of keywords.
+ *
+ * Construct instances constexpr and static_assert(valid()): keyword sets
+ * without a perfect hash (e.g. two keywords with the same length, first and
+ * last character) are rejected at compile time.
+ *
+ ***/
+template <typename T, size_t num_keywords, size_t num_slots = perfect_hash_slots(num_keywords)>
+class PerfectHash {
+public:
+  static_assert(num_keywords < 255, "too many keywords");
+  static_assert((num_slots & (num_slots - 1)) == 0, "num_slots must be a power of two");
+
+  constexpr explicit PerfectHash(const Keyword<T> (&k)[num_keywords])
+  {
+    for (size_t i = 0; i < num_keywords; ++i)
+      keywords[i] = k[i];
+
+    for (uint32_t s = 0; s < max_seed; ++s)
+    {
+      if (try_seed(s))
+      {
+        seed = s;
+        return;
+      }
+    }
+
+    seed = max_seed;
+  }
+
+  constexpr bool valid() const { return seed != max_seed; }
+
+  /// returns nullptr for unknown strings
+  const Keyword<T> *find(const char *string, size_t length) const
+  {
+    if (!length)
+      return nullptr;
+
+    const uint8_t s = slots[hash(seed, length, string[0], string[length - 1])];
+    if (!s)
+      return nullptr;
+
+    const auto &k = keywords[s - 1];
+    return ((k.string.size() == length) && (memcmp(k.string.data(), string, length) == 0)) ? &k : nullptr;
+  }
+
+private:
+  static constexpr uint32_t max_seed { 1024 };
+
+  Keyword<T> keywords[num_keywords] {};
+  uint8_t slots[num_slots] {}; // keyword index + 1, 0 is empty
+  uint32_t seed { 0 };
+
+  static constexpr size_t hash(uint32_t seed, size_t length, char first, char last)
+  {
+    // FNV-1a over the key bytes
+    uint32_t h = 2166136261u ^ seed;
+    h = (h ^ uint8_t(length)) * 16777619u;
+    h = (h ^ uint8_t(first)) * 16777619u;
+    h = (h ^ uint8_t(last)) * 16777619u;
+    return (h ^ (h >> 16)) & (num_slots - 1);
+  }
+
+  constexpr bool try_seed(uint32_t s)
+  {
+    for (auto &slot : slots)
+      slot = 0;
+
+    for (size_t i = 0; i < num_keywords; ++i)
+    {
+      const auto &k = keywords[i].string;
+      if (k.empty())
+        return false;
+
+      auto &slot = slots[hash(s, k.size(), k.front(), k.back())];
+      if (slot)
+        return false;
+      slot = uint8_t(i + 1);
+    }
+
+    return true;
+  }
+};
+
+//----------------------------------------------------
@@ -1,29 +1,59 @@
 #include "PicoMainTask.h"
 
 #include "include/interchip.h"
-#include "hardware/adc.h"
+#include "hardware/irq.h"
 
 #include "FreeRTOS.h"
+#include "FreeRTOS_Tasks.h"
 #include "task.h"
 
+#include "Board.h"
+#include "ControlState.h"
+#include "JitterReduction.h"
+#include "UMPSources.h"
+
 #include <midi/channel_voice_message.h>
 
 #include <stdio.h>
 
 interchip mainPico;
-UMPRingBuffer<32> ControlMessageBuffer;
+UMPRingBuffer<128> ControlMessageBuffer;
+static const uint8_t controlSource = umpSources.add(ControlMessageBuffer, "Control", midi::protocol::midi2);
+static JRIngressStamp controlIngressStamp;
+
+static void writeControlMessage(const midi::universal_packet &p)
+{
+    controlIngressStamp.write(ControlMessageBuffer, p, board::timeUs());
+}
 
-static void generateRandomSeed();
 static void buttonDown(uint8_t button);
 static void buttonUp(uint8_t button);
 static void encoder(int dir);
 static void analog(uint8_t pot, uint16_t value);
 
+static TaskHandle_t picoMainTask = nullptr;
+
+static inline void spi_rx_irq_enable(bool enabled)
+{
+    constexpr uint32_t rxIrqs = SPI_SSPIMSC_RXIM_BITS | SPI_SSPIMSC_RTIM_BITS;
+    if (enabled)
+        hw_set_bits(&spi_get_hw(PROTOZOA_INTERLINK_SPI)->imsc, rxIrqs);
+    else
+        hw_clear_bits(&spi_get_hw(PROTOZOA_INTERLINK_SPI)->imsc, rxIrqs);
+}
+
+static void spi_rx_irq_handler()
+{
+    // RX interrupts are level triggered, re-enabled once the FIFO got drained
+    spi_rx_irq_enable(false);
+    notifyTaskFromISR(picoMainTask);
+}
+
 extern "C" void pvrPicoMain(void *pvParameters)
 {
     printf("Starting AmeNote ProtoZOA\n");
 
-    generateRandomSeed();
+    picoMainTask = xTaskGetCurrentTaskHandle();
 
     mainPico.startup();
     mainPico.setButtonDown(buttonDown);
@@ -31,33 +61,21 @@ extern "C" void pvrPicoMain(void *pvParameters)
     mainPico.setAnalog(analog);
     mainPico.setEncoder(encoder);
 
+    irq_set_exclusive_handler(SPI0_IRQ, spi_rx_irq_handler);
+    irq_set_enabled(SPI0_IRQ, true);
+
     while (true) {
         // read SPI from Main
         mainPico.process();
+        spi_rx_irq_enable(true);
 
-        taskYIELD();
+        // wait for more data from Main
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
         //--- End loop
     }
 }
 
-void generateRandomSeed()
-{
-    // setting up random Seed - by connecting to a floating ADC and reading values into srand
-    // this is not a perfect RNG but good enough for MIDI2.0 and better than nothing
-    adc_init();
-    adc_gpio_init(26);
-    adc_select_input(0);
-    uint32_t seed=0;
-    for(int i=0;i<32;i+=3){
-        uint result = adc_read();
-        seed += (result & 0xFFF) << i;
-        sleep_ms(result);
-    }
-
-    srand(seed);
-}
-
 static constexpr auto vel = midi::velocity{ midi::uint7_t{ 100 } };
 
 void buttonDown(uint8_t button) {
@@ -72,7 +90,8 @@ void buttonDown(uint8_t button) {
     case CAP5:
     case CAP6:
     case CAPRATIO:
-        ControlMessageBuffer.write(midi::make_midi2_note_on_message(0, 0, 60+button, vel));
+        controlState.setCap(button - CAP1, true);
+        writeControlMessage(midi::make_midi2_note_on_message(0, 0, 60+button, vel));
         break;
     }
 }
@@ -89,7 +108,8 @@ void buttonUp(uint8_t button)
     case CAP5:
     case CAP6:
     case CAPRATIO:
-        ControlMessageBuffer.write(midi::make_midi2_note_off_message(0, 0, 60+button, vel));
+        controlState.setCap(button - CAP1, false);
+        writeControlMessage(midi::make_midi2_note_off_message(0, 0, 60+button, vel));
         break;
     }
 }
@@ -103,6 +123,9 @@ void analog(uint8_t pot, uint16_t value)
 {
     printf("Pot %d 0x%03x\n", pot, value);
 
+    // update the state before the UMP wakes up the endpoints, so they see the change
+    controlState.setPot(pot, value);
+
     const auto v = midi::controller_value{ midi::upsample_x_to_ybit(value, 12, 32) };
-    ControlMessageBuffer.write(midi::make_midi2_control_change_message(0, 0, pot==POT1?7:11, v));
+    writeControlMessage(midi::make_midi2_control_change_message(0, 0, pot==POT1?7:11, v));
 }
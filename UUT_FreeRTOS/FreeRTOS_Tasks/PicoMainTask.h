@@ -15,7 +15,7 @@ void pvrPicoMain(void *pvParameters);
 }
 
 #include "UMPRingBuffer.h"
-extern UMPRingBuffer<32> ControlMessageBuffer;
+extern UMPRingBuffer<128> ControlMessageBuffer;
 #endif
 
 #endif // PICOMAINTASK_H
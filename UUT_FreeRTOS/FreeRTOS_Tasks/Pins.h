@@ -0,0 +1,32 @@
+#ifndef PINS_H
+#define PINS_H
+
+// GPIO assignment of the board
+enum Pins
+{
+  StdioTxPin         = 0,
+  StdioRxPin         = 1,
+  CMEHSDisablePin    = 2,
+  CMEResetPin        = 3,
+  InterchipRxPin     = 4,  // SPI to the main Pico, see Common/interchip.cpp
+  InterchipClkPin    = 6,
+  InterchipTxPin     = 7,
+  ExpansionUartTxPin = 8,  // CME Widi, Type25
+  ExpansionUartRxPin = 9,
+  CMEOnPin           = 10,
+  CMEButtonPin       = 11,
+  DINPortTxPin       = 12,
+  DINPortRxPin       = 13,
+  DINPort4TxPin      = 14,
+  CMEStatus2Pin      = 15,
+  CMEStatus1Pin      = 16,
+  DINPort4RxPin      = 17,
+  DINPort2TxPin      = 18,
+  DINPort2RxPin      = 19,
+  DINPort3TxPin      = 20,
+  DINPort3RxPin      = 21,
+  LEDPin             = 25,
+  EntropyADCPin      = 26, // left floating
+};
+
+#endif // PINS_H
@@ -0,0 +1,285 @@
+#ifndef PRIORITYSENDQUEUE_H
+#define PRIORITYSENDQUEUE_H
+
+#include "Board.h"
+#include "UMPRingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+
+//! Send queue of a slow MIDI 1.0 byte stream sink (DIN, Widi) with three priority classes
+/***
+ *
+ * A single FIFO lets a long SysEx dump delay MIDI clock and note offs by
+ * hundreds of milliseconds at 31250 baud. Packets are therefore queued
+ * in one ring per class:
+ *
+ * - Realtime:     system real time (clock, start, stop, ...), sent first,
+ *                 the byte stream allows them even inside SysEx
+ * - ChannelVoice: channel voice and system common messages
+ * - Bulk:         SysEx7 / SysEx8 data messages
+ *
+ * Channel voice messages overtake bulk data only between two SysEx
+ * messages of their group, a status byte inside SysEx would end it on the
+ * wire. Groups are separate wires when a queue serves several ports, so
+ * this state is kept per group: a SysEx message to one port does not hold
+ * back a channel voice message at the head of the queue for another port.
+ * Should the packets of a started SysEx message stop arriving for
+ * sysexStallUs, the message is given up, the remaining packets of its
+ * group are discarded, so it cannot hold back the other classes forever.
+ * Within a class the order is kept.
+ *
+ * The queue delay of every sampleInterval-th packet per class is measured,
+ * from write to being consumed by the reader. Writers may run in any task
+ * or core, there is a single reader, the task serving the sink.
+ *
+ ***/
+template <uint16_t capacity>
+class PrioritySendQueue
+{
+public:
+    enum Class : uint8_t
+    {
+        Realtime,
+        ChannelVoice,
+        Bulk,
+        numClasses
+    };
+
+    static constexpr uint16_t realtimeCapacity { 64 };
+    static constexpr uint32_t sysexStallUs { 200000 };
+    static constexpr uint16_t sampleInterval { 8 }; //!< power of two
+
+    struct DelayStats
+    {
+        uint32_t numSamples { 0 };
+        uint32_t lastUs { 0 };
+        uint32_t maxUs { 0 };
+        uint64_t totalUs { 0 };
+
+        uint32_t averageUs() const { return numSamples ? uint32_t(totalUs / numSamples) : 0; }
+    };
+
+    static Class classOf(const midi::universal_packet &p)
+    {
+        switch (p.type())
+        {
+        case midi::packet_type::system:
+            return (((p.data[0] >> 16) & 0xFF) >= 0xF8) ? Realtime : ChannelVoice;
+        case midi::packet_type::data:
+        case midi::packet_type::extended_data:
+            return Bulk;
+        default:
+            return ChannelVoice;
+        }
+    }
+
+    inline void write(const midi::universal_packet &p)
+    {
+        const Class c = classOf(p);
+        const uint32_t now = board::timeUs();
+
+        uint16_t count;
+        switch (c)
+        {
+        case Realtime:     count = m_realtime.write(p); break;
+        case ChannelVoice: count = m_voice.write(p); break;
+        default:           count = m_bulk.write(p); break;
+        }
+
+        // a probe packet has a unique count, its writer is the only one setting the probe
+        if ((count & (sampleInterval - 1)) == 0)
+        {
+            m_probes[c].timeUs.store(now, std::memory_order_relaxed);
+            m_probes[c].count.store(count, std::memory_order_release);
+        }
+    }
+
+    //! register a reader wake up for all classes
+    inline bool addReader(UMPReaderNotifyProc *notify, void *reader)
+    {
+        return m_realtime.addReader(notify, reader) && m_voice.addReader(notify, reader)
+            && m_bulk.addReader(notify, reader);
+    }
+
+    //! copy the packet to be sent next into p, it stays queued until consume
+    inline bool peek(midi::universal_packet &p, uint32_t nowUs)
+    {
+        if (readClass(Realtime, p))
+            return true;
+
+        if (!readClass(ChannelVoice, p))
+            return readClass(Bulk, p);
+
+        // a SysEx message on the wire may only be interrupted by real time bytes
+        const uint8_t group = groupOf(p.data[0]);
+        if (!(m_inSysex & (1u << group)) || readClass(Bulk, p))
+            return true;
+
+        if (nowUs - m_bulkUs[group] < sysexStallUs)
+        {
+            m_pending = numClasses;
+            return false;
+        }
+
+        // the rest of the message did not arrive in time, give it up
+        m_inSysex &= ~(1u << group);
+        m_discardSysex |= (1u << group);
+        return readClass(ChannelVoice, p);
+    }
+
+    //! remove the packet returned by the last peek from the queue
+    inline void consume(uint32_t nowUs)
+    {
+        if (m_pending == numClasses)
+            return;
+
+        const Class c = m_pending;
+        m_readPtrs[c] = m_pendingPtr;
+        m_pending = numClasses;
+
+        if (c == Bulk)
+        {
+            const uint8_t group = groupOf(m_pendingWord0);
+            if (continuesSysex(m_pendingWord0))
+                m_inSysex |= (1u << group);
+            else
+                m_inSysex &= ~(1u << group);
+            m_bulkUs[group] = nowUs;
+        }
+
+        Probe &probe = m_probes[c];
+        const uint16_t n = probe.count.load(std::memory_order_acquire);
+        if ((n != probe.measured) && (int16_t(m_readPtrs[c].count - n) >= 0))
+        {
+            const uint32_t delay = nowUs - probe.timeUs.load(std::memory_order_relaxed);
+            probe.measured = n;
+
+            DelayStats &stats = m_stats[c];
+            ++stats.numSamples;
+            stats.lastUs = delay;
+            stats.totalUs += delay;
+            if (delay > stats.maxUs)
+                stats.maxUs = delay;
+        }
+    }
+
+    //! microseconds until a stalled SysEx message is given up, UINT32_MAX if none is half sent
+    uint32_t untilSysexGivenUp(uint32_t nowUs) const
+    {
+        uint32_t until = UINT32_MAX;
+        for (uint8_t group = 0; group < 16; ++group)
+        {
+            if (!(m_inSysex & (1u << group)))
+                continue;
+
+            const uint32_t stalledUs = nowUs - m_bulkUs[group];
+            const uint32_t us = (stalledUs < sysexStallUs) ? sysexStallUs - stalledUs : 0;
+            if (us < until)
+                until = us;
+        }
+        return until;
+    }
+
+    inline bool read(midi::universal_packet &p, uint32_t nowUs)
+    {
+        if (!peek(p, nowUs))
+            return false;
+
+        consume(nowUs);
+        return true;
+    }
+
+    const DelayStats &delayStats(Class c) const { return m_stats[c]; }
+    void resetDelayStats()
+    {
+        for (auto &stats : m_stats)
+            stats = DelayStats{};
+    }
+
+    //! packets lost to overruns since the last call, over all classes
+    uint32_t takeDropped()
+    {
+        uint32_t dropped = 0;
+        for (auto &readPtr : m_readPtrs)
+        {
+            dropped += readPtr.dropped;
+            readPtr.dropped = 0;
+        }
+        return dropped;
+    }
+
+private:
+    struct Probe
+    {
+        std::atomic<uint16_t> count { 0 };
+        std::atomic<uint32_t> timeUs { 0 };
+        uint16_t measured { 0 }; // reader side
+    };
+
+    static uint8_t groupOf(uint32_t word0) { return (word0 >> 24) & 0x0F; }
+
+    // SysEx7 / SysEx8 start or continue
+    static bool continuesSysex(uint32_t word0)
+    {
+        const uint8_t status = (word0 >> 20) & 0x0F;
+        return (status == 0x1) || (status == 0x2);
+    }
+
+    inline bool readClass(Class c, midi::universal_packet &p)
+    {
+        for (;;)
+        {
+            UMPReadPtr readPtr = m_readPtrs[c];
+            bool found;
+            switch (c)
+            {
+            case Realtime:     found = m_realtime.read(readPtr, p); break;
+            case ChannelVoice: found = m_voice.read(readPtr, p); break;
+            default:           found = m_bulk.read(readPtr, p); break;
+            }
+            if (!found)
+            {
+                m_readPtrs[c] = readPtr; // may have resynchronized
+                return false;
+            }
+
+            const uint16_t group = uint16_t(1u << groupOf(p.data[0]));
+            if ((c == Bulk) && (m_discardSysex & group))
+            {
+                // the tail of a given up message: continue and end packets of its group
+                const uint8_t status = (p.data[0] >> 20) & 0x0F;
+                if (status != 0x2)
+                    m_discardSysex &= ~group;
+                if ((status == 0x2) || (status == 0x3))
+                {
+                    m_readPtrs[c] = readPtr;
+                    continue;
+                }
+            }
+
+            m_pending = c;
+            m_pendingPtr = readPtr;
+            m_pendingWord0 = p.data[0];
+            return true;
+        }
+    }
+
+    UMPRingBuffer<realtimeCapacity, true> m_realtime;
+    UMPRingBuffer<capacity, true> m_voice;
+    UMPRingBuffer<capacity, true> m_bulk;
+
+    Probe m_probes[numClasses];
+    DelayStats m_stats[numClasses];
+
+    // reader state
+    UMPReadPtr m_readPtrs[numClasses];
+    Class m_pending { numClasses };
+    UMPReadPtr m_pendingPtr;
+    uint32_t m_pendingWord0 { 0 };
+    uint16_t m_inSysex { 0 };      // bit per group: a SysEx message is half sent
+    uint16_t m_discardSysex { 0 }; // bit per group: skipping the rest of a given up message
+    uint32_t m_bulkUs[16] {};      // per group: last bulk packet consumed
+};
+
+#endif // PRIORITYSENDQUEUE_H
@@ -0,0 +1,61 @@
+#include "ProfileRegistry.h"
+
+int ProfileRegistry::add(const ProfileId &id, midi::group_t group, uint16_t channels, bool groupWide,
+                         filterProc *filter, detailsProc *details)
+{
+    if ((m_numProfiles >= maxProfiles) || (group > 15))
+        return -1;
+
+    const uint8_t n = m_numProfiles++;
+    m_profiles[n] = Profile{ id, group, channels, groupWide, filter, details };
+    if (filter)
+        m_withFilter |= uint8_t(1u << n);
+    return n;
+}
+
+int ProfileRegistry::find(const ProfileId &id, midi::group_t group, uint8_t target) const
+{
+    for (uint8_t n = 0; n < m_numProfiles; ++n)
+    {
+        if ((m_profiles[n].id == id) && (m_profiles[n].group == group) && m_profiles[n].supports(target))
+            return n;
+    }
+    return -1;
+}
+
+bool ProfileRegistry::enable(const ProfileId &id, midi::group_t group, uint8_t target)
+{
+    const int n = find(id, group, target);
+    if (n < 0)
+        return false;
+
+    m_enabled[group][target] |= uint8_t(1u << n);
+    return true;
+}
+
+bool ProfileRegistry::disable(const ProfileId &id, midi::group_t group, uint8_t target)
+{
+    const int n = find(id, group, target);
+    if (n < 0)
+        return false;
+
+    m_enabled[group][target] &= ~uint8_t(1u << n);
+    return true;
+}
+
+void ProfileRegistry::reset()
+{
+    for (auto &g : m_enabled)
+        for (auto &profiles : g)
+            profiles = 0;
+}
+
+bool ProfileRegistry::supportsGroup(midi::group_t group) const
+{
+    for (uint8_t n = 0; n < m_numProfiles; ++n)
+    {
+        if (m_profiles[n].group == group)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,128 @@
+#ifndef PROFILEREGISTRY_H
+#define PROFILEREGISTRY_H
+
+#include <midi/universal_packet.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//! MIDI-CI profiles of an endpoint and where they are enabled
+/***
+ *
+ * Profiles are registered once with the group and the targets (channels,
+ * the group as a whole) they support. Set Profile On / Off messages then
+ * enable and disable them per target.
+ *
+ * For every group and channel the registry keeps a bitmap of the enabled
+ * profiles (bit n: profile n), index groupTarget holds the group wide ones.
+ * Looking up the profiles applying to a packet is therefore two table reads,
+ * whatever number of profiles is registered, and packets of channels
+ * without enabled profiles are not touched at all.
+ *
+ * Enabled profiles with a filter see every channel voice packet of their
+ * targets before it is routed (see filter), so they can drop or transform
+ * messages inline.
+ *
+ * Not thread safe: changed and read by the owning endpoint only.
+ *
+ ***/
+class ProfileRegistry
+{
+public:
+    using ProfileId = std::array<uint8_t, 5>;
+
+    //! modify the packet in place, return false to drop it
+    typedef bool filterProc(midi::universal_packet&);
+    //! write the details for inquiry target to dst, return the size or -1 for unknown targets
+    typedef int detailsProc(uint8_t target, uint8_t *dst, size_t size);
+
+    static constexpr uint8_t maxProfiles { 8 };
+    static constexpr uint8_t groupTarget { 16 };      //!< target of group / function block profiles
+    static constexpr uint16_t allChannels { 0xFFFF };
+
+    struct Profile
+    {
+        ProfileId id {};
+        midi::group_t group { 0 };
+        uint16_t channels { 0 };  //!< bit n: supported on channel n
+        bool groupWide { false }; //!< supported on the group as a whole
+        filterProc *filter { nullptr };
+        detailsProc *details { nullptr };
+
+        bool supports(uint8_t target) const
+        {
+            return (target == groupTarget) ? groupWide : (target < 16) && (channels & (1u << target));
+        }
+    };
+
+    //! returns the profile index, -1 if all profiles are in use
+    int add(const ProfileId&, midi::group_t, uint16_t channels, bool groupWide,
+            filterProc *filter = nullptr, detailsProc *details = nullptr);
+
+    //! profile index of id on group and target, -1 if not supported there
+    int find(const ProfileId&, midi::group_t, uint8_t target) const;
+
+    //! return false if the profile is not supported on target
+    bool enable(const ProfileId&, midi::group_t, uint8_t target);
+    bool disable(const ProfileId&, midi::group_t, uint8_t target);
+    //! disable all profiles of all groups
+    void reset();
+
+    bool isEnabled(uint8_t index, midi::group_t group, uint8_t target) const
+    {
+        return (group < 16) && (target <= groupTarget) && (m_enabled[group][target] & (1u << index));
+    }
+
+    //! bitmap of the profiles applying to channel of group, including the group wide ones
+    uint8_t active(midi::group_t group, uint8_t channel) const
+    {
+        return m_enabled[group][channel] | m_enabled[group][groupTarget];
+    }
+
+    //! true if any profile is supported on group (e.g. for the MIDI-CI discovery categories)
+    bool supportsGroup(midi::group_t) const;
+
+    //! call f(index, profile) for all profiles supported on group and target
+    template <typename F>
+    void forEach(midi::group_t, uint8_t target, F f) const;
+
+    const Profile &operator[](uint8_t index) const { return m_profiles[index]; }
+    uint8_t size() const { return m_numProfiles; }
+
+    //! apply the filters of the enabled profiles, returns false if the packet is to be dropped
+    bool filter(midi::universal_packet &p) const
+    {
+        if ((p.type() != midi::packet_type::midi1_channel_voice) && (p.type() != midi::packet_type::midi2_channel_voice))
+            return true;
+
+        uint8_t profiles = active(p.group(), (p.data[0] >> 16) & 0x0F) & m_withFilter;
+        while (profiles)
+        {
+            const unsigned n = __builtin_ctz(profiles);
+            profiles &= profiles - 1;
+
+            if (!m_profiles[n].filter(p))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    Profile m_profiles[maxProfiles];
+    uint8_t m_numProfiles { 0 };
+    uint8_t m_withFilter { 0 };                 // profiles having a filter
+    uint8_t m_enabled[16][groupTarget + 1] {};  // [group][channel / groupTarget] -> profile bitmap
+};
+
+template <typename F>
+void ProfileRegistry::forEach(midi::group_t group, uint8_t target, F f) const
+{
+    for (uint8_t n = 0; n < m_numProfiles; ++n)
+    {
+        if ((m_profiles[n].group == group) && m_profiles[n].supports(target))
+            f(n, m_profiles[n]);
+    }
+}
+
+#endif // PROFILEREGISTRY_H
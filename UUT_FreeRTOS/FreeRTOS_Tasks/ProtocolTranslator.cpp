@@ -0,0 +1,218 @@
+#include "ProtocolTranslator.h"
+
+using namespace scaling;
+
+namespace {
+
+// channel voice status nibbles
+constexpr uint8_t registeredController = 0x2;
+constexpr uint8_t assignableController = 0x3;
+constexpr uint8_t noteOff = 0x8;
+constexpr uint8_t noteOn = 0x9;
+constexpr uint8_t polyPressure = 0xA;
+constexpr uint8_t controlChange = 0xB;
+constexpr uint8_t programChange = 0xC;
+constexpr uint8_t channelPressure = 0xD;
+constexpr uint8_t pitchBend = 0xE;
+
+// MIDI 1.0 controllers collected into Program Change / Registered / Assignable Controllers
+constexpr uint8_t bankSelectMSB = 0;
+constexpr uint8_t bankSelectLSB = 32;
+constexpr uint8_t dataEntryMSB = 6;
+constexpr uint8_t dataEntryLSB = 38;
+constexpr uint8_t nrpnLSB = 98;
+constexpr uint8_t nrpnMSB = 99;
+constexpr uint8_t rpnLSB = 100;
+constexpr uint8_t rpnMSB = 101;
+
+// ChannelState::flags
+constexpr uint8_t bankValid = 0x01;
+constexpr uint8_t rpnSelected = 0x02;
+constexpr uint8_t nrpnSelected = 0x04;
+
+constexpr uint32_t header(uint32_t word0) { return word0 & 0x0F0F0000; } // group and channel
+
+constexpr midi::universal_packet midi1(uint32_t header, uint8_t status, uint8_t d1, uint8_t d2 = 0)
+{
+    return midi::universal_packet{ 0x20000000 | header | (uint32_t(status) << 20) | (uint32_t(d1 & 0x7F) << 8) | (d2 & 0x7F) };
+}
+
+constexpr midi::universal_packet midi2(uint32_t header, uint8_t status, uint8_t index1, uint8_t index2, uint32_t data)
+{
+    return midi::universal_packet{ 0x40000000 | header | (uint32_t(status) << 20) | (uint32_t(index1) << 8) | index2, data };
+}
+
+} // namespace
+
+uint8_t ProtocolTranslator::toMIDI1(const midi::universal_packet &p, midi::universal_packet out[maxPackets])
+{
+    if (p.type() != midi::packet_type::midi2_channel_voice)
+    {
+        out[0] = p;
+        return 1;
+    }
+
+    const uint32_t h = header(p.data[0]);
+    const uint8_t index1 = uint8_t(p.data[0] >> 8);
+    const uint8_t index2 = uint8_t(p.data[0]);
+    const uint32_t data = p.data[1];
+
+    switch ((p.data[0] >> 20) & 0x0F)
+    {
+    case noteOff:
+        out[0] = midi1(h, noteOff, index1, scale16To7(data >> 16));
+        return 1;
+    case noteOn:
+    {
+        // velocity 0 would turn into a Note Off
+        const uint8_t velocity = scale16To7(data >> 16);
+        out[0] = midi1(h, noteOn, index1, velocity ? velocity : 1);
+        return 1;
+    }
+    case polyPressure:
+        out[0] = midi1(h, polyPressure, index1, scale32To7(data));
+        return 1;
+    case controlChange:
+        out[0] = midi1(h, controlChange, index1, scale32To7(data));
+        return 1;
+    case programChange:
+        if (index2 & bankValid)
+        {
+            out[0] = midi1(h, controlChange, bankSelectMSB, uint8_t(data >> 8));
+            out[1] = midi1(h, controlChange, bankSelectLSB, uint8_t(data));
+            out[2] = midi1(h, programChange, uint8_t(data >> 24));
+            return 3;
+        }
+        out[0] = midi1(h, programChange, uint8_t(data >> 24));
+        return 1;
+    case channelPressure:
+        out[0] = midi1(h, channelPressure, scale32To7(data));
+        return 1;
+    case pitchBend:
+    {
+        const uint16_t value = scale32To14(data);
+        out[0] = midi1(h, pitchBend, uint8_t(value), uint8_t(value >> 7));
+        return 1;
+    }
+    case registeredController:
+    case assignableController:
+    {
+        const bool registered = (((p.data[0] >> 20) & 0x0F) == registeredController);
+        const uint16_t value = scale32To14(data);
+        out[0] = midi1(h, controlChange, registered ? rpnMSB : nrpnMSB, index1);
+        out[1] = midi1(h, controlChange, registered ? rpnLSB : nrpnLSB, index2);
+        out[2] = midi1(h, controlChange, dataEntryMSB, uint8_t(value >> 7));
+        out[3] = midi1(h, controlChange, dataEntryLSB, uint8_t(value));
+        return 4;
+    }
+    default:
+        // per note and relative controllers have no MIDI 1.0 equivalent
+        return 0;
+    }
+}
+
+uint8_t ProtocolTranslator::toMIDI2(const midi::universal_packet &p, midi::universal_packet out[maxPackets], ChannelState *channels)
+{
+    if (p.type() != midi::packet_type::midi1_channel_voice)
+    {
+        out[0] = p;
+        return 1;
+    }
+
+    const uint32_t h = header(p.data[0]);
+    const uint8_t d1 = (p.data[0] >> 8) & 0x7F;
+    const uint8_t d2 = p.data[0] & 0x7F;
+
+    switch ((p.data[0] >> 20) & 0x0F)
+    {
+    case noteOff:
+        out[0] = midi2(h, noteOff, d1, 0, uint32_t(scale7To16(d2)) << 16);
+        return 1;
+    case noteOn:
+        // MIDI 1.0 Note On with velocity 0 is a Note Off with default velocity
+        out[0] = d2 ? midi2(h, noteOn, d1, 0, uint32_t(scale7To16(d2)) << 16)
+                    : midi2(h, noteOff, d1, 0, uint32_t(scale7To16(64)) << 16);
+        return 1;
+    case polyPressure:
+        out[0] = midi2(h, polyPressure, d1, 0, scale7To32(d2));
+        return 1;
+    case controlChange:
+        if (channels)
+        {
+            ChannelState &c = channels[(p.data[0] >> 16) & 0x0F];
+            switch (d1)
+            {
+            case bankSelectMSB:
+                c.bankMSB = d2;
+                c.flags |= bankValid;
+                return 0;
+            case bankSelectLSB:
+                c.bankLSB = d2;
+                c.flags |= bankValid;
+                return 0;
+            case rpnMSB:
+            case nrpnMSB:
+                c.paramMSB = d2;
+                c.flags = (c.flags & bankValid) | ((d1 == rpnMSB) ? rpnSelected : nrpnSelected);
+                return 0;
+            case rpnLSB:
+            case nrpnLSB:
+                c.paramLSB = d2;
+                c.flags = (c.flags & bankValid) | ((d1 == rpnLSB) ? rpnSelected : nrpnSelected);
+                return 0;
+            case dataEntryMSB:
+            case dataEntryLSB:
+                if (c.flags & (rpnSelected | nrpnSelected))
+                {
+                    // RPN 127/127 is the null function
+                    if ((c.flags & rpnSelected) && (c.paramMSB == 0x7F) && (c.paramLSB == 0x7F))
+                        return 0;
+
+                    uint16_t value;
+                    if (d1 == dataEntryMSB)
+                    {
+                        c.dataMSB = d2;
+                        value = uint16_t(d2 << 7);
+                    }
+                    else
+                    {
+                        value = uint16_t((c.dataMSB << 7) | d2);
+                    }
+
+                    out[0] = midi2(h, (c.flags & rpnSelected) ? registeredController : assignableController,
+                                   c.paramMSB, c.paramLSB, scale14To32(value));
+                    return 1;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        out[0] = midi2(h, controlChange, d1, 0, scale7To32(d2));
+        return 1;
+    case programChange:
+        if (channels && (channels[(p.data[0] >> 16) & 0x0F].flags & bankValid))
+        {
+            const ChannelState &c = channels[(p.data[0] >> 16) & 0x0F];
+            out[0] = midi2(h, programChange, 0, bankValid, (uint32_t(d1) << 24) | (c.bankMSB << 8) | c.bankLSB);
+            return 1;
+        }
+        out[0] = midi2(h, programChange, 0, 0, uint32_t(d1) << 24);
+        return 1;
+    case channelPressure:
+        out[0] = midi2(h, channelPressure, 0, 0, scale7To32(d1));
+        return 1;
+    case pitchBend:
+        out[0] = midi2(h, pitchBend, 0, 0, scale14To32(uint16_t((d2 << 7) | d1)));
+        return 1;
+    default:
+        out[0] = p;
+        return 1;
+    }
+}
+
+void ProtocolTranslator::reset()
+{
+    for (auto &c : m_channels)
+        c = ChannelState{};
+}
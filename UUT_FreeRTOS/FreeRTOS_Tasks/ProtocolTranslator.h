@@ -0,0 +1,102 @@
+#ifndef PROTOCOLTRANSLATOR_H
+#define PROTOCOLTRANSLATOR_H
+
+#include <midi/universal_packet.h>
+
+#include <array>
+#include <cstdint>
+
+//! Value scaling between MIDI 1.0 and MIDI 2.0 resolutions
+namespace scaling {
+
+//! Min-Center-Max upscaling from the MIDI 2.0 protocol specification
+constexpr uint32_t scaleUp(uint32_t value, uint8_t srcBits, uint8_t dstBits)
+{
+    const uint8_t scaleBits = dstBits - srcBits;
+    uint32_t result = value << scaleBits;
+    if (value <= (1u << (srcBits - 1)))
+        return result;
+
+    const uint8_t repeatBits = srcBits - 1;
+    uint32_t repeatValue = value & ((1u << repeatBits) - 1);
+    repeatValue = (scaleBits > repeatBits) ? (repeatValue << (scaleBits - repeatBits))
+                                           : (repeatValue >> (repeatBits - scaleBits));
+    while (repeatValue)
+    {
+        result |= repeatValue;
+        repeatValue >>= repeatBits;
+    }
+    return result;
+}
+
+template <typename T, uint8_t dstBits>
+constexpr std::array<T, 128> makeScale7Table()
+{
+    std::array<T, 128> table {};
+    for (uint32_t v = 0; v < 128; ++v)
+        table[v] = T(scaleUp(v, 7, dstBits));
+    return table;
+}
+
+constexpr auto scale7To16Table = makeScale7Table<uint16_t, 16>();
+constexpr auto scale7To32Table = makeScale7Table<uint32_t, 32>();
+
+constexpr uint16_t scale7To16(uint8_t v) { return scale7To16Table[v & 0x7F]; }
+constexpr uint32_t scale7To32(uint8_t v) { return scale7To32Table[v & 0x7F]; }
+constexpr uint32_t scale14To32(uint16_t v) { return scaleUp(v & 0x3FFF, 14, 32); }
+
+constexpr uint8_t scale16To7(uint16_t v) { return uint8_t(v >> 9); }
+constexpr uint8_t scale32To7(uint32_t v) { return uint8_t(v >> 25); }
+constexpr uint16_t scale32To14(uint32_t v) { return uint16_t(v >> 18); }
+
+} // namespace scaling
+
+//! Channel voice message translation between MIDI 1.0 and MIDI 2.0 protocol
+/***
+ *
+ * Translation follows the default translation of the UMP specification:
+ * Bank Select is sent / collected with Program Change, RPN / NRPN data
+ * entry controllers map to Registered / Assignable Controllers. MIDI 2.0
+ * messages without MIDI 1.0 equivalent (per note messages, relative
+ * controllers) are dropped, all other packets pass unchanged.
+ *
+ * Collecting bank and parameter numbers from MIDI 1.0 controllers needs
+ * per channel state, so every MIDI 1.0 stream needs its own translator.
+ * All groups of a stream share the same state, which is fine for the
+ * single group streams of MIDI 1.0 ports.
+ *
+ * Every call costs a fixed number of table lookups and shifts and yields
+ * up to maxPackets packets.
+ *
+ ***/
+class ProtocolTranslator
+{
+public:
+  static constexpr uint8_t maxPackets { 4 };
+
+  struct ChannelState
+  {
+    uint8_t bankMSB;
+    uint8_t bankLSB;
+    uint8_t paramMSB;
+    uint8_t paramLSB;
+    uint8_t dataMSB;
+    uint8_t flags;
+  };
+
+  //! returns the number of packets written to out
+  static uint8_t toMIDI1(const midi::universal_packet&, midi::universal_packet out[maxPackets]);
+  uint8_t toMIDI2(const midi::universal_packet &p, midi::universal_packet out[maxPackets])
+  {
+    return toMIDI2(p, out, m_channels);
+  }
+  //! without channel state, bank select and RPN / NRPN controllers are translated as plain controllers
+  static uint8_t toMIDI2(const midi::universal_packet&, midi::universal_packet out[maxPackets], ChannelState *channels);
+
+  void reset();
+
+private:
+  ChannelState m_channels[16] {};
+};
+
+#endif // PROTOCOLTRANSLATOR_H
@@ -0,0 +1,164 @@
+#ifndef RUNNINGSTATUSENCODER_H
+#define RUNNINGSTATUSENCODER_H
+
+#include <midi/universal_packet.h>
+
+#include <cstddef>
+#include <cstdint>
+
+//! MIDI 1.0 byte stream encoder of a DIN port, with running status
+/***
+ *
+ * Turns MIDI 1.0 channel voice, system and SysEx7 UMPs into MIDI 1.0
+ * bytes. The status byte of a channel voice message is left out when it
+ * equals the one sent before. At 31.25 kbaud this shortens dense note and
+ * controller streams by a third. System common messages and SysEx cancel
+ * running status. Real time messages do not change it.
+ *
+ * A receiver that missed the status byte (plugged in mid-stream, or a
+ * byte got corrupted) misinterprets everything sent with running status
+ * after it. The status byte is therefore repeated at least every
+ * statusRefreshUs, even if it did not change.
+ *
+ * With activeSensingUs set, the encoder also produces active sensing
+ * (0xFE) after that long without output. Receivers that see active
+ * sensing once notice a broken cable and can silence hanging notes
+ * (300 ms timeout, MIDI 1.0 specification).
+ *
+ * Other message types produce no bytes. MIDI 2.0 channel voice messages
+ * are translated by the router before they reach a DIN port.
+ *
+ ***/
+class RunningStatusEncoder
+{
+public:
+    static constexpr size_t maxBytes { 8 }; //!< per packet: F0, 6 data bytes, F7
+
+    static constexpr uint32_t defaultStatusRefreshUs { 500000 };
+    static constexpr uint32_t defaultActiveSensingUs { 270000 }; //!< below the 300 ms receiver timeout
+
+    //! statusRefreshUs: 0 repeats no status byte, activeSensingUs: 0 produces no active sensing
+    constexpr RunningStatusEncoder(uint32_t statusRefreshUs = defaultStatusRefreshUs,
+                                   uint32_t activeSensingUs = 0) :
+        m_statusRefreshUs(statusRefreshUs),
+        m_activeSensingUs(activeSensingUs)
+    {}
+
+    //! true for the single byte system real time messages (clock, start, stop, ...)
+    static bool isRealtime(const midi::universal_packet &p)
+    {
+        return (p.type() == midi::packet_type::system) && (((p.data[0] >> 16) & 0xFF) >= 0xF8);
+    }
+
+    //! write the bytes of p to bytes (maxBytes), returns the number of bytes, nowUs: board::timeUs
+    uint8_t encode(const midi::universal_packet &p, uint8_t *bytes, uint32_t nowUs)
+    {
+        const uint8_t n = encodeBytes(p, bytes, nowUs);
+        if (n)
+            m_outputUs = nowUs;
+        return n;
+    }
+
+    //! microseconds until idle has to be called, UINT32_MAX if never
+    uint32_t untilIdle(uint32_t nowUs) const
+    {
+        if (!m_activeSensingUs)
+            return UINT32_MAX;
+
+        const uint32_t idleUs = nowUs - m_outputUs;
+        return (idleUs < m_activeSensingUs) ? m_activeSensingUs - idleUs : 0;
+    }
+
+    //! write active sensing to bytes when due, returns the number of bytes
+    uint8_t idle(uint8_t *bytes, uint32_t nowUs)
+    {
+        if (!m_activeSensingUs || (untilIdle(nowUs) != 0))
+            return 0;
+
+        m_outputUs = nowUs;
+        bytes[0] = 0xFE;
+        return 1;
+    }
+
+    //! the next channel voice message carries its status byte
+    void reset() { m_runningStatus = 0; }
+
+private:
+    uint8_t encodeBytes(const midi::universal_packet &p, uint8_t *bytes, uint32_t nowUs)
+    {
+        const uint32_t w0 = p.data[0];
+        const uint8_t status = (w0 >> 16) & 0xFF;
+
+        switch (p.type())
+        {
+        case midi::packet_type::midi1_channel_voice:
+        {
+            if ((status < 0x80) || (status >= 0xF0))
+                return 0;
+
+            uint8_t n = 0;
+            if ((status != m_runningStatus) || (m_statusRefreshUs && (nowUs - m_statusUs >= m_statusRefreshUs)))
+            {
+                bytes[n++] = m_runningStatus = status;
+                m_statusUs = nowUs;
+            }
+            bytes[n++] = (w0 >> 8) & 0x7F;
+            if (((status & 0xF0) != 0xC0) && ((status & 0xF0) != 0xD0))
+                bytes[n++] = w0 & 0x7F;
+            return n;
+        }
+        case midi::packet_type::system:
+            if (status < 0xF0)
+                return 0;
+            if (status < 0xF8)
+                m_runningStatus = 0;
+
+            bytes[0] = status;
+            switch (status)
+            {
+            case 0xF1: // MTC quarter frame
+            case 0xF3: // song select
+                bytes[1] = (w0 >> 8) & 0x7F;
+                return 2;
+            case 0xF2: // song position
+                bytes[1] = (w0 >> 8) & 0x7F;
+                bytes[2] = w0 & 0x7F;
+                return 3;
+            default:
+                return 1;
+            }
+        case midi::packet_type::data:
+        {
+            // SysEx7: complete (0), start (1), continue (2), end (3)
+            const uint8_t form = (w0 >> 20) & 0x0F;
+            if (form > 3)
+                return 0;
+
+            uint8_t numData = (w0 >> 16) & 0x0F;
+            if (numData > 6)
+                numData = 6;
+
+            m_runningStatus = 0;
+            uint8_t n = 0;
+            if ((form == 0) || (form == 1))
+                bytes[n++] = 0xF0;
+            for (uint8_t i = 0; i < numData; ++i)
+                bytes[n++] = ((i < 2) ? (w0 >> (8 - 8 * i)) : (p.data[1] >> (40 - 8 * i))) & 0x7F;
+            if ((form == 0) || (form == 3))
+                bytes[n++] = 0xF7;
+            return n;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t m_statusRefreshUs;
+    uint32_t m_activeSensingUs;
+
+    uint8_t m_runningStatus { 0 };
+    uint32_t m_statusUs { 0 };  // last status byte sent
+    uint32_t m_outputUs { 0 };  // last byte sent
+};
+
+#endif // RUNNINGSTATUSENCODER_H
@@ -3,6 +3,7 @@
 #include <midi/universal_packet.h>
 
 #include <cassert>
+#include <cstddef>
 
 #if PROTOZOA_SERIAL_BRACKET16
 //! 16 Bit Bracketing
@@ -104,6 +105,39 @@ struct SerialBracketing
     return COLLECTING;
   }
 
+  //! decode received bytes into complete UMPs, stops when maxPackets packets are decoded,
+  //! returns the number of bytes consumed, numPackets the number of packets decoded
+  size_t feed(const uint8_t *bytes, size_t numBytes, midi::universal_packet *packets, size_t maxPackets,
+              size_t &numPackets)
+  {
+    numPackets = 0;
+    size_t i = 0;
+    while ((i < numBytes) && (numPackets < maxPackets))
+    {
+      switch (feed(bytes[i++]))
+      {
+      case SUCCESS:
+        packets[numPackets++] = ump;
+        break;
+      case CRC_ERROR:
+      case INVALID_UMP:
+        ++num_errors;
+        break;
+      default:
+        break;
+      }
+    }
+    return i;
+  }
+
+  //! CRC errors and invalid UMPs since the last call, bulk feed only
+  uint32_t takeErrors()
+  {
+    const uint32_t n = num_errors;
+    num_errors = 0;
+    return n;
+  }
+
   uint8_t checksum() const { return chksum; }
   
 private:
@@ -112,6 +146,7 @@ private:
   uint8_t chksum = 0xf7;
   uint8_t ump_size = 0;
   uint8_t inWord = 0;
+  uint32_t num_errors = 0;
 };
 
 #else
@@ -155,29 +190,78 @@ struct SerialBracketing
 
   status feed(uint8_t inByte)
   {
-    cobs.processSerial(inByte);
-    if (cobs.availableUMP())
+    size_t numPackets;
+    feed(&inByte, 1, &ump, 1, numPackets);
+    return (numPackets ? SUCCESS : COLLECTING);
+  }
+
+  //! decode received bytes into complete UMPs, stops when maxPackets packets are decoded,
+  //! returns the number of bytes consumed, numPackets the number of packets decoded
+  /***
+   * Whole COBS blocks get decoded a word at a time (cobsUMP::decode), the
+   * words are grouped into UMPs by the size of their message type.
+   ***/
+  size_t feed(const uint8_t *bytes, size_t numBytes, midi::universal_packet *packets, size_t maxPackets,
+              size_t &numPackets)
+  {
+    numPackets = 0;
+    size_t consumed = 0;
+    while (consumed < numBytes)
     {
-      if (num_missing_words == 0)
+      // every word completes at most one packet
+      uint32_t words[16];
+      const size_t maxWords = (maxPackets - numPackets < 16) ? maxPackets - numPackets : 16;
+      size_t numWords;
+      const size_t n = cobs.decode(bytes + consumed, numBytes - consumed, words, maxWords, numWords);
+      if (n == 0)
+        break; // packets full
+      consumed += n;
+
+      for (size_t w = 0; w < numWords; ++w)
       {
-        ump.data[0] = cobs.readUMP();
-        num_missing_words = ump.size()-1;
+        if (num_missing_words == 0)
+        {
+          collecting = midi::universal_packet{ words[w] };
+          num_words = ump_size[words[w] >> 28];
+          num_missing_words = num_words - 1;
+        }
+        else
+        {
+          collecting.data[num_words - num_missing_words] = words[w];
+          --num_missing_words;
+        }
+
+        if (num_missing_words == 0)
+          packets[numPackets++] = collecting;
       }
-      else
+
+      // a frame carries whole packets
+      if (cobs.endOfFrame() && num_missing_words)
       {
-        ump.data[ump.size() - num_missing_words] = cobs.readUMP();
-        --num_missing_words;
+        ++num_errors;
+        num_missing_words = 0;
       }
-
-      return (num_missing_words ? COLLECTING : SUCCESS);
     }
+    return consumed;
+  }
 
-    return COLLECTING;
+  //! frames with incomplete UMPs or partial words since the last call
+  uint32_t takeErrors()
+  {
+    const uint32_t n = num_errors + cobs.takeTruncatedFrames();
+    num_errors = 0;
+    return n;
   }
 
 private:
+  // UMP size in words by message type
+  static constexpr uint8_t ump_size[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+
   cobsUMP cobs;
-  size_t num_missing_words { 0 };
+  midi::universal_packet collecting;
+  uint8_t num_words { 0 };
+  uint8_t num_missing_words { 0 };
+  uint32_t num_errors { 0 };
 };
 
 #endif
\ No newline at end of file
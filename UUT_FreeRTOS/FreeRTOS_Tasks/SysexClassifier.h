@@ -0,0 +1,106 @@
+#ifndef SYSEXCLASSIFIER_H
+#define SYSEXCLASSIFIER_H
+
+#include <midi/universal_packet.h>
+
+#include <cstdint>
+
+//! Decides per system exclusive message whether it is reassembled locally
+/***
+ *
+ * Reassembling a SysEx7 message (midi::sysex7_collector) costs memory
+ * for the whole message, and messages larger than the collector are
+ * truncated. The local handlers only need a few kinds of message
+ * (MIDI-CI, identity requests, our own configuration messages). The
+ * classifier looks at the first packet of each SysEx7 message and picks
+ * one of those kinds. Only packets of the selected kinds are collected.
+ * All other messages, e.g. sample or firmware dumps for other devices,
+ * are never buffered. Their packets reach the routed sinks one by one
+ * as they arrive, so memory use stays constant whatever their size.
+ *
+ * SysEx8 and Mixed Data Set messages (message type 5) are always passed
+ * through packet by packet, none of the local handlers uses them.
+ *
+ * If the first packet carries too few bytes for a decision, the message
+ * is collected, as before.
+ *
+ ***/
+class SysexClassifier
+{
+public:
+    enum Class : uint8_t
+    {
+        Foreign           = 0x01,
+        CapabilityInquiry = 0x02, //!< Universal SysEx, Sub-ID #1 0D
+        IdentityRequest   = 0x04, //!< Universal SysEx, Sub-ID 06 01
+        OwnManufacturer   = 0x08, //!< manufacturer specific with manufacturerID
+        Undetermined      = 0x10, //!< first packet too short to tell
+    };
+
+    //! collected: bitmap of the classes to collect, manufacturerID: see OwnManufacturer
+    constexpr SysexClassifier(uint8_t collected, uint32_t manufacturerID) :
+        m_collected(collected | Undetermined),
+        m_manufacturerID(manufacturerID)
+    {}
+
+    //! classify the message a SysEx7 start or complete packet begins
+    Class classify(const midi::universal_packet &p) const
+    {
+        const uint8_t numBytes = (p.data[0] >> 16) & 0x0F;
+        auto byte = [&p](unsigned i) -> uint8_t {
+            return (i < 2) ? (p.data[0] >> (8 - 8 * i)) & 0x7F : (p.data[1] >> (40 - 8 * i)) & 0x7F;
+        };
+
+        if (numBytes == 0)
+            return Undetermined;
+
+        const uint8_t id = byte(0);
+        if ((id == 0x7E) || (id == 0x7F))
+        {
+            // id, device id, Sub-ID #1, Sub-ID #2
+            if (numBytes < 3)
+                return Undetermined;
+            if ((id == 0x7E) && (byte(2) == 0x0D))
+                return CapabilityInquiry;
+            if (byte(2) != 0x06)
+                return Foreign;
+            if (numBytes < 4)
+                return Undetermined;
+            return (byte(3) == 0x01) ? IdentityRequest : Foreign;
+        }
+
+        if (m_manufacturerID <= 0x7F)
+            return (id == m_manufacturerID) ? OwnManufacturer : Foreign;
+
+        // three byte manufacturer ID: 00 xx yy
+        if (id != 0)
+            return Foreign;
+        if (numBytes < 3)
+            return Undetermined;
+        return ((byte(1) == ((m_manufacturerID >> 8) & 0x7F)) && (byte(2) == (m_manufacturerID & 0x7F)))
+                   ? OwnManufacturer : Foreign;
+    }
+
+    //! returns true if the SysEx7 packet p belongs to a message to be collected
+    bool collect(const midi::universal_packet &p)
+    {
+        // decide on the first packet of each message, continue and end packets follow the decision
+        const uint8_t status = (p.data[0] >> 20) & 0x0F;
+        if ((status == 0x0) || (status == 0x1))
+            m_collecting = (m_collected & classify(p)) != 0;
+        else if ((status != 0x2) && (status != 0x3))
+            return false;
+
+        return m_collecting;
+    }
+
+    //! true while the packets of the current message are collected
+    bool collecting() const { return m_collecting; }
+
+private:
+    uint8_t m_collected;
+    uint32_t m_manufacturerID;
+    bool m_collecting { false };
+};
+
+#endif // SYSEXCLASSIFIER_H
@@ -1,11 +1,14 @@
 #include "Type25SerialTask.h"
 
 #include "FreeRTOS.h"
+#include "FreeRTOS_Tasks.h"
 #include "task.h"
 
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 
+#include "Pins.h"
 #include "UMPProcessing.h"
 #include "SerialBracketing.h"
 #include "dump_packet.h"
@@ -24,47 +27,63 @@ static void sendPacket(const midi::universal_packet &p)
 
 static UMPProcessing type25Serial("ProtoZOA Type25", sendPacket);
 
+static TaskHandle_t type25Task = nullptr;
+
+static void uart_rx_irq_handler()
+{
+    // RX interrupts are level triggered, re-enabled once the FIFO got drained
+    uart_set_irq_enables(uart1, false, false);
+    notifyTaskFromISR(type25Task);
+}
+
 extern "C" void pvrType25Serial(void * /*pvParameters*/)
 {
     //--------- Set up Expansion Port
     uart_init(uart1, 115200);
-    gpio_set_function(8, GPIO_FUNC_UART);
-    gpio_set_function(9, GPIO_FUNC_UART);
+    gpio_set_function(ExpansionUartTxPin, GPIO_FUNC_UART);
+    gpio_set_function(ExpansionUartRxPin, GPIO_FUNC_UART);
 
     while (uart_is_readable(uart1)) auto c = uart_getc(uart1);
 
+    type25Task = xTaskGetCurrentTaskHandle();
+    type25Serial.addPendingUMPsReader(notifyTask, type25Task);
+
+    irq_set_exclusive_handler(UART1_IRQ, uart_rx_irq_handler);
+    irq_set_enabled(UART1_IRQ, true);
+
     printf("Type25 Serial task initialized.\n");
 
     while (1)
     {
-        taskYIELD();
-        
-        type25Serial.sendPendingUMPs();
+        const uint32_t untilSend = type25Serial.sendPendingUMPs();
         
-        // Read From Serial
-        char uBuf[1];
+        // Read From Serial, decode whole chunks
+        uint8_t uBuf[32]; // UART FIFO depth
+        midi::universal_packet packets[8];
         while (uart_is_readable(uart1))
         {
-            uBuf[0] = uart_getc(uart1);
+            size_t numBytes = 0;
+            while ((numBytes < sizeof(uBuf)) && uart_is_readable(uart1))
+                uBuf[numBytes++] = uart_getc(uart1);
 
-            switch (bracketing.feed(uBuf[0]))
+            size_t pos = 0;
+            while (pos < numBytes)
             {
-            case SerialBracketing::SUCCESS:
-                TRACE_INCOMING_PACKET("Type25 in", bracketing.ump);
-                type25Serial.process(bracketing.ump);
-                break;
-            case SerialBracketing::CRC_ERROR:
-                dump_packet("Type25 CRC error: ", bracketing.ump);
-              #if PROTOZOA_SERIAL_BRACKET16
-                printf("  expected 0x%02x, is 0x%02x\n", unsigned(uBuf[0]), unsigned(bracketing.checksum()));
-              #endif
-                break;
-            case SerialBracketing::INVALID_UMP:
-                dump_packet("Type25 Invalid UMP: ", bracketing.ump);
-                break;
-            default:
-                break;
+                size_t numPackets;
+                pos += bracketing.feed(uBuf + pos, numBytes - pos, packets, 8, numPackets);
+                for (size_t i = 0; i < numPackets; ++i)
+                {
+                    TRACE_INCOMING_PACKET("Type25 in", packets[i]);
+                    type25Serial.process(packets[i]);
+                }
             }
         }
+
+        if (const uint32_t errors = bracketing.takeErrors())
+            printf("Type25 in: %u broken packets\n", unsigned(errors));
+        uart_set_irq_enables(uart1, true, false);
+
+        // wait for received bytes, pending UMPs or timed output
+        ulTaskNotifyTake(pdTRUE, ticksUntil(untilSend));
     }
 }
@@ -1,24 +1,34 @@
 #include "UMPProcessing.h"
 
+#include "Board.h"
 #include "CMEWidiTask.h"
+#include "ControlState.h"
 #include "DINSerialTask.h"
-#include "FreeRTOS_Tasks.h"
-#include "PicoMainTask.h"
+#include "Entropy.h"
+#include "Groups.h"
+#include "BlockPool.h"
+#include "PackedSysex7.h"
 #include "PEHeaderParser.h"
+#include "UMPRouter.h"
+#include "UMPScheduler.h"
+#include "dump_packet.h"
 
-#include "pico/unique_id.h"
-
-#include <midi/channel_voice_message.h>
 #include <midi/midi1_byte_stream.h>
 #include <midi/stream_message.h>
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <iterator>
 
 constexpr auto my_identity = midi::device_identity { 0x7D, 0, 0, 1 };
 constexpr std::string_view my_ResourceList {
 R"([
   {"resource":"DeviceInfo"},
-  {"resource":"ChannelList"}
+  {"resource":"ChannelList","canPaginate":true,"encodings":["ASCII","Mcoded7","zlib+Mcoded7"]},
+  {"resource":"ProgramList","canPaginate":true,"encodings":["ASCII","Mcoded7","zlib+Mcoded7"]},
+  {"resource":"X-ControlState","canSubscribe":true},
+  {"resource":"X-Settings","canSet":"partial","canSubscribe":true}
 ])" };
 
 constexpr std::string_view my_DeviceInfo {
@@ -33,26 +43,192 @@ R"({
   "version": "0.0.1"
 })" };
 
-constexpr std::string_view my_ChannelList {
-R"([
-{
+// list resources are kept as entries, so they can be paged with offset / limit
+constexpr std::string_view my_ChannelList[] {
+R"({
   "title":"ch1",
   "channel":1
+})" };
+
+constexpr std::string_view my_ProgramList[] {
+  R"({"title":"Grand Piano","bankPC":[0,0,0]})",
+  R"({"title":"Electric Piano","bankPC":[0,0,4]})",
+  R"({"title":"Organ","bankPC":[0,0,16]})",
+  R"({"title":"Nylon Guitar","bankPC":[0,0,24]})",
+  R"({"title":"Acoustic Bass","bankPC":[0,0,32]})",
+  R"({"title":"Strings","bankPC":[0,0,48]})",
+  R"({"title":"Choir","bankPC":[0,0,52]})",
+  R"({"title":"Trumpet","bankPC":[0,0,56]})",
+  R"({"title":"Flute","bankPC":[0,0,73]})",
+  R"({"title":"Synth Lead","bankPC":[0,0,80]})",
+  R"({"title":"Synth Pad","bankPC":[0,0,88]})",
+  R"({"title":"Drum Kit","bankPC":[120,0,0]})",
+};
+
+// MIDI-CI replies packed into UMPs at compile time, only group, MUIDs and a few fields get patched when sent
+namespace ciReply {
+
+constexpr uint8_t version { 0x02 };
+constexpr size_t sourceMUID { 5 };
+constexpr size_t destinationMUID { 9 };
+constexpr size_t categories { 24 };
+constexpr size_t outputPathId { 29 };
+constexpr size_t functionBlock { 30 };
+
+// single byte manufacturer IDs are sent as (id, 0, 0)
+constexpr uint8_t manufacturerByte(uint32_t m, int i)
+{
+    return (m <= 0x7F) ? ((i == 0) ? uint8_t(m) : 0) : uint8_t((m >> (8 * (2 - i))) & 0x7F);
 }
-])" };
 
-static uint32_t random(uint32_t max)
+constexpr uint8_t discoveryBytes[] {
+    0x7E, 0x7F, 0x0D, 0x71, version,
+    0, 0, 0, 0,                                             // source MUID
+    0, 0, 0, 0,                                             // destination MUID
+    manufacturerByte(my_identity.manufacturer, 0),
+    manufacturerByte(my_identity.manufacturer, 1),
+    manufacturerByte(my_identity.manufacturer, 2),
+    uint8_t(my_identity.family & 0x7F), uint8_t((my_identity.family >> 7) & 0x7F),
+    uint8_t(my_identity.model & 0x7F), uint8_t((my_identity.model >> 7) & 0x7F),
+    uint8_t(my_identity.revision & 0x7F), uint8_t((my_identity.revision >> 7) & 0x7F),
+    uint8_t((my_identity.revision >> 14) & 0x7F), uint8_t((my_identity.revision >> 21) & 0x7F),
+    uint8_t(midi::ci::category::property_exchange),
+    uint8_t(UMPProcessing::maxSysexMessageSize & 0x7F), uint8_t((UMPProcessing::maxSysexMessageSize >> 7) & 0x7F),
+    uint8_t((UMPProcessing::maxSysexMessageSize >> 14) & 0x7F), uint8_t((UMPProcessing::maxSysexMessageSize >> 21) & 0x7F),
+    0,                                                      // output path id
+    0,                                                      // function block
+};
+static_assert(std::size(discoveryBytes) == functionBlock + 1, "discovery reply layout");
+
+constexpr uint8_t peCapabilitiesBytes[] {
+    0x7E, 0x7F, 0x0D, 0x31, version,
+    0, 0, 0, 0,                                             // source MUID
+    0, 0, 0, 0,                                             // destination MUID
+    1,                                                      // simultaneous requests
+    0, 0,                                                   // Property Exchange major / minor version
+};
+
+constexpr PackedSysex7 discovery { discoveryBytes };
+constexpr PackedSysex7 peCapabilities { peCapabilitiesBytes };
+
+} // namespace ciReply
+
+// MIDI-CI Profile Configuration, see processMIDICIProfile
+namespace ciProfile {
+
+constexpr uint8_t inquiry { 0x20 };
+constexpr uint8_t inquiryReply { 0x21 };
+constexpr uint8_t setOn { 0x22 };
+constexpr uint8_t setOff { 0x23 };
+constexpr uint8_t enabledReport { 0x24 };
+constexpr uint8_t disabledReport { 0x25 };
+constexpr uint8_t detailsInquiry { 0x28 };
+constexpr uint8_t detailsReply { 0x29 };
+constexpr uint8_t nak { 0x7F };
+
+constexpr uint8_t toGroup { 0x7E };
+constexpr uint8_t toFunctionBlock { 0x7F };
+constexpr uint32_t broadcastMUID { 0x0FFFFFFF };
+
+// sysex7 data: device id, sub id, subtype, version, source / destination MUID, body
+constexpr size_t headerSize { 12 };
+constexpr size_t maxReplySize { headerSize + 4 + 5 * ProfileRegistry::maxProfiles };
+constexpr size_t maxDetailsSize { 32 };
+
+// the function block of a group spans the group only, so both address the group wide profiles
+constexpr uint8_t target(uint8_t deviceId)
+{
+    return (deviceId < 16) ? deviceId
+         : ((deviceId == toGroup) || (deviceId == toFunctionBlock)) ? ProfileRegistry::groupTarget : 0xFF;
+}
+
+static uint8_t *writeHeader(uint8_t *p, uint8_t deviceId, uint8_t subtype, uint32_t source, uint32_t destination)
+{
+    *p++ = deviceId;
+    *p++ = 0x0D;
+    *p++ = subtype;
+    *p++ = ciReply::version;
+    for (int i = 0; i < 4; ++i, source >>= 7)
+        *p++ = source & 0x7F;
+    for (int i = 0; i < 4; ++i, destination >>= 7)
+        *p++ = destination & 0x7F;
+    return p;
+}
+
+static uint8_t *writeId(uint8_t *p, const ProfileRegistry::ProfileId &id)
+{
+    for (const uint8_t b : id)
+        *p++ = b;
+    return p;
+}
+
+// Drawbar Organ profile on channel 1 of Main, as announced by UUT/USB_FunctionBlocks
+constexpr ProfileRegistry::ProfileId drawbarOrgan { 0x7E, 0x21, 0x01, 0x01, 0x02 };
+
+static int drawbarOrganDetails(uint8_t target, uint8_t *dst, size_t size)
+{
+    if ((target != 1) || (size < 1))
+        return -1;
+
+    dst[0] = 0b1111; // supported drawbars
+    return 1;
+}
+
+} // namespace ciProfile
+
+static void defaultRoutes(UMPRouter &router)
+{
+    router.setSink(UMPRouter::DINPortDestination, writeDINPort);
+#if PROTOZOA_EXPANSION_CME_WIDI_CORE
+    router.setSink(UMPRouter::CMEWidiDestination, [](const midi::universal_packet &p) { CMEWidiSendBuffer.write(p); });
+#endif
+
+    router.setRoute(MainGroup, UMPRouter::MainDestination, UMPRouter::allMessageTypes);
+    // MIDI 1.0 byte stream ports only understand MIDI 1.0 channel voice messages
+    for (const DINPortConfig &port : dinPortConfigs)
+        router.setRoute(port.outGroup, UMPRouter::DINPortDestination, UMPRouter::allMessageTypes, UMPRouter::Translation::MIDI1);
+#if PROTOZOA_EXPANSION_CME_WIDI_CORE
+    router.setRoute(CMEWidiGroup, UMPRouter::CMEWidiDestination, UMPRouter::allMessageTypes, UMPRouter::Translation::MIDI1);
+#endif
+}
+
+UMPRouter umpRouter { defaultRoutes };
+
+#if NIMIDI2_CUSTOM_SYSEX_DATA_ALLOCATOR
+static bool sysexPoolsHaveRoom();
+static void dropSysexMessage();
+static void dumpSysexPoolStatistics();
+#endif
+
+static void schedulePacket(const midi::universal_packet &p, UMPRouter::sendPacketProc *sink, uint32_t time)
 {
-    return (rand() % static_cast<uint32_t>(max + 1));
+    umpScheduler.schedule(p, sink, time);
 }
 
-UMPProcessing::UMPProcessing(std::string_view epName, sendPacketProc s) :
+UMPProcessing::UMPProcessing(std::string_view epName, sendPacketProc s, sendWordsProc *w) :
+    UMPProcessing(epName, s, w, std::make_index_sequence<numFunctionBlocks>{})
+{
+}
+
+template <size_t... FunctionBlock>
+UMPProcessing::UMPProcessing(std::string_view epName, sendPacketProc s, sendWordsProc *w, std::index_sequence<FunctionBlock...>) :
     m_endpointName(epName),
     sendPacket(s),
-    m_muid(random(0xFFFFEFF)),
-    m_ciMain([this](const midi::sysex7 &sx) { this->processSysexMessage(sx); })
+    sendWords(w),
+    m_ci{ { *this, midi::group_t(FunctionBlock) }... }
+{
+    m_profiles.add(ciProfile::drawbarOrgan, MainGroup, 0x0001, false, nullptr, ciProfile::drawbarOrganDetails);
+}
+
+UMPProcessing::CIAgent::CIAgent(UMPProcessing &owner, midi::group_t g) :
+    group(g),
+    muid(entropy.makeMUID()),
+    classifier((g == MainGroup) ? SysexClassifier::CapabilityInquiry | SysexClassifier::IdentityRequest | SysexClassifier::OwnManufacturer
+                                : SysexClassifier::CapabilityInquiry,
+               my_identity.manufacturer),
+    collector([&owner, this](const midi::sysex7 &sx) { owner.processSysexMessage(sx, *this); })
 {
-    m_ciMain.set_max_sysex_data_size(maxSysexMessageSize-1);
+    collector.set_max_sysex_data_size(maxSysexMessageSize-1);
 }
 
 void UMPProcessing::process(const midi::universal_packet &p)
@@ -60,7 +236,7 @@ void UMPProcessing::process(const midi::universal_packet &p)
     switch (p.type())
     {
     case midi::packet_type::utility:
-        // TODO: JR timestamps
+        processUtilityMessage(p);
         return;
     case midi::packet_type::stream:
         processStreamMessage(p);
@@ -69,90 +245,228 @@ void UMPProcessing::process(const midi::universal_packet &p)
         break;
     }
 
-    switch (p.group())
+    // enabled profiles filter or transform channel voice messages before they get routed
+    midi::universal_packet routed = p;
+    if (!m_profiles.filter(routed))
+        return;
+
+    const bool toMain = m_jrTimestampValid ? umpRouter.route(routed, schedulePacket, m_jrTime)
+                                           : umpRouter.route(routed);
+
+    // every function block answers MIDI-CI on its own group, with its own collector,
+    // so inquiries on several groups are handled concurrently. Only messages for the
+    // local handlers are reassembled, all others (and SysEx8 / Mixed Data Set) have
+    // already been passed on to the routed sinks packet by packet.
+    if ((p.type() == midi::packet_type::data) && midi::is_sysex7_packet(p) && (p.group() < numFunctionBlocks))
     {
-    case MainGroup:
-        switch (p.type())
+        CIAgent &agent = m_ci[p.group()];
+        if ((toMain || (agent.group != MainGroup)) && agent.classifier.collect(p))
         {
-        case midi::packet_type::data:
-            if (midi::is_sysex7_packet(p))
+#if NIMIDI2_CUSTOM_SYSEX_DATA_ALLOCATOR
+            // a message is only collected if the pools can hold it and a reply,
+            // otherwise it is dropped as a whole
+            const uint8_t status = (p.data[0] >> 20) & 0x0F;
+            if ((status == 0x0) || (status == 0x1))
             {
-                m_ciMain.feed(p);
+                agent.dropping = !sysexPoolsHaveRoom();
+                if (agent.dropping)
+                    dropSysexMessage();
             }
-            break;
-        default:
-            break;
-        }
-        return;
-    case DINPortsGroup:
-        DINPortSendBuffer.write(p);
-        return;
-#if PROTOZOA_EXPANSION_CME_WIDI_CORE
-    case CMEWidiGroup:
-        CMEWidiSendBuffer.write(p);
-        return;
+            if (agent.dropping)
+                return;
 #endif
-    default:
-        break;
+            agent.collector.feed(p);
+        }
     }
 }
 
-void UMPProcessing::sendPendingUMPs()
+uint32_t UMPProcessing::sendPendingUMPs()
 {
-    midi::universal_packet p;
+    uint32_t untilCall = UINT32_MAX;
+    if (!m_subscriptions.empty())
+    {
+        sendPropertyNotifications();
+        untilCall = m_subscriptions.notify_interval();
+    }
 
-    // Read DIN port
-    while (DINPortReceiveBuffer.read(m_DINReadPtr, p))
+    const uint8_t numSources = umpSources.size();
+    if (numSources == 0)
+        return untilCall;
+
+    // Jitter Reduction: a clock at least every jrClockPeriod, the sources' ingress
+    // timestamps ahead of the forwarded UMPs, see forwardUMPs
+    if (curExtensions & jr::transmit)
     {
-        sendPacket(p);
+        const uint32_t now = board::timeUs();
+        if (now - m_jrClockSent >= jrClockPeriod)
+        {
+            sendPacket(jr::makeClock(jr::ticks(now)));
+            m_jrClockSent = now;
+        }
+        const uint32_t untilClock = jrClockPeriod - (now - m_jrClockSent);
+        if (untilClock < untilCall)
+            untilCall = untilClock;
+    }
+    else
+    {
+        m_jrTimestampSent = 0;
     }
 
-#if PROTOZOA_EXPANSION_CME_WIDI_CORE
-    // Read BT port
-    while (CMEWidiReceiveBuffer.read(m_BTReadPtr, p))
+    // weighted round robin over the sources with pending UMPs,
+    // every call starts with the next source
+    m_sinkFull = false;
+    uint32_t pending = (1u << numSources) - 1;
+    for (uint8_t s = m_nextSource; pending; s = (s + 1 < numSources) ? s + 1 : 0)
     {
-        sendPacket(p);
+        if ((pending & (1u << s)) && !forwardUMPs(s))
+            pending &= ~(1u << s);
     }
+    m_nextSource = (m_nextSource + 1 < numSources) ? m_nextSource + 1 : 0;
+
+    for (uint8_t s = 0; s < numSources; ++s)
+        dump_dropped(umpSources[s].name, m_readPtrs[s]);
+#if NIMIDI2_CUSTOM_SYSEX_DATA_ALLOCATOR
+    dumpSysexPoolStatistics();
 #endif
 
-    // Read control events
-    while (ControlMessageBuffer.read(m_controlReadPtr, p))
+    return m_sinkFull ? 0 : untilCall;
+}
+
+bool UMPProcessing::forwardUMPs(uint8_t s)
+{
+    const UMPSource &source = umpSources[s];
+    UMPReadPtr &readPtr = m_readPtrs[s];
+    const bool translate = (source.protocol != curProtocol);
+    uint16_t quantum = source.quantum;
+
+    // the JR Timestamps of the source (see JRIngressStamp) are taken out of the
+    // stream, each is sent ahead of the packets it stamps if JR is enabled
+    if (sendWords && !translate)
     {
-        switch (curProtocol)
+        // forward in place, one call per contiguous burst of packets of the same ingress time
+        while (quantum)
         {
-        case midi::protocol::midi1:
-            if (p.type() == midi::packet_type::midi2_channel_voice)
+            const auto span = source.peekSpan(source.buffer, readPtr, quantum);
+            if (span.numWords == 0)
+                return false;
+
+            const uint32_t word0 = span.words[0];
+            if (jr::isTimestamp(word0))
             {
-                if (auto m = midi::as_midi1_channel_voice_message(midi::midi2_channel_voice_message_view{ p }))
-                {
-                    sendPacket(*m);
-                }
+                if (source.commit(source.buffer, readPtr, UMPSpan{ span.words, 1, 1 }))
+                    m_jrIngress[s] = word0;
                 continue;
             }
-            break;
-        case midi::protocol::midi2:
-            if (p.type() == midi::packet_type::midi1_channel_voice)
+
+            UMPSpan run { span.words, 0, 0 };
+            while ((run.numPackets < span.numPackets) && !jr::isTimestamp(span.words[run.numWords]))
+            {
+                run.numWords += midi::universal_packet{ span.words[run.numWords] }.size();
+                ++run.numPackets;
+            }
+
+            sendJRTimestamp(s);
+            const size_t accepted = sendWords(run.words, run.numWords);
+
+            // the sink accepts complete packets only, commit those and keep the rest pending
+            UMPSpan sent { run.words, 0, 0 };
+            while (sent.numWords < accepted)
+            {
+                sent.numWords += midi::universal_packet{ run.words[sent.numWords] }.size();
+                ++sent.numPackets;
+            }
+            if (!source.commit(source.buffer, readPtr, sent))
+                continue; // overrun while sending, readPtr resynchronized
+            if (sent.numPackets < run.numPackets)
             {
-                if (auto m = midi::as_midi2_channel_voice_message(midi::midi1_channel_voice_message_view{ p }))
-                {
-                    sendPacket(*m);
-                }
+                m_sinkFull = true; // retried on the next call
+                if (sent.numPackets == 0)
+                    m_jrTimestampSent = 0; // the timestamp may not have fit either
+                return false;
+            }
+            quantum -= run.numPackets;
+        }
+    }
+    else
+    {
+        midi::universal_packet p;
+        while (quantum)
+        {
+            if (!source.read(source.buffer, readPtr, p))
+                return false;
+
+            if (jr::isTimestamp(p.data[0]))
+            {
+                m_jrIngress[s] = p.data[0];
                 continue;
             }
-            break;
+
+            sendJRTimestamp(s);
+            if (translate)
+                sendTranslated(p, m_translators[s]);
+            else
+                sendPacket(p);
+            --quantum;
         }
+    }
+
+    // quantum used up, more may be pending
+    return true;
+}
 
-        sendPacket(p);
+void UMPProcessing::sendTranslated(const midi::universal_packet &p, ProtocolTranslator &translator)
+{
+    midi::universal_packet translated[ProtocolTranslator::maxPackets];
+    const uint8_t numPackets = (curProtocol == midi::protocol::midi2) ? translator.toMIDI2(p, translated)
+                                                                      : ProtocolTranslator::toMIDI1(p, translated);
+    for (uint8_t i = 0; i < numPackets; ++i)
+        sendPacket(translated[i]);
+}
+
+void UMPProcessing::sendJRTimestamp(uint8_t source)
+{
+    // a timestamp holds until the next one, so only a change is sent
+    const uint32_t timestamp = m_jrIngress[source];
+    if ((curExtensions & jr::transmit) && timestamp && (timestamp != m_jrTimestampSent))
+    {
+        sendPacket(midi::universal_packet{ timestamp });
+        m_jrTimestampSent = timestamp;
     }
 }
 
 void UMPProcessing::clearPendingUMPs()
 {
-    DINPortReceiveBuffer.resetReadPtr(m_DINReadPtr);
-#if PROTOZOA_EXPANSION_CME_WIDI_CORE
-    CMEWidiReceiveBuffer.resetReadPtr(m_BTReadPtr);
-#endif
-    ControlMessageBuffer.resetReadPtr(m_controlReadPtr);
+    for (uint8_t s = 0; s < umpSources.size(); ++s)
+    {
+        umpSources[s].resetReadPtr(umpSources[s].buffer, m_readPtrs[s]);
+        m_translators[s].reset();
+        m_jrIngress[s] = 0;
+    }
+    m_jrTimestampSent = 0;
+}
+
+void UMPProcessing::addPendingUMPsReader(UMPReaderNotifyProc *notify, void *reader)
+{
+    for (uint8_t s = 0; s < umpSources.size(); ++s)
+        umpSources[s].addReader(umpSources[s].buffer, notify, reader);
+}
+
+void UMPProcessing::processUtilityMessage(const midi::universal_packet &p)
+{
+    switch (jr::status(p))
+    {
+    case jr::clockStatus:
+        m_jrClock.clock(jr::time(p), board::timeUs());
+        break;
+    case jr::timestampStatus:
+        // applies to all following messages up to the next timestamp,
+        // routed messages are then released by the UMPScheduler
+        m_jrTimestampValid = m_jrClock.localTime(jr::time(p), m_jrTime);
+        m_jrTime += jrPlayoutDelay;
+        break;
+    default:
+        break;
+    }
 }
 
 void UMPProcessing::processStreamMessage(const midi::universal_packet &p)
@@ -177,7 +491,7 @@ void UMPProcessing::processEndpointDiscovery(const midi::endpoint_discovery_view
 
     if (m.requests_info())
     {
-        constexpr auto endpoint_info = midi::make_endpoint_info_message(3, true, midi::protocol::midi1 + midi::protocol::midi2, 0);
+        constexpr auto endpoint_info = midi::make_endpoint_info_message(numFunctionBlocks, true, midi::protocol::midi1 + midi::protocol::midi2, jr::transmit | jr::receive);
         sendPacket(endpoint_info);
     }
 
@@ -194,14 +508,7 @@ void UMPProcessing::processEndpointDiscovery(const midi::endpoint_discovery_view
 
     if (m.requests_product_instance_id())
     {
-        const static std::string_view product_instance_id = []() {
-            constexpr size_t strLength = 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1;
-            static char idStr[strLength];
-            pico_get_unique_board_id_string(idStr, strLength);
-            return std::string_view(idStr, strLength-1);
-        }();
-
-        midi::send_product_instance_id(product_instance_id, sendPacket);
+        midi::send_product_instance_id(board::idString(), sendPacket);
     }
 
     if (m.requests_stream_configuration())
@@ -288,6 +595,26 @@ void UMPProcessing::processFunctionBlockDiscovery(const midi::function_block_dis
             sendPacket(reply);
         }
       #endif
+
+        // the additional DIN ports are bidirectional, one group each
+        for (size_t port = 1; port < numDINPorts; ++port)
+        {
+            const midi::group_t group = dinPortConfigs[port].outGroup;
+            if (m.requests_function_block(group))
+            {
+                sendPacket(midi::make_function_block_info_message(
+                    group,
+                    midi::function_block_options{
+                        true,
+                        midi::function_block_options::bidirectional,
+                        midi::function_block_options::midi1_31250,
+                        midi::function_block_options::ui_hint_as_direction,
+                        0x00,
+                        0
+                    },
+                    group));
+            }
+        }
     }
 
     if (m.requests_name())
@@ -329,6 +656,14 @@ void UMPProcessing::processFunctionBlockDiscovery(const midi::function_block_dis
             sendPacket(reply);
         }
       #endif
+
+        static constexpr const char *dinPortNames[] = { "5-pin DIN", "5-pin DIN 2", "5-pin DIN 3", "5-pin DIN 4" };
+        for (size_t port = 1; port < numDINPorts; ++port)
+        {
+            const midi::group_t group = dinPortConfigs[port].outGroup;
+            if (m.requests_function_block(group))
+                sendPacket(midi::make_function_block_name_message(midi::packet_format::complete, group, dinPortNames[port]));
+        }
     }
 }
 
@@ -340,22 +675,54 @@ void UMPProcessing::processStreamConfigurationRequest(const midi::stream_configu
     {
     case midi::protocol::midi1:
     case midi::protocol::midi2:
-        curProtocol = m.protocol();
+        if (curProtocol != m.protocol())
+        {
+            curProtocol = m.protocol();
+            for (auto &t : m_translators)
+                t.reset();
+        }
         break;
     }
 
+    curExtensions = m.extensions() & (jr::transmit | jr::receive);
+    if (!(curExtensions & jr::receive))
+    {
+        m_jrClock.reset();
+        m_jrTimestampValid = false;
+    }
+
     sendPacket(midi::make_stream_configuration_notification(curProtocol, curExtensions));
 }
 
-void UMPProcessing::processSysexMessage(const midi::sysex7 &sx)
+void UMPProcessing::processSysexMessage(const midi::sysex7 &sx, CIAgent &agent)
 {
-    if (midi::universal_sysex::is_identity_request(sx))
+    if (agent.group != MainGroup)
+    {
+        if (midi::is_capability_inquiry_message(sx))
+            processMIDICIMessage(sx, agent);
+    }
+    else if (midi::universal_sysex::is_identity_request(sx))
     {
         sendSysex(midi::universal_sysex::make_identity_reply(my_identity));
     }
     else if (midi::is_capability_inquiry_message(sx))
     {
-        processMIDICIMessage(midi::capability_inquiry_view{ sx });
+        processMIDICIMessage(sx, agent);
+    }
+    else if (sx.manufacturerID == my_identity.manufacturer)
+    {
+        uint8_t reply[UMPRouter::maxConfigReplySize];
+        const int replySize = umpRouter.processConfigMessage(sx.data.data(), sx.data.size(), reply);
+        if (replySize < 0)
+        {
+            printf("sysex7: invalid routing configuration message\n");
+        }
+        else if (replySize > 0)
+        {
+            midi::sysex7 replySx { my_identity.manufacturer };
+            replySx.data.assign(reply, reply + replySize);
+            sendSysex(replySx);
+        }
     }
     else
     {
@@ -365,12 +732,14 @@ void UMPProcessing::processSysexMessage(const midi::sysex7 &sx)
     }
 }
 
-void UMPProcessing::processMIDICIMessage(const midi::capability_inquiry_view& msg)
+void UMPProcessing::processMIDICIMessage(const midi::sysex7 &sx, CIAgent &agent)
 {
     using namespace midi::ci;
 
+    const midi::capability_inquiry_view msg { sx };
+
     // ignore requests with invalid muids
-    if ((msg.destination_muid() != m_muid) && (msg.destination_muid() != broadcast_muid))
+    if ((msg.destination_muid() != agent.muid) && (msg.destination_muid() != broadcast_muid))
     {
         printf("midi-ci: request with non-matching muid\n");
         return;
@@ -379,33 +748,74 @@ void UMPProcessing::processMIDICIMessage(const midi::capability_inquiry_view& ms
     switch (msg.subtype())
     {
     case subtype::discovery_inquiry:
-        printf("midi-ci: discovery_inquiry\n");
+        printf("midi-ci: discovery_inquiry (group %u)\n", unsigned(agent.group));
         if (auto di = msg.as<discovery_inquiry_view>())
         {
-            printf("sendSysex(make_discovery_reply)\n");
-            sendSysex(make_discovery_reply(
-                m_muid, di->source_muid(), my_identity, category::property_exchange, maxSysexMessageSize, di->output_path_id(), 0));
+            printf("send discovery reply\n");
+            auto reply = ciReply::discovery;
+            reply.setGroup(agent.group);
+            reply.setMUID(ciReply::sourceMUID, agent.muid);
+            reply.setMUID(ciReply::destinationMUID, di->source_muid());
+            reply.setByte(ciReply::outputPathId, di->output_path_id());
+            reply.setByte(ciReply::functionBlock, agent.group);
+            // Property Exchange is served by Main only
+            reply.setByte(ciReply::categories,
+                ((agent.group == MainGroup) ? uint8_t(category::property_exchange) : 0) |
+                (m_profiles.supportsGroup(agent.group) ? uint8_t(category::profile_configuration) : 0));
+            sendPackedSysex(reply.words(), reply.numWords);
         
             return;
         }
-        break;
+        printf("midi-ci: invalid / corrupted message\n");
+        return;
     case subtype::invalidate_muid:
         printf("midi-ci: invalidate_muid\n");
         if (auto im = msg.as<invalidate_muid_view>())
         {
-            // if our muid is invalidated, generate a new one
-            if (im->source_muid() == m_muid)
-                m_muid = random(0xFFFFEFF);
+            // the MUID invalidated is the target MUID in the body, the sender is just announcing it.
+            // If it is ours, generate a new one, different from all MUIDs in use
+            const auto target = im->target_muid();
+            if (target == agent.muid)
+            {
+                uint32_t inUse[numFunctionBlocks];
+                for (uint8_t fb = 0; fb < numFunctionBlocks; ++fb)
+                    inUse[fb] = m_ci[fb].muid;
+                agent.muid = entropy.makeMUID(inUse, numFunctionBlocks);
+            }
+            else if (agent.group == MainGroup)
+                m_subscriptions.end_all(target);
 
             return;
         }
+        printf("midi-ci: invalid / corrupted message\n");
+        return;
+    case ciProfile::inquiry:
+    case ciProfile::setOn:
+    case ciProfile::setOff:
+    case ciProfile::detailsInquiry:
+        processMIDICIProfile(sx, agent);
+        return;
+    default:
         break;
+    }
+
+    if (agent.group != MainGroup)
+    {
+        printf("midi-ci: unhandled request %02X (group %u)\n", (int)msg.subtype(), unsigned(agent.group));
+        return;
+    }
+
+    switch (msg.subtype())
+    {
     case subtype::property_exchange_capabilities_inquiry:
         printf("midi-ci: property_exchange_capabilities_inquiry\n");
         if (auto peci = msg.as<property_exchange_capabilities_view>())
         {
-            printf("sendSysex(make_property_exchange_capabilities_reply)\n");
-            sendSysex(make_property_exchange_capabilities_reply(m_muid, peci->source_muid()));
+            printf("send property_exchange_capabilities reply\n");
+            auto reply = ciReply::peCapabilities;
+            reply.setMUID(ciReply::sourceMUID, agent.muid);
+            reply.setMUID(ciReply::destinationMUID, peci->source_muid());
+            sendPackedSysex(reply.words(), reply.numWords);
         
             return;
         }
@@ -419,6 +829,23 @@ void UMPProcessing::processMIDICIMessage(const midi::capability_inquiry_view& ms
             return;
         }
         break;
+    case PEMessage::set_property_data_inquiry:
+    case PEMessage::subscription_inquiry:
+    case PEMessage::subscription_reply:
+        {
+            PEMessage pe;
+            if (pe.parse(sx.data.data(), sx.data.size()))
+            {
+                if (pe.subtype == PEMessage::set_property_data_inquiry)
+                    processMIDICISetProperty(pe);
+                else if (pe.subtype == PEMessage::subscription_inquiry)
+                    processMIDICISubscription(pe);
+                // subscription replies just acknowledge our notifications
+
+                return;
+            }
+        }
+        break;
     default:
         printf("midi-ci: unhandled request %02X\n", (int)msg.subtype());
         return;
@@ -427,64 +854,708 @@ void UMPProcessing::processMIDICIMessage(const midi::capability_inquiry_view& ms
     printf("midi-ci: invalid / corrupted message\n");
 }
 
-void UMPProcessing::processMIDICIGetProperty(const midi::ci::get_property_data_view& msg)
+void UMPProcessing::processMIDICIProfile(const midi::sysex7 &sx, CIAgent &agent)
 {
-    using namespace midi::ci;
+    using namespace ciProfile;
+
+    const uint8_t *data = sx.data.data();
+    const size_t size = sx.data.size();
+    if (size < headerSize)
+    {
+        printf("midi-ci: invalid / corrupted message\n");
+        return;
+    }
+
+    const uint8_t deviceId = data[0];
+    const uint8_t subtype = data[2];
+    const uint32_t source = data[4] | (data[5] << 7) | (data[6] << 14) | (uint32_t(data[7]) << 21);
+    const uint8_t t = target(deviceId);
+    if (t == 0xFF)
+    {
+        printf("midi-ci: profile message to invalid device id %02X\n", (int)deviceId);
+        return;
+    }
+
+    if (subtype == inquiry)
+    {
+        printf("midi-ci: profile_inquiry (group %u, device id %02X)\n", unsigned(agent.group), (int)deviceId);
+
+        // an inquiry to the function block is answered for all its channels as well
+        if (deviceId == toFunctionBlock)
+        {
+            for (uint8_t ch = 0; ch < 16; ++ch)
+            {
+                bool supported = false;
+                m_profiles.forEach(agent.group, ch, [&supported](uint8_t, const ProfileRegistry::Profile&) { supported = true; });
+                if (supported)
+                    sendProfileInquiryReply(agent, source, ch);
+            }
+        }
+        sendProfileInquiryReply(agent, source, deviceId);
+        return;
+    }
+
+    if (size < headerSize + 5)
+    {
+        printf("midi-ci: invalid / corrupted message\n");
+        return;
+    }
+
+    ProfileRegistry::ProfileId id;
+    for (size_t i = 0; i < id.size(); ++i)
+        id[i] = data[headerSize + i];
+
+    switch (subtype)
+    {
+    case setOn:
+    case setOff:
+    {
+        // multi channel profiles are not supported, the requested number of channels is ignored
+        const bool on = (subtype == setOn);
+        printf("midi-ci: set_profile_%s (group %u, device id %02X)\n", on ? "on" : "off", unsigned(agent.group), (int)deviceId);
+        const bool done = on ? m_profiles.enable(id, agent.group, t) : m_profiles.disable(id, agent.group, t);
+        if (done)
+            sendProfileReport(agent, on ? enabledReport : disabledReport, deviceId, id);
+        else
+            sendCINAK(agent, source, deviceId, subtype, id.data());
+        break;
+    }
+    case detailsInquiry:
+    {
+        printf("midi-ci: profile_details_inquiry (group %u, device id %02X)\n", unsigned(agent.group), (int)deviceId);
+        const int n = m_profiles.find(id, agent.group, t);
+        const uint8_t inquiryTarget = (size > headerSize + 5) ? data[headerSize + 5] : 0;
+
+        uint8_t reply[headerSize + 8 + maxDetailsSize];
+        uint8_t *p = writeHeader(reply, deviceId, detailsReply, agent.muid, source);
+        p = writeId(p, id);
+        *p++ = inquiryTarget;
+
+        const int detailsSize = ((n >= 0) && m_profiles[n].details) ? m_profiles[n].details(inquiryTarget, p + 2, maxDetailsSize) : -1;
+        if (detailsSize < 0)
+        {
+            sendCINAK(agent, source, deviceId, subtype, id.data());
+            break;
+        }
+        *p++ = detailsSize & 0x7F;
+        *p++ = (detailsSize >> 7) & 0x7F;
+        p += detailsSize;
+
+        midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+        sx.data.assign(reply, p);
+        sendSysex(sx, agent.group);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void UMPProcessing::sendProfileInquiryReply(const CIAgent &agent, uint32_t destination, uint8_t deviceId)
+{
+    using namespace ciProfile;
+
+    const uint8_t t = target(deviceId);
+    uint8_t reply[maxReplySize];
+    uint8_t *p = writeHeader(reply, deviceId, inquiryReply, agent.muid, destination);
+
+    // enabled profiles first, then the disabled ones, each list preceded by its length
+    for (const bool enabled : { true, false })
+    {
+        uint8_t *count = p;
+        p += 2;
+        uint8_t numProfiles = 0;
+        m_profiles.forEach(agent.group, t, [&](uint8_t n, const ProfileRegistry::Profile &profile) {
+            if (m_profiles.isEnabled(n, agent.group, t) == enabled)
+            {
+                p = writeId(p, profile.id);
+                ++numProfiles;
+            }
+        });
+        count[0] = numProfiles;
+        count[1] = 0;
+    }
+
+    midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+    sx.data.assign(reply, p);
+    sendSysex(sx, agent.group);
+}
 
-    static const auto status_404 = property_exchange::header{ std::string_view{ "{\"status\":404}" } };
+void UMPProcessing::sendProfileReport(const CIAgent &agent, uint8_t subtype, uint8_t deviceId, const ProfileRegistry::ProfileId &id)
+{
+    using namespace ciProfile;
+
+    uint8_t report[headerSize + 7];
+    uint8_t *p = writeHeader(report, deviceId, subtype, agent.muid, broadcastMUID);
+    p = writeId(p, id);
+    // number of channels, 0 for group and function block profiles
+    *p++ = (target(deviceId) == ProfileRegistry::groupTarget) ? 0 : 1;
+    *p++ = 0;
+
+    midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+    sx.data.assign(report, p);
+    sendSysex(sx, agent.group);
+}
+
+void UMPProcessing::sendCINAK(const CIAgent &agent, uint32_t destination, uint8_t deviceId, uint8_t subtype, const uint8_t *details)
+{
+    using namespace ciProfile;
+
+    uint8_t message[headerSize + 10];
+    uint8_t *p = writeHeader(message, deviceId, nak, agent.muid, destination);
+    *p++ = subtype;
+    *p++ = 0x00; // status code: NAK
+    *p++ = 0x00; // status data
+    for (int i = 0; i < 5; ++i)
+        *p++ = details ? details[i] : 0;
+    *p++ = 0;    // no message text
+    *p++ = 0;
+
+    midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+    sx.data.assign(message, p);
+    sendSysex(sx, agent.group);
+}
+
+static bool parseNumber(const Option::Value &v, size_t &n)
+{
+    if (!v.length)
+        return false;
+
+    n = 0;
+    for (size_t i = 0; i < v.length; ++i)
+    {
+        if ((v.string[i] < '0') || (v.string[i] > '9'))
+            return false;
+        n = n * 10 + (v.string[i] - '0');
+    }
+    return true;
+}
 
+void UMPProcessing::processMIDICIGetProperty(const midi::ci::get_property_data_view& msg)
+{
     PEHeaderParser p { reinterpret_cast<const char*>(msg.header_begin()), msg.header_size() };
     Resource r { Resource::None };
     
-    if (p.get_resource(r) != 0)
+    if (const int result = p.get_resource(r))
     {
         printf("midi-ci: invalid resource requested\n");
-        sendSysex(make_get_property_data_reply(m_muid, msg.source_muid(), status_404, 1, 1, { }));
+        sendGetPropertyStatus(msg, (result == -2) ? 404 : 400);
         return;
     }
 
-    auto sendGetPropertyReply = [&](const std::string_view &payload)
+    // paging of list resources
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
+    bool paged = false;
+    Encoding encoding { Encoding::ASCII };
+
+    Option o;
+    int result;
+    while ((result = p.get_next_option(o)) == 0)
     {
-        sendSysex(make_get_property_data_reply(m_muid, msg.source_muid(), 200, 1, 1, property_exchange::chunk{ payload }, msg.request_id(), msg.device_id()));
-    };
+        switch (o.what)
+        {
+        case Option::What::Offset:
+            paged = true;
+            if (!parseNumber(o.value, offset))
+                result = -1;
+            break;
+        case Option::What::Limit:
+            paged = true;
+            if (!parseNumber(o.value, limit))
+                result = -1;
+            break;
+        case Option::What::Encoding:
+            encoding = parse_encoding(o.value.string, o.value.length);
+            break;
+        default:
+            break;
+        }
+
+        if (result < 0)
+            break;
+    }
+
+    if (result < 0)
+    {
+        printf("midi-ci: malformed request header\n");
+        sendGetPropertyStatus(msg, 400);
+        return;
+    }
 
     switch (r)
     {
     case Resource::ResourceList:
         printf("midi-ci: sendGetPropertyReply(ResourceList)\n");
-        sendGetPropertyReply(my_ResourceList);
+        sendGetPropertyReply(msg, PEReplyBody{ my_ResourceList }, encoding);
         break;
     case Resource::DeviceInfo:
         printf("midi-ci: sendGetPropertyReply(DeviceInfo)\n");
-        sendGetPropertyReply(my_DeviceInfo);
+        sendGetPropertyReply(msg, PEReplyBody{ my_DeviceInfo }, encoding);
         break;
     case Resource::ChannelList:
         printf("midi-ci: sendGetPropertyReply(ChannelList)\n");
-        sendGetPropertyReply(my_ChannelList);
+        sendGetPropertyReply(msg, PEReplyBody{ my_ChannelList, std::size(my_ChannelList), offset, limit }, encoding,
+                             paged ? int(std::size(my_ChannelList)) : -1);
         break;
-    case Resource::ChCtrlList:
     case Resource::ProgramList:
+        printf("midi-ci: sendGetPropertyReply(ProgramList)\n");
+        sendGetPropertyReply(msg, PEReplyBody{ my_ProgramList, std::size(my_ProgramList), offset, limit }, encoding,
+                             paged ? int(std::size(my_ProgramList)) : -1);
+        break;
+    case Resource::XControlState:
+    {
+        printf("midi-ci: sendGetPropertyReply(X-ControlState)\n");
+        char json[peMaxSetDataSize];
+        const size_t size = ControlState::toJSON(controlState.snapshot(), json, sizeof(json));
+        sendGetPropertyReply(msg, PEReplyBody{ std::string_view{ json, size } }, encoding);
+        break;
+    }
+    case Resource::XSettings:
+    {
+        printf("midi-ci: sendGetPropertyReply(X-Settings)\n");
+        char json[peMaxSetDataSize];
+        const int size = snprintf(json, sizeof(json), "{\"notifyInterval\":%u}",
+                                  unsigned(m_subscriptions.notify_interval() / 1000));
+        sendGetPropertyReply(msg, PEReplyBody{ std::string_view{ json, size_t(size) } }, encoding);
+        break;
+    }
+    case Resource::ChCtrlList:
     default:
         printf("midi-ci: invalid resource requested\n");
-        sendSysex(make_get_property_data_reply(m_muid, msg.source_muid(), status_404, 1, 1, { }));
+        sendGetPropertyStatus(msg, 404);
+        break;
+    }
+}
+
+//! number value of key in a flat JSON object, e.g. {"key":12}
+static bool findJSONNumber(std::string_view json, std::string_view key, size_t &n)
+{
+    for (size_t pos = json.find(key); pos != std::string_view::npos; pos = json.find(key, pos + 1))
+    {
+        size_t p = pos + key.size();
+        if ((pos == 0) || (json[pos - 1] != '"') || (p >= json.size()) || (json[p] != '"'))
+            continue;
+
+        for (++p; (p < json.size()) && (json[p] == ' '); ++p)
+            ;
+        if ((p >= json.size()) || (json[p] != ':'))
+            return false;
+        for (++p; (p < json.size()) && (json[p] == ' '); ++p)
+            ;
+
+        const size_t begin = p;
+        for ( ; (p < json.size()) && (json[p] >= '0') && (json[p] <= '9'); ++p)
+            ;
+        return parseNumber(Option::Value{ json.data() + begin, p - begin }, n);
+    }
+
+    return false;
+}
+
+void UMPProcessing::processMIDICISetProperty(const PEMessage &msg)
+{
+    switch (m_peSetData.add(msg))
+    {
+    case PESetData::incomplete:
+        return;
+    case PESetData::out_of_sequence:
+        printf("midi-ci: set property data chunk out of sequence\n");
+        sendPropertyStatus(msg, 400);
+        return;
+    case PESetData::too_large:
+        printf("midi-ci: set property data too large\n");
+        sendPropertyStatus(msg, 413);
+        return;
+    case PESetData::complete:
+        break;
+    }
+
+    const auto header = m_peSetData.header();
+    PEHeaderParser p { header.data(), header.size() };
+    Resource r { Resource::None };
+
+    if (const int result = p.get_resource(r))
+    {
+        printf("midi-ci: invalid resource set\n");
+        sendPropertyStatus(msg, (result == -2) ? 404 : 400);
+        return;
+    }
+
+    Encoding encoding { Encoding::ASCII };
+    bool partial = false;
+
+    Option o;
+    int result;
+    while ((result = p.get_next_option(o)) == 0)
+    {
+        if (o.what == Option::What::Encoding)
+            encoding = parse_encoding(o.value.string, o.value.length);
+        else if (o.what == Option::What::SetPartial)
+            partial = (std::string_view{ o.value.string, o.value.length } == "true");
+    }
+
+    if (result < 0)
+    {
+        printf("midi-ci: malformed request header\n");
+        sendPropertyStatus(msg, 400);
+        return;
+    }
+
+    // Mcoded7 decodes in place, the output never overtakes the input
+    size_t size = m_peSetData.size();
+    if (encoding == Encoding::Mcoded7)
+    {
+        uint8_t *data = m_peSetData.data();
+        size_t decoded = 0;
+        auto store = [data, &decoded](uint8_t b) { data[decoded++] = b; };
+        Mcoded7Decoder<decltype(store)> decoder { store };
+        decoder.write(data, size);
+        size = decoded;
+    }
+    else if (encoding != Encoding::ASCII)
+    {
+        printf("midi-ci: unsupported set property data encoding\n");
+        sendPropertyStatus(msg, 415);
+        return;
+    }
+
+    const std::string_view body { reinterpret_cast<const char*>(m_peSetData.data()), size };
+
+    switch (r)
+    {
+    case Resource::XSettings:
+    {
+        printf("midi-ci: set X-Settings\n");
+        size_t interval;
+        if (!findJSONNumber(body, partial ? "/notifyInterval" : "notifyInterval", interval))
+        {
+            sendPropertyStatus(msg, 400);
+            return;
+        }
+
+        m_subscriptions.set_notify_interval(interval * 1000);
+        sendPropertyStatus(msg, 200);
+
+        char json[peMaxSetDataSize];
+        const int jsonSize = snprintf(json, sizeof(json), "{\"notifyInterval\":%u}",
+                                      unsigned(m_subscriptions.notify_interval() / 1000));
+        m_subscriptions.for_each(Resource::XSettings, [&](const PESubscriptions::Subscription &s) {
+            sendSubscriptionMessage(s, "full", std::string_view{ json, size_t(jsonSize) });
+        });
+        break;
+    }
+    default:
+        printf("midi-ci: resource cannot be set\n");
+        sendPropertyStatus(msg, 405);
         break;
     }
 }
 
+void UMPProcessing::processMIDICISubscription(const PEMessage &msg)
+{
+    // subscription end messages may come without resource
+    PEHeaderParser p { msg.header.data(), msg.header.size() };
+    Resource r { Resource::None };
+    if (p.get_resource(r) != 0)
+    {
+        r = Resource::None;
+        p = PEHeaderParser{ msg.header.data(), msg.header.size() };
+    }
+
+    std::string_view command;
+    size_t subscribeId = 0;
+
+    Option o;
+    int result;
+    while ((result = p.get_next_option(o)) == 0)
+    {
+        if (o.what == Option::What::Command)
+            command = std::string_view{ o.value.string, o.value.length };
+        else if ((o.what == Option::What::SubscribeId) && !parseNumber(o.value, subscribeId))
+            result = -1;
+
+        if (result < 0)
+            break;
+    }
+
+    if (result < 0)
+    {
+        printf("midi-ci: malformed subscription header\n");
+        sendPropertyStatus(msg, 400);
+        return;
+    }
+
+    if (command == "start")
+    {
+        if ((r != Resource::XControlState) && (r != Resource::XSettings))
+        {
+            printf("midi-ci: resource cannot be subscribed\n");
+            sendPropertyStatus(msg, (r == Resource::None) ? 404 : 405);
+            return;
+        }
+
+        const uint8_t id = m_subscriptions.start(msg.source_muid, r, controlState.snapshot(), board::timeUs());
+        if (!id)
+        {
+            printf("midi-ci: too many subscriptions\n");
+            sendPropertyStatus(msg, 429);
+            return;
+        }
+
+        printf("midi-ci: subscription %u started\n", unsigned(id));
+        char header[peMaxHeaderSize];
+        const int headerSize = snprintf(header, sizeof(header), "{\"status\":200,\"subscribeId\":\"%u\"}", unsigned(id));
+        sendPropertyReply(msg, std::string_view{ header, size_t(headerSize) });
+    }
+    else if (command == "end")
+    {
+        const bool ended = (subscribeId <= 0x7F) && m_subscriptions.end(msg.source_muid, uint8_t(subscribeId));
+        printf("midi-ci: subscription %u %s\n", unsigned(subscribeId), ended ? "ended" : "unknown");
+        sendPropertyStatus(msg, ended ? 200 : 404);
+    }
+    else
+    {
+        // we do not subscribe to anything, so no full / partial / notify is expected
+        printf("midi-ci: unexpected subscription command\n");
+        sendPropertyStatus(msg, 400);
+    }
+}
+
+void UMPProcessing::sendPropertyNotifications()
+{
+    const ControlState::Snapshot current = controlState.snapshot();
+
+    m_subscriptions.poll(current, board::timeUs(), [&](const PESubscriptions::Subscription &s, const ControlState::Snapshot &previous) {
+        char patch[peMaxSetDataSize];
+        const size_t size = ControlState::toJSONPatch(previous, current, patch, sizeof(patch));
+        if (size)
+            sendSubscriptionMessage(s, "partial", std::string_view{ patch, size });
+        else
+        {
+            // the patch does not fit, send the complete state instead
+            const size_t fullSize = ControlState::toJSON(current, patch, sizeof(patch));
+            sendSubscriptionMessage(s, "full", std::string_view{ patch, fullSize });
+        }
+    });
+}
+
+void UMPProcessing::sendGetPropertyReply(const midi::ci::get_property_data_view &msg, const PEReplyBody &body, Encoding encoding, int totalCount)
+{
+    using namespace midi::ci;
+
+    char header[peMaxHeaderSize];
+    int headerSize = snprintf(header, sizeof(header), "{\"status\":200");
+    if (totalCount >= 0)
+        headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, ",\"totalCount\":%d", totalCount);
+    if (encoding != Encoding::ASCII)
+        headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, ",\"mutualEncoding\":\"%.*s\"",
+                               int(encoding_name(encoding).size()), encoding_name(encoding).data());
+    headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, "}");
+
+    // every chunk carries the number of chunks, so the encoded size is determined by a dry run first
+    size_t bodySize = body.size();
+    if (encoding != Encoding::ASCII)
+    {
+        auto count = [&bodySize](uint8_t) { ++bodySize; };
+        bodySize = 0;
+        body.encode(encoding, count);
+    }
+    const size_t numChunks = bodySize ? (bodySize + peChunkSize - 1) / peChunkSize : 1;
+
+    // stream the encoded body chunk by chunk, the header goes with the first chunk only
+    char chunk[peChunkSize];
+    size_t chunkSize = 0;
+    size_t c = 0;
+
+    auto sendChunk = [&]() {
+        sendSysex(make_get_property_data_reply(m_ci[MainGroup].muid, msg.source_muid(),
+            property_exchange::header{ std::string_view{ header, c ? 0u : size_t(headerSize) } },
+            numChunks, c + 1, property_exchange::chunk{ std::string_view{ chunk, chunkSize } },
+            msg.request_id(), msg.device_id()));
+        chunkSize = 0;
+        ++c;
+    };
+    auto fill = [&](uint8_t b) {
+        chunk[chunkSize++] = char(b);
+        if (chunkSize == peChunkSize)
+            sendChunk();
+    };
+
+    body.encode(encoding, fill);
+    if (chunkSize || !c)
+        sendChunk();
+}
+
+void UMPProcessing::sendGetPropertyStatus(const midi::ci::get_property_data_view &msg, unsigned status)
+{
+    using namespace midi::ci;
+
+    char header[peMaxHeaderSize];
+    const int headerSize = snprintf(header, sizeof(header), "{\"status\":%u}", status);
+
+    sendSysex(make_get_property_data_reply(m_ci[MainGroup].muid, msg.source_muid(),
+        property_exchange::header{ std::string_view{ header, size_t(headerSize) } },
+        1, 1, { }, msg.request_id(), msg.device_id()));
+}
+
+void UMPProcessing::sendPropertyReply(const PEMessage &inquiry, std::string_view header)
+{
+    PEMessage reply;
+    reply.device_id = inquiry.device_id;
+    reply.subtype = inquiry.subtype + 1; // replies follow their inquiries
+    reply.source_muid = m_ci[MainGroup].muid;
+    reply.destination_muid = inquiry.source_muid;
+    reply.request_id = inquiry.request_id;
+    reply.header = header;
+
+    uint8_t data[PEMessage::overhead + peMaxHeaderSize];
+    midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+    const size_t size = reply.write(data, sizeof(data));
+    sx.data.assign(data, data + size);
+    sendSysex(sx);
+}
+
+void UMPProcessing::sendPropertyStatus(const PEMessage &inquiry, unsigned status)
+{
+    char header[peMaxHeaderSize];
+    const int headerSize = snprintf(header, sizeof(header), "{\"status\":%u}", status);
+
+    sendPropertyReply(inquiry, std::string_view{ header, size_t(headerSize) });
+}
+
+void UMPProcessing::sendSubscriptionMessage(const PESubscriptions::Subscription &s, const char *command, std::string_view body)
+{
+    char header[peMaxHeaderSize];
+    const int headerSize = snprintf(header, sizeof(header), "{\"command\":\"%s\",\"subscribeId\":\"%u\"}",
+                                    command, unsigned(s.id));
+
+    PEMessage message;
+    message.subtype = PEMessage::subscription_inquiry;
+    message.source_muid = m_ci[MainGroup].muid;
+    message.destination_muid = s.muid;
+    message.request_id = m_peRequestId = (m_peRequestId + 1) & 0x7F;
+    message.header = std::string_view{ header, size_t(headerSize) };
+    message.data = body;
+
+    uint8_t data[PEMessage::overhead + peMaxHeaderSize + peMaxSetDataSize];
+    midi::sysex7 sx { midi::manufacturer::universal_non_realtime };
+    const size_t size = message.write(data, sizeof(data));
+    sx.data.assign(data, data + size);
+    sendSysex(sx);
+}
+
 void UMPProcessing::sendSysex(const midi::sysex7& sx, midi::group_t group)
 {
     midi::send_sysex7(sx, group, sendPacket);
 }
 
+void UMPProcessing::sendPackedSysex(const uint32_t *words, size_t numWords)
+{
+    // what the burst could not place goes one packet at a time
+    size_t w = sendWords ? sendWords(words, numWords) : 0;
+    for (; w < numWords; w += 2)
+        sendPacket(midi::universal_packet{ words[w], words[w + 1] });
+}
+
 #if NIMIDI2_CUSTOM_SYSEX_DATA_ALLOCATOR
-// TODO: implement pool allocator
+// Size classed sysex data pools, the largest class holds a complete
+// maxSysexMessageSize message. Every CI agent of every endpoint may collect
+// a message at the same time, and each endpoint task may hold one more
+// block: a reply being built, or the old buffer of a growing collector.
+static constexpr uint16_t numSysexEndpoints { 1 // USB MIDI
+#if PROTOZOA_USB_CDC_SERIAL
+    + 1
+#endif
+#if PROTOZOA_EXPANSION_SERIAL_TYPE25
+    + 1
+#endif
+};
+static constexpr uint16_t numSysexBlocks { numSysexEndpoints * (UMPProcessing::numFunctionBlocks + 1) };
+
+static BlockPool<32, 16> sysexPoolSmall;
+static BlockPool<128, (numSysexBlocks > 8) ? numSysexBlocks : 8> sysexPoolMedium;
+static BlockPool<UMPProcessing::maxSysexMessageSize, numSysexBlocks> sysexPoolLarge;
+
+// The pools are all there is, heap_1 never frees. A request no pool can serve
+// fails, so incoming messages are only collected while a large block is left
+// for the message and one for its reply, see process. Both are counted here
+// and reported from task context, see sendPendingUMPs.
+static std::atomic<uint32_t> numSysexAllocationsFailed { 0 };
+static std::atomic<uint32_t> numSysexMessagesDropped { 0 };
+
+template <typename Pool>
+static void *allocateFrom(Pool &pool, size_t numBytes)
+{
+    return (numBytes <= Pool::size) ? pool.allocate() : nullptr;
+}
+
+static bool sysexPoolsHaveRoom()
+{
+    return sysexPoolLarge.numUsed() + 2 <= numSysexBlocks;
+}
+
+static void dropSysexMessage()
+{
+    numSysexMessagesDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void dumpSysexPoolStatistics()
+{
+    // every endpoint calls this, the first one due prints
+    static std::atomic<uint32_t> numFailedReported { 0 };
+#if PROTOZOA_TRACE_OUTGOING_TRAFFIC
+    constexpr uint32_t statsIntervalUs { 10000000 };
+    static std::atomic<uint32_t> statsUs { board::timeUs() };
+#endif
+
+    const uint32_t numFailed = numSysexAllocationsFailed.load(std::memory_order_relaxed)
+                             + numSysexMessagesDropped.load(std::memory_order_relaxed);
+    uint32_t reported = numFailedReported.load(std::memory_order_relaxed);
+    bool due = (numFailed != reported) && numFailedReported.compare_exchange_strong(reported, numFailed);
+#if PROTOZOA_TRACE_OUTGOING_TRAFFIC
+    const uint32_t now = board::timeUs();
+    uint32_t last = statsUs.load(std::memory_order_relaxed);
+    due = ((now - last >= statsIntervalUs) && statsUs.compare_exchange_strong(last, now)) || due;
+#endif
+    if (!due)
+        return;
+
+    auto dump = [](const char *name, const auto &pool) {
+        printf("sysex pool %s: %u in use, high water %u, exhausted %u times\n", name,
+               unsigned(pool.numUsed()), unsigned(pool.highWater()), unsigned(pool.numFailed()));
+    };
+    dump("small", sysexPoolSmall);
+    dump("medium", sysexPoolMedium);
+    dump("large", sysexPoolLarge);
+    printf("sysex pool: %u allocations failed, %u messages dropped\n",
+           unsigned(numSysexAllocationsFailed.load(std::memory_order_relaxed)),
+           unsigned(numSysexMessagesDropped.load(std::memory_order_relaxed)));
+}
+
 midi::sysex::data_allocator::value_type* midi::sysex::data_allocator::allocate(std::size_t n)
 {
-    return new value_type[n];
+    const size_t numBytes = n * sizeof(value_type);
+
+    // try the next larger class if a class is exhausted
+    void *p = allocateFrom(sysexPoolSmall, numBytes);
+    if (!p)
+        p = allocateFrom(sysexPoolMedium, numBytes);
+    if (!p)
+        p = allocateFrom(sysexPoolLarge, numBytes);
+    if (!p)
+        numSysexAllocationsFailed.fetch_add(1, std::memory_order_relaxed);
+
+    return static_cast<value_type*>(p);
 }
 
 void midi::sysex::data_allocator::deallocate(value_type* p, std::size_t) noexcept
 {
-    return delete[](p);
+    if (sysexPoolSmall.owns(p))
+        sysexPoolSmall.deallocate(p);
+    else if (sysexPoolMedium.owns(p))
+        sysexPoolMedium.deallocate(p);
+    else if (sysexPoolLarge.owns(p))
+        sysexPoolLarge.deallocate(p);
 }
-#endif
\ No newline at end of file
+#endif
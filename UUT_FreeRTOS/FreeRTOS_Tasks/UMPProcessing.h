@@ -6,45 +6,132 @@
 #include <midi/sysex_collector.h>
 #include <midi/universal_packet.h>
 
+#include "JitterReduction.h"
+#include "PEMessage.h"
+#include "PEReplyBody.h"
+#include "PESubscriptions.h"
+#include "ProfileRegistry.h"
+#include "ProtocolTranslator.h"
+#include "SysexClassifier.h"
+#include "UMPSources.h"
+#include "Groups.h"
+
 #include <string>
 #include <string_view>
+#include <utility>
 
 class UMPProcessing
 {
 public:
   typedef void sendPacketProc(const midi::universal_packet&);
+  //! returns the number of words accepted, complete packets only
+  typedef size_t sendWordsProc(const uint32_t *words, size_t numWords);
+
+  static constexpr size_t maxSysexMessageSize { 512 };
+  //! Main, the 5-pin DIN pair (or DIN and Widi) and one more per additional DIN port, see Groups.h
+  //! one CI agent each, first group == function block number
+  static constexpr uint8_t numFunctionBlocks { 2 + PROTOZOA_DIN_PORTS };
 
-  UMPProcessing(std::string_view epName, sendPacketProc);
+  //! optional sendWordsProc forwards whole bursts of complete UMPs at once
+  UMPProcessing(std::string_view epName, sendPacketProc, sendWordsProc * = nullptr);
 
   midi::protocol_t   curProtocol { midi::protocol::midi1 };
   midi::extensions_t curExtensions { 0 };
   
   void process(const midi::universal_packet&);
-  void sendPendingUMPs();
+  //! forward UMPs of all registered sources, weighted round robin, see UMPSourceRegistry
+  //! returns us until a call is due without new UMPs (JR clock, notifications, 0: sink full), UINT32_MAX: none
+  uint32_t sendPendingUMPs();
   void clearPendingUMPs();
+
+  //! wake up reader whenever new UMPs become pending, see UMPRingBuffer::addReader
+  void addPendingUMPsReader(UMPReaderNotifyProc*, void *reader);
+
+  //! MIDI-CI profiles, enabled profiles filter the routed channel voice messages
+  ProfileRegistry &profiles() { return m_profiles; }
   
 protected:
+  void processUtilityMessage(const midi::universal_packet&);
   void processStreamMessage(const midi::universal_packet&);
   void processEndpointDiscovery(const midi::endpoint_discovery_view&);
   void processFunctionBlockDiscovery(const midi::function_block_discovery_view&);
   void processStreamConfigurationRequest(const midi::stream_configuration_view&);
 
-  void processSysexMessage(const midi::sysex7&);
-  void processMIDICIMessage(const midi::capability_inquiry_view&);
+  struct CIAgent;
+
+  void processSysexMessage(const midi::sysex7&, CIAgent&);
+  void processMIDICIMessage(const midi::sysex7&, CIAgent&);
+  void processMIDICIProfile(const midi::sysex7&, CIAgent&);
+  void sendProfileInquiryReply(const CIAgent&, uint32_t destination, uint8_t deviceId);
+  //! Profile Enabled / Disabled Report (subtype), sent to all MUIDs
+  void sendProfileReport(const CIAgent&, uint8_t subtype, uint8_t deviceId, const ProfileRegistry::ProfileId&);
+  void sendCINAK(const CIAgent&, uint32_t destination, uint8_t deviceId, uint8_t subtype, const uint8_t *details);
   void processMIDICIGetProperty(const midi::ci::get_property_data_view&);
+  void processMIDICISetProperty(const PEMessage&);
+  void processMIDICISubscription(const PEMessage&);
+  //! totalCount >= 0 is reported for paged list resources
+  void sendGetPropertyReply(const midi::ci::get_property_data_view&, const PEReplyBody&, Encoding, int totalCount = -1);
+  void sendGetPropertyStatus(const midi::ci::get_property_data_view&, unsigned status);
+  //! reply without property data to a Set Property Data or Subscription inquiry
+  void sendPropertyReply(const PEMessage &inquiry, std::string_view header);
+  void sendPropertyStatus(const PEMessage &inquiry, unsigned status);
+  //! notify subscribers of X-ControlState, rate limited, see PESubscriptions
+  void sendPropertyNotifications();
+  void sendSubscriptionMessage(const PESubscriptions::Subscription&, const char *command, std::string_view data);
 
   void sendSysex(const midi::sysex7&, midi::group_t = 0);
+  //! SysEx7 UMPs, see PackedSysex7
+  void sendPackedSysex(const uint32_t *words, size_t numWords);
+
+  //! MIDI-CI agent of a function block: MUID and SysEx collector of its group
+  struct CIAgent
+  {
+    CIAgent(UMPProcessing&, midi::group_t);
+
+    const midi::group_t group;
+    midi::muid_t muid;
+    //! only MIDI-CI messages are collected on groups other than Main,
+    //! Main also collects identity requests and our own configuration messages
+    SysexClassifier classifier;
+    midi::sysex7_collector collector;
+    bool dropping { false }; //!< the current message did not fit into the sysex pools
+  };
 
 private:
-  static constexpr size_t maxSysexMessageSize { 512 };
+  template <size_t... FunctionBlock>
+  UMPProcessing(std::string_view epName, sendPacketProc, sendWordsProc *, std::index_sequence<FunctionBlock...>);
+
+  bool forwardUMPs(uint8_t source);
+  void sendTranslated(const midi::universal_packet&, ProtocolTranslator&);
+  //! the ingress timestamp of the packets of source about to be sent, if JR is enabled
+  void sendJRTimestamp(uint8_t source);
+
+  // a Get Property Data Reply adds up to 24 bytes of message fields to header and chunk
+  static constexpr size_t peMaxHeaderSize { 72 };
+  static constexpr size_t peChunkSize { maxSysexMessageSize - 24 - peMaxHeaderSize };
+  static constexpr size_t peMaxSetDataSize { 128 };
+  using PESetData = PEChunkAssembler<peMaxHeaderSize, peMaxSetDataSize>;
+  static constexpr uint32_t jrPlayoutDelay { 2000 };  // us, covers USB frame jitter
+  static constexpr uint32_t jrClockPeriod { 250000 }; // us
 
   std::string m_endpointName;
   sendPacketProc *sendPacket = nullptr;
-  uint16_t m_controlReadPtr { 0 };
-  uint16_t m_DINReadPtr { 0 };
-  uint16_t m_BTReadPtr { 0 };
-  midi::muid_t m_muid;
-  midi::sysex7_collector m_ciMain;
+  sendWordsProc *sendWords = nullptr;
+  UMPReadPtr m_readPtrs[UMPSourceRegistry::maxSources];
+  ProtocolTranslator m_translators[UMPSourceRegistry::maxSources];
+  uint8_t m_nextSource { 0 };
+  bool m_sinkFull { false }; // sendWords did not take all words
+  JRClockReceiver m_jrClock;
+  bool m_jrTimestampValid { false };
+  uint32_t m_jrTime { 0 };          // local time of the last JR Timestamp received
+  uint32_t m_jrClockSent { 0 };
+  uint32_t m_jrIngress[UMPSourceRegistry::maxSources] {}; // per source: last JR Timestamp read, 0: none
+  uint32_t m_jrTimestampSent { 0 };                        // last JR Timestamp sent, 0: none
+  CIAgent m_ci[numFunctionBlocks];
+  ProfileRegistry m_profiles;
+  PESubscriptions m_subscriptions;
+  PESetData m_peSetData;
+  uint8_t m_peRequestId { 0 }; // of the subscription messages we send
 };
 
 #endif // UMPPROCESSING_H
\ No newline at end of file
@@ -3,33 +3,328 @@
 
 #include <midi/universal_packet.h>
 
-template <uint16_t capacity>
+#include <atomic>
+#include <type_traits>
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#else
+#include <mutex>
+#endif
+
+//! Wake up hook for readers, called from UMPRingBuffer::write
+typedef void UMPReaderNotifyProc(void *reader);
+
+//! Per reader position in a UMPRingBuffer
+struct UMPReadPtr
+{
+    uint16_t pos { 0 };     //!< free running word counter, wraps at 2^16
+    uint16_t count { 0 };   //!< free running packet counter, wraps at 2^16
+    uint32_t dropped { 0 }; //!< packets lost because the writer lapped this reader
+};
+
+//! Contiguous range of complete UMPs inside a UMPRingBuffer, see UMPRingBuffer::peekSpan
+struct UMPSpan
+{
+    const uint32_t *words { nullptr };
+    uint16_t numWords { 0 };
+    uint16_t numPackets { 0 };
+};
+
+//! Lock-free single writer / multiple reader ring of UMPs
+/***
+ *
+ * Packets are stored word-packed at their real size, `capacity` is given in
+ * 32 bit words and has to be a power of two.
+ *
+ * The writer publishes every packet with a release store of `writeState`,
+ * which holds both the word position and the packet count, so readers get
+ * a consistent snapshot of both with a single load. Readers copy a packet
+ * and then re-check `writeState` to detect that the writer has lapped them
+ * while copying (seqlock style). As packet boundaries are only known to the
+ * reader, a lapped reader resynchronizes to the current write position and
+ * accounts for all skipped packets in `UMPReadPtr::dropped`.
+ *
+ * Readers must poll at least once per 2^16 written words, which every task
+ * in this firmware does.
+ *
+ * Packets never straddle the end of the buffer, the writer pads with NOOP
+ * words instead. That way `peekSpan` can hand out whole bursts as one
+ * contiguous range of words, e.g. for a single `tud_ump_write` call, which
+ * gets consumed with `commit`. NOOP packets are not stored at all.
+ *
+ * With `multiProducer` set, writers are serialized by a short spin lock
+ * section (a hardware spin lock on the RP2040), readers stay lock-free.
+ *
+ * Readers blocking on new data can register a notification with `addReader`,
+ * which gets called after every write, from the writer's context.
+ *
+ ***/
+template <uint16_t capacity, bool multiProducer = false>
 struct UMPRingBuffer
 {
-    inline void write(const midi::universal_packet &p)
+    static_assert((capacity >= 8) && (capacity <= 0x8000) && ((capacity & (capacity - 1)) == 0),
+                  "capacity must be a power of two");
+
+    //! returns the packet count including p (see UMPReadPtr::count), NOOP packets are not counted
+    inline uint16_t write(const midi::universal_packet &p)
+    {
+        if (p.data[0] == noop)
+            return uint16_t(writeState.load(std::memory_order_relaxed) >> 16);
+
+        const uint16_t count = publish(p);
+
+        const uint8_t n = numReaders.load(std::memory_order_acquire);
+        for (uint8_t r = 0; r < n; ++r)
+            readers[r].notify(readers[r].reader);
+
+        return count;
+    }
+    //! register a reader wake up, returns false if all reader slots are taken
+    inline bool addReader(UMPReaderNotifyProc *notify, void *reader)
+    {
+        SpinLockGuard lock { writeLock };
+
+        const uint8_t n = numReaders.load(std::memory_order_relaxed);
+        if (n == maxReaders)
+            return false;
+
+        readers[n] = { notify, reader };
+        numReaders.store(n + 1, std::memory_order_release);
+        return true;
+    }
+    inline bool itemsAvail(const UMPReadPtr &readPtr) const
     {
-        data[writePtr++] = p;
-        if (writePtr >= capacity)
-            writePtr = 0;
+        return (readPtr.pos != uint16_t(writeState.load(std::memory_order_acquire)));
     }
-    inline bool itemsAvail(uint16_t readPtr) const { return (readPtr != writePtr); }
-    inline bool read(uint16_t &readPtr, midi::universal_packet &p) const
+    inline bool read(UMPReadPtr &readPtr, midi::universal_packet &p) const
     {
-        if (itemsAvail(readPtr))
+        for (;;)
         {
-            p = data[readPtr];
-            if (++readPtr == capacity)
-                readPtr = 0;
+            const uint32_t s = writeState.load(std::memory_order_acquire);
+            const uint16_t numAvail = uint16_t(s) - readPtr.pos;
+            if (numAvail == 0)
+                return false;
+
+            if (numAvail > maxLag)
+            {
+                resync(readPtr, s);
+                continue;
+            }
+
+            p.data[0] = data[readPtr.pos & mask];
+            const uint16_t numWords = uint16_t(p.size());
+            for (uint16_t i = 1; i < 4; ++i)
+                p.data[i] = (i < numWords) ? data[(readPtr.pos + i) & mask] : 0;
+
+            if (!validate(readPtr))
+                continue; // overwritten while copying
+
+            readPtr.pos += numWords;
+            if (p.data[0] == noop)
+                continue; // padding
+
+            ++readPtr.count;
             return true;
         }
+    }
+    //! copy complete packets into words, returns the number of words copied
+    inline uint16_t readBatch(UMPReadPtr &readPtr, uint32_t *words, uint16_t maxWords) const
+    {
+        for (;;)
+        {
+            const uint32_t s = writeState.load(std::memory_order_acquire);
+            const uint16_t numAvail = uint16_t(s) - readPtr.pos;
+            if (numAvail > maxLag)
+            {
+                resync(readPtr, s);
+                continue;
+            }
 
-        return false;
+            uint16_t numRead = 0;
+            uint16_t numWords = 0;
+            uint16_t numPackets = 0;
+            while (numRead < numAvail)
+            {
+                const uint32_t word0 = data[(readPtr.pos + numRead) & mask];
+                if (word0 == noop)
+                {
+                    ++numRead;
+                    continue;
+                }
+
+                const uint16_t size = packetSize(word0);
+                if ((numRead + size > numAvail) || (numWords + size > maxWords))
+                    break;
+
+                for (uint16_t i = 0; i < size; ++i)
+                    words[numWords++] = data[(readPtr.pos + numRead++) & mask];
+                ++numPackets;
+            }
+
+            if (!validate(readPtr))
+                continue; // overwritten while copying
+
+            readPtr.pos += numRead;
+            readPtr.count += numPackets;
+            return numWords;
+        }
+    }
+    //! access up to maxPackets complete packets in place, up to the end of the buffer
+    /***
+     * The span stays valid until it is handed back with `commit`.
+     ***/
+    inline UMPSpan peekSpan(UMPReadPtr &readPtr, uint16_t maxPackets = 0xFFFF) const
+    {
+        for (;;)
+        {
+            const uint32_t s = writeState.load(std::memory_order_acquire);
+            const uint16_t numAvail = uint16_t(s) - readPtr.pos;
+            if (numAvail > maxLag)
+            {
+                resync(readPtr, s);
+                continue;
+            }
+
+            const uint16_t start = readPtr.pos & mask;
+            const uint16_t end = (numAvail < capacity - start) ? numAvail : (capacity - start);
+
+            UMPSpan span { &data[start], 0, 0 };
+            uint16_t numPadding = 0;
+            while ((span.numWords < end) && (span.numPackets < maxPackets))
+            {
+                const uint32_t word0 = data[start + span.numWords];
+                if (word0 == noop)
+                {
+                    // padding only occurs at the end of the buffer
+                    numPadding = (span.numWords == 0) ? end : 0;
+                    break;
+                }
+
+                const uint16_t size = packetSize(word0);
+                if (span.numWords + size > end)
+                    break;
+
+                span.numWords += size;
+                ++span.numPackets;
+            }
+
+            if (!validate(readPtr))
+                continue; // overwritten while scanning
+
+            if (numPadding)
+            {
+                readPtr.pos += numPadding;
+                continue;
+            }
+
+            return span;
+        }
+    }
+    //! consume a span from `peekSpan`, returns false if it got overwritten in the meantime
+    inline bool commit(UMPReadPtr &readPtr, const UMPSpan &span) const
+    {
+        if (!validate(readPtr))
+            return false;
+
+        readPtr.pos += span.numWords;
+        readPtr.count += span.numPackets;
+        return true;
+    }
+    inline void resetReadPtr(UMPReadPtr &readPtr) const
+    {
+        const uint32_t s = writeState.load(std::memory_order_acquire);
+        readPtr.pos = uint16_t(s);
+        readPtr.count = uint16_t(s >> 16);
+        readPtr.dropped = 0;
     }
-    inline void resetReadPtr(uint16_t &readPtr) const { readPtr = writePtr; }
 
 private:
-    uint16_t writePtr = 0;
-    midi::universal_packet data[capacity];
+    static constexpr uint16_t mask = capacity - 1;
+    // the words of a packet currently being written are never safe to read
+    static constexpr uint16_t maxLag = capacity - 4;
+
+    static constexpr uint32_t noop = 0;
+
+    static constexpr uint32_t makeState(uint16_t pos, uint16_t count) { return (uint32_t(count) << 16) | pos; }
+    static uint16_t packetSize(uint32_t word0) { return uint16_t(midi::universal_packet{ word0 }.size()); }
+
+    inline uint16_t publish(const midi::universal_packet &p)
+    {
+        WriteLock lock { writeLock };
+
+        const uint32_t s = writeState.load(std::memory_order_relaxed);
+        uint16_t w = uint16_t(s);
+        const uint16_t count = uint16_t(s >> 16);
+        const uint16_t numWords = uint16_t(p.size());
+
+        const uint16_t room = capacity - (w & mask);
+        if (room < numWords)
+        {
+            // pad up to the end of the buffer
+            std::atomic_thread_fence(std::memory_order_release);
+            for (uint16_t i = 0; i < room; ++i)
+                data[(w + i) & mask] = noop;
+            w += room;
+            writeState.store(makeState(w, count), std::memory_order_release);
+        }
+
+        // make the previous publication visible before its successors get overwritten
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint16_t i = 0; i < numWords; ++i)
+            data[(w + i) & mask] = p.data[i];
+        writeState.store(makeState(uint16_t(w + numWords), uint16_t(count + 1)), std::memory_order_release);
+        return uint16_t(count + 1);
+    }
+    inline void resync(UMPReadPtr &readPtr, uint32_t s) const
+    {
+        // lapped, restart at the write position
+        readPtr.dropped += uint16_t((s >> 16) - readPtr.count);
+        readPtr.pos = uint16_t(s);
+        readPtr.count = uint16_t(s >> 16);
+    }
+    inline bool validate(UMPReadPtr &readPtr) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint32_t s = writeState.load(std::memory_order_relaxed);
+        if (uint16_t(uint16_t(s) - readPtr.pos) <= maxLag)
+            return true;
+
+        resync(readPtr, s);
+        return false;
+    }
+
+#if PICO_ON_DEVICE
+    struct SpinLock
+    {
+        spin_lock_t *lock { spin_lock_instance(next_striped_spin_lock_num()) };
+    };
+    struct SpinLockGuard
+    {
+        explicit SpinLockGuard(SpinLock &l) : lock(l.lock), irqState(spin_lock_blocking(lock)) {}
+        ~SpinLockGuard() { spin_unlock(lock, irqState); }
+        spin_lock_t *lock;
+        uint32_t irqState;
+    };
+#else
+    using SpinLock = std::mutex;
+    using SpinLockGuard = std::lock_guard<std::mutex>;
+#endif
+    struct NoLockGuard { explicit NoLockGuard(SpinLock &) {} };
+    using WriteLock = typename std::conditional<multiProducer, SpinLockGuard, NoLockGuard>::type;
+
+    struct Reader
+    {
+        UMPReaderNotifyProc *notify;
+        void *reader;
+    };
+    static constexpr uint8_t maxReaders = 4;
+
+    std::atomic<uint32_t> writeState { 0 };
+    SpinLock writeLock; // serializes writers (multiProducer) and reader registration
+    std::atomic<uint8_t> numReaders { 0 };
+    Reader readers[maxReaders] {};
+    uint32_t data[capacity] {};
 };
 
 #endif // UMPRINGBUFFER_H
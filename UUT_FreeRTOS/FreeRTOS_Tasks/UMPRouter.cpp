@@ -0,0 +1,187 @@
+#include "UMPRouter.h"
+
+#include "ProtocolTranslator.h"
+
+UMPRouter::UMPRouter(defaultRoutesProc *defaultRoutes) :
+    m_defaultRoutes(defaultRoutes)
+{
+    reset();
+}
+
+void UMPRouter::setSink(Destination d, sendPacketProc *sink)
+{
+    if (d >= NumDestinations)
+        return;
+
+    Lock lock(m_lock);
+    m_sinks[d] = sink;
+}
+
+void UMPRouter::setRoute(midi::group_t group, Destination d, uint16_t messageTypes, Translation t)
+{
+    if ((group > 15) || (d >= NumDestinations) || (t >= Translation::__count__))
+        return;
+
+    const uint8_t bit = uint8_t(1u << d);
+    Lock lock(m_lock);
+    for (unsigned type = 0; type < 16; ++type)
+    {
+        if (messageTypes & (1u << type))
+            m_table.destinations[group][type] |= bit;
+        else
+            m_table.destinations[group][type] &= ~bit;
+    }
+    m_table.translations[group][d] = t;
+}
+
+uint16_t UMPRouter::messageTypes(midi::group_t group, Destination d) const
+{
+    uint16_t result = 0;
+    if ((group <= 15) && (d < NumDestinations))
+    {
+        Lock lock(m_lock);
+        for (unsigned type = 0; type < 16; ++type)
+            if (m_table.destinations[group][type] & (1u << d))
+                result |= uint16_t(1u << type);
+    }
+    return result;
+}
+
+UMPRouter::Translation UMPRouter::translation(midi::group_t group, Destination d) const
+{
+    if ((group > 15) || (d >= NumDestinations))
+        return Translation::None;
+
+    Lock lock(m_lock);
+    return m_table.translations[group][d];
+}
+
+void UMPRouter::clear()
+{
+    Lock lock(m_lock);
+    m_table = Table{};
+}
+
+void UMPRouter::reset()
+{
+    if (!m_defaultRoutes)
+    {
+        clear();
+        return;
+    }
+
+    // build the default routes and sinks aside, so route never sees them half set up
+    UMPRouter defaults { nullptr };
+    m_defaultRoutes(defaults);
+
+    Lock lock(m_lock);
+    m_table = defaults.m_table;
+    for (unsigned d = 0; d < NumDestinations; ++d)
+        m_sinks[d] = defaults.m_sinks[d];
+}
+
+bool UMPRouter::route(const midi::universal_packet &p, schedulePacketProc *schedule, uint32_t time) const
+{
+    const auto group = p.group();
+    uint8_t destinations;
+    Translation translations[NumDestinations];
+    sendPacketProc *sinks[NumDestinations];
+    {
+        Lock lock(m_lock);
+        destinations = m_table.destinations[group][unsigned(p.type())];
+        for (unsigned d = 0; d < NumDestinations; ++d)
+        {
+            translations[d] = m_table.translations[group][d];
+            sinks[d] = m_sinks[d];
+        }
+    }
+
+    const bool toMain = destinations & (1u << MainDestination);
+    destinations &= ~(1u << MainDestination);
+
+    while (destinations)
+    {
+        const unsigned d = __builtin_ctz(destinations);
+        destinations &= destinations - 1;
+
+        if (sinks[d])
+            sendTranslated(p, translations[d], Delivery{ sinks[d], schedule, time });
+    }
+
+    return toMain;
+}
+
+void UMPRouter::sendTranslated(const midi::universal_packet &p, Translation t, const Delivery &deliver) const
+{
+    midi::universal_packet translated[ProtocolTranslator::maxPackets];
+    uint8_t numPackets;
+
+    switch (t)
+    {
+    case Translation::MIDI1:
+        numPackets = ProtocolTranslator::toMIDI1(p, translated);
+        break;
+    case Translation::MIDI2:
+        // routes are shared by all endpoints, so there is no stream to collect RPNs from
+        numPackets = ProtocolTranslator::toMIDI2(p, translated, nullptr);
+        break;
+    default:
+        deliver(p);
+        return;
+    }
+
+    for (uint8_t i = 0; i < numPackets; ++i)
+        deliver(translated[i]);
+}
+
+int UMPRouter::processConfigMessage(const uint8_t *data, size_t size, uint8_t *reply)
+{
+    if (!size)
+        return -1;
+
+    switch (data[0])
+    {
+    case configSetRoute:
+        if (size == 7)
+        {
+            const uint16_t types = data[4] | (data[5] << 7) | (data[6] << 14);
+            if ((data[1] > 15) || (data[2] >= NumDestinations) || (data[3] >= uint8_t(Translation::__count__)))
+                return -1;
+
+            setRoute(data[1], Destination(data[2]), types, Translation(data[3]));
+            return 0;
+        }
+        break;
+    case configGetRoute:
+        if (size == 3)
+        {
+            if ((data[1] > 15) || (data[2] >= NumDestinations))
+                return -1;
+
+            const auto group = data[1];
+            const auto d = Destination(data[2]);
+            const uint16_t types = messageTypes(group, d);
+
+            reply[0] = configRouteReply;
+            reply[1] = group;
+            reply[2] = d;
+            reply[3] = uint8_t(translation(group, d));
+            reply[4] = types & 0x7F;
+            reply[5] = (types >> 7) & 0x7F;
+            reply[6] = (types >> 14) & 0x03;
+            return 7;
+        }
+        break;
+    case configReset:
+        if (size == 1)
+        {
+            reset();
+            return 0;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return -1;
+}
@@ -0,0 +1,155 @@
+#ifndef UMPROUTER_H
+#define UMPROUTER_H
+
+#include <midi/universal_packet.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#else
+#include <mutex>
+#endif
+
+//! Group / message type based UMP routing matrix
+/***
+ *
+ * For every group and message type the routing table holds a bitmap of
+ * destinations, so routing a packet is a single table lookup followed by
+ * one sink call per destination (fan-out). Every group / destination route
+ * additionally carries a protocol translation, e.g. to feed MIDI 2.0
+ * channel voice messages to a MIDI 1.0 byte stream port.
+ *
+ * The table can be changed at runtime with configuration messages, see
+ * processConfigMessage. Endpoints on both cores route through the same
+ * table, so changes and lookups take a spin lock. route holds it only
+ * to copy the entry of the packet's group and the sinks, never while
+ * delivering.
+ *
+ ***/
+class UMPRouter
+{
+public:
+  typedef void sendPacketProc(const midi::universal_packet&);
+  typedef void defaultRoutesProc(UMPRouter&);
+  //! deliver a packet to sink at time, see UMPScheduler
+  typedef void schedulePacketProc(const midi::universal_packet&, sendPacketProc *sink, uint32_t time);
+
+  enum Destination : uint8_t
+  {
+    MainDestination = 0, //!< local processing (MIDI-CI, identity), handled by the caller
+    DINPortDestination,
+    CMEWidiDestination,
+    NumDestinations
+  };
+
+  enum class Translation : uint8_t
+  {
+    None = 0,
+    MIDI1, //!< MIDI 2.0 channel voice -> MIDI 1.0 channel voice
+    MIDI2, //!< MIDI 1.0 channel voice -> MIDI 2.0 channel voice
+    __count__
+  };
+
+  static constexpr uint16_t allMessageTypes { 0xFFFF };
+  static constexpr uint16_t messageTypeBit(midi::packet_type t) { return uint16_t(1u << unsigned(t)); }
+
+  //! defaultRoutes sets up the board's default sinks and routing, see reset
+  explicit UMPRouter(defaultRoutesProc *defaultRoutes);
+
+  void setSink(Destination, sendPacketProc*);
+
+  //! route messageTypes (bit per packet type) of group to destination, 0 removes the route
+  void setRoute(midi::group_t, Destination, uint16_t messageTypes, Translation = Translation::None);
+  uint16_t messageTypes(midi::group_t, Destination) const;
+  Translation translation(midi::group_t, Destination) const;
+
+  //! remove all routes, the sinks stay
+  void clear();
+  //! restore the board's default sinks and routing
+  void reset();
+
+  //! forward to all routed sinks, returns true if also routed to MainDestination
+  /***
+   * With schedule set, packets are handed to schedule together with the
+   * sink and time instead of being sent right away.
+   ***/
+  bool route(const midi::universal_packet&, schedulePacketProc *schedule = nullptr, uint32_t time = 0) const;
+
+  //! Routing configuration message
+  /***
+   *
+   * Payload of a manufacturer specific system exclusive message, following
+   * the manufacturer ID of the device identity:
+   *
+   *   set route:   01 gg dd tt m0 m1 m2
+   *   get route:   02 gg dd
+   *   route reply: 03 gg dd tt m0 m1 m2
+   *   reset:       04
+   *
+   * with group gg, destination dd, translation tt and the message type
+   * bitmap m0 | m1 << 7 | m2 << 14.
+   *
+   * Returns the number of reply bytes written to reply (at least
+   * maxConfigReplySize bytes), 0 for no reply or -1 for an invalid message.
+   *
+   ***/
+  static constexpr size_t maxConfigReplySize { 7 };
+  int processConfigMessage(const uint8_t *data, size_t size, uint8_t *reply);
+
+  static constexpr uint8_t configSetRoute   { 0x01 };
+  static constexpr uint8_t configGetRoute   { 0x02 };
+  static constexpr uint8_t configRouteReply { 0x03 };
+  static constexpr uint8_t configReset      { 0x04 };
+
+private:
+  struct Delivery
+  {
+    sendPacketProc *sink;
+    schedulePacketProc *schedule;
+    uint32_t time;
+
+    void operator()(const midi::universal_packet &p) const
+    {
+      if (schedule)
+        schedule(p, sink, time);
+      else
+        sink(p);
+    }
+  };
+
+  void sendTranslated(const midi::universal_packet&, Translation, const Delivery&) const;
+
+#if PICO_ON_DEVICE
+  struct SpinLock
+  {
+    spin_lock_t *lock { spin_lock_instance(next_striped_spin_lock_num()) };
+  };
+  struct Lock
+  {
+    explicit Lock(SpinLock &l) : lock(l.lock), irqState(spin_lock_blocking(lock)) {}
+    ~Lock() { spin_unlock(lock, irqState); }
+    spin_lock_t *lock;
+    uint32_t irqState;
+  };
+#else
+  using SpinLock = std::mutex;
+  using Lock = std::lock_guard<std::mutex>;
+#endif
+
+  struct Table
+  {
+    uint8_t destinations[16][16];                     // [group][message type] -> destination bitmap
+    Translation translations[16][NumDestinations];
+  };
+
+  Table m_table {};
+  mutable SpinLock m_lock;
+  sendPacketProc *m_sinks[NumDestinations] { nullptr };
+  defaultRoutesProc *m_defaultRoutes { nullptr };
+};
+
+extern UMPRouter umpRouter;
+
+#endif // UMPROUTER_H
@@ -0,0 +1,130 @@
+#include "UMPScheduler.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/timer.h"
+#endif
+
+#include <cstdio>
+
+UMPScheduler umpScheduler;
+
+#if PICO_ON_DEVICE
+
+static inline bool isDue(uint32_t time)
+{
+    return int32_t(time - time_us_32()) <= 0;
+}
+
+static inline bool setAlarm(uint alarm, uint32_t time)
+{
+    // extend to the 64 bit timer, returns true if already missed
+    const uint64_t now = time_us_64();
+    return hardware_alarm_set_target(alarm, from_us_since_boot(now + int32_t(time - uint32_t(now))));
+}
+
+void UMPScheduler::init()
+{
+    critical_section_init(&m_lock);
+
+    const int alarm = hardware_alarm_claim_unused(false);
+    if (alarm < 0)
+    {
+        printf("UMP scheduler: no hardware alarm available, timestamps are ignored\n");
+        return;
+    }
+
+    hardware_alarm_set_callback(alarm, alarmCallback);
+    m_alarm = alarm;
+}
+
+void UMPScheduler::schedule(const midi::universal_packet &p, UMPRouter::sendPacketProc *sink, uint32_t time)
+{
+    if (m_alarm < 0)
+    {
+        sink(p);
+        return;
+    }
+
+    critical_section_enter_blocking(&m_lock);
+
+    if ((m_numEntries == 0) && isDue(time))
+    {
+        critical_section_exit(&m_lock);
+        sink(p);
+        return;
+    }
+
+    // make room by releasing the next due packet early
+    Entry early { 0, nullptr, {} };
+    if (m_numEntries == capacity)
+    {
+        early = m_entries[--m_numEntries];
+        ++numOverflows;
+    }
+
+    // insert behind all entries of the same or an earlier time
+    uint8_t i = m_numEntries;
+    while ((i > 0) && (int32_t(m_entries[i - 1].time - time) <= 0))
+    {
+        m_entries[i] = m_entries[i - 1];
+        --i;
+    }
+    m_entries[i] = Entry{ time, sink, p };
+
+    const bool missed = (i == m_numEntries++) && setAlarm(m_alarm, time);
+
+    critical_section_exit(&m_lock);
+
+    if (early.sink)
+        early.sink(early.packet);
+    if (missed)
+        release();
+}
+
+void UMPScheduler::alarmCallback(uint)
+{
+    umpScheduler.release();
+}
+
+void UMPScheduler::release()
+{
+    for (;;)
+    {
+        critical_section_enter_blocking(&m_lock);
+
+        if (m_numEntries == 0)
+        {
+            critical_section_exit(&m_lock);
+            return;
+        }
+
+        const Entry &next = m_entries[m_numEntries - 1];
+        if (!isDue(next.time))
+        {
+            const bool missed = setAlarm(m_alarm, next.time);
+            critical_section_exit(&m_lock);
+            if (missed)
+                continue;
+            return;
+        }
+
+        const Entry e = next;
+        --m_numEntries;
+        critical_section_exit(&m_lock);
+
+        e.sink(e.packet);
+    }
+}
+
+#else
+
+void UMPScheduler::init()
+{
+}
+
+void UMPScheduler::schedule(const midi::universal_packet &p, UMPRouter::sendPacketProc *sink, uint32_t)
+{
+    sink(p);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef UMPSCHEDULER_H
+#define UMPSCHEDULER_H
+
+#include "UMPRouter.h"
+
+#if PICO_ON_DEVICE
+#include "pico/critical_section.h"
+#endif
+
+//! Releases UMPs to their sinks at a given time
+/***
+ *
+ * Packets are held in a queue sorted by time and released from a hardware
+ * timer alarm interrupt, so output timing does not depend on task
+ * scheduling. Sinks therefore have to be interrupt safe, which writing to
+ * a multi producer UMPRingBuffer is.
+ *
+ * Times are time_us_32() values. Packets with the same time are released
+ * in the order they got scheduled, packets that are already due or do not
+ * fit into the queue are passed to the sink right away.
+ *
+ * Host builds have no alarm, all packets are passed to the sink right away.
+ *
+ ***/
+class UMPScheduler
+{
+public:
+  static constexpr uint8_t capacity { 64 };
+
+  //! claim the hardware alarm, its interrupt is served by the calling core
+  void init();
+
+  void schedule(const midi::universal_packet&, UMPRouter::sendPacketProc *sink, uint32_t time);
+
+  uint32_t numOverflows { 0 }; //!< packets sent early because the queue was full
+
+private:
+#if PICO_ON_DEVICE
+  static void alarmCallback(uint alarm);
+  void release();
+#endif
+
+  struct Entry
+  {
+    uint32_t time;
+    UMPRouter::sendPacketProc *sink;
+    midi::universal_packet packet;
+  };
+
+  // sorted by descending time, next due entry at the end
+  Entry m_entries[capacity];
+  uint8_t m_numEntries { 0 };
+#if PICO_ON_DEVICE
+  critical_section_t m_lock;
+#endif
+  int m_alarm { -1 };
+};
+
+extern UMPScheduler umpScheduler;
+
+#endif // UMPSCHEDULER_H
@@ -0,0 +1,17 @@
+#include "UMPSources.h"
+
+#include <cstdio>
+
+UMPSourceRegistry umpSources;
+
+uint8_t UMPSourceRegistry::add(const UMPSource &source)
+{
+    if (m_numSources == maxSources)
+    {
+        printf("UMP source %s: too many sources\n", source.name);
+        return maxSources;
+    }
+
+    m_sources[m_numSources] = source;
+    return m_numSources++;
+}
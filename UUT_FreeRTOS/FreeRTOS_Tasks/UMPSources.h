@@ -0,0 +1,70 @@
+#ifndef UMPSOURCES_H
+#define UMPSOURCES_H
+
+#include "UMPRingBuffer.h"
+
+#include <midi/types.h>
+
+//! Type erased access to a UMPRingBuffer feeding all UMP endpoints
+struct UMPSource
+{
+    const char *name;
+    midi::protocol_t protocol; //!< of the channel voice messages, translated if the endpoint differs
+    uint8_t quantum;           //!< packets forwarded per round robin turn
+
+    void *buffer;
+    bool (*read)(void *buffer, UMPReadPtr&, midi::universal_packet&);
+    UMPSpan (*peekSpan)(void *buffer, UMPReadPtr&, uint16_t maxPackets);
+    bool (*commit)(void *buffer, UMPReadPtr&, const UMPSpan&);
+    void (*resetReadPtr)(void *buffer, UMPReadPtr&);
+    bool (*addReader)(void *buffer, UMPReaderNotifyProc*, void *reader);
+};
+
+//! Registry of all UMP source buffers
+/***
+ *
+ * Every source ring registers once, typically with a static initializer
+ * next to the buffer definition. Endpoints (see UMPProcessing) keep one
+ * UMPReadPtr per registered source, indexed by the id returned from add,
+ * so adding a transport does not touch the endpoints.
+ *
+ * The registry is constant initialized, so sources may register from
+ * static initializers in any translation unit.
+ *
+ ***/
+class UMPSourceRegistry
+{
+public:
+    static constexpr uint8_t maxSources { 8 };
+    static constexpr uint8_t defaultQuantum { 16 };
+
+    //! register buffer, returns the source id
+    template <uint16_t capacity, bool multiProducer>
+    uint8_t add(UMPRingBuffer<capacity, multiProducer> &buffer, const char *name,
+                midi::protocol_t protocol, uint8_t quantum = defaultQuantum)
+    {
+        using Buffer = UMPRingBuffer<capacity, multiProducer>;
+
+        return add(UMPSource {
+            name, protocol, quantum, &buffer,
+            [](void *b, UMPReadPtr &r, midi::universal_packet &p) { return static_cast<Buffer*>(b)->read(r, p); },
+            [](void *b, UMPReadPtr &r, uint16_t n) { return static_cast<Buffer*>(b)->peekSpan(r, n); },
+            [](void *b, UMPReadPtr &r, const UMPSpan &s) { return static_cast<Buffer*>(b)->commit(r, s); },
+            [](void *b, UMPReadPtr &r) { static_cast<Buffer*>(b)->resetReadPtr(r); },
+            [](void *b, UMPReaderNotifyProc *n, void *reader) { return static_cast<Buffer*>(b)->addReader(n, reader); }
+        });
+    }
+
+    uint8_t size() const { return m_numSources; }
+    const UMPSource &operator[](uint8_t id) const { return m_sources[id]; }
+
+private:
+    uint8_t add(const UMPSource&);
+
+    UMPSource m_sources[maxSources] {};
+    uint8_t m_numSources { 0 };
+};
+
+extern UMPSourceRegistry umpSources;
+
+#endif // UMPSOURCES_H
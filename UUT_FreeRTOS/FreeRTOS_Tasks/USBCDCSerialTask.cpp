@@ -1,6 +1,7 @@
 #include "USBCDCSerialTask.h"
 
 #include "FreeRTOS.h"
+#include "FreeRTOS_Tasks.h"
 #include "task.h"
 
 // for USB MIDI interface
@@ -29,41 +30,47 @@ static void sendPacket(const midi::universal_packet &p)
 
 static UMPProcessing cdcSerial("ProtoZOA CDC", sendPacket);
 
+static TaskHandle_t cdcTask = nullptr;
+
 extern "C" void pvrUSBCDCSerial(void * /*pvParameters*/)
 {
+    cdcTask = xTaskGetCurrentTaskHandle();
+    cdcSerial.addPendingUMPsReader(notifyTask, cdcTask);
+
     printf("USB CDC Serial task initialized.\n");
 
+    uint32_t untilSend = UINT32_MAX;
     while (1)
     {
-        taskYIELD();
+        // wait for received data, pending UMPs, a connection change or timed output
+        ulTaskNotifyTake(pdTRUE, ticksUntil(untilSend));
 
+        untilSend = UINT32_MAX;
         if (tud_cdc_connected())
         {
-            cdcSerial.sendPendingUMPs();
+            untilSend = cdcSerial.sendPendingUMPs();
 
-            // Read From USB Serial
-            char uBuf[1];
-            while (tud_cdc_available() && (tud_cdc_read(uBuf, 1) > 0))
+            // Read From USB Serial, decode whole chunks
+            uint8_t uBuf[64];
+            midi::universal_packet packets[16];
+            uint32_t numBytes;
+            while (tud_cdc_available() && ((numBytes = tud_cdc_read(uBuf, sizeof(uBuf))) > 0))
             {
-                switch (bracketing.feed(uBuf[0]))
+                size_t pos = 0;
+                while (pos < numBytes)
                 {
-                case SerialBracketing::SUCCESS:
-                    TRACE_INCOMING_PACKET("CDC in", bracketing.ump);
-                    cdcSerial.process(bracketing.ump);
-                    break;
-                case SerialBracketing::CRC_ERROR:
-                    dump_packet("CDC CRC error: ", bracketing.ump);
-                  #if PROTOZOA_SERIAL_BRACKET16
-                    printf("  expected 0x%02x, is 0x%02x\n", unsigned(uBuf[0]), unsigned(bracketing.checksum()));
-                  #endif
-                    break;
-                case SerialBracketing::INVALID_UMP:
-                    dump_packet("CDC Invalid UMP: ", bracketing.ump);
-                    break;
-                default:
-                    break;
+                    size_t numPackets;
+                    pos += bracketing.feed(uBuf + pos, numBytes - pos, packets, 16, numPackets);
+                    for (size_t i = 0; i < numPackets; ++i)
+                    {
+                        TRACE_INCOMING_PACKET("CDC in", packets[i]);
+                        cdcSerial.process(packets[i]);
+                    }
                 }
             }
+
+            if (const uint32_t errors = bracketing.takeErrors())
+                printf("CDC in: %u broken packets\n", unsigned(errors));
         }
         else
         {
@@ -71,3 +78,26 @@ extern "C" void pvrUSBCDCSerial(void * /*pvParameters*/)
         }
     }
 }
+
+void tud_cdc_rx_cb(uint8_t itf)
+{
+    (void) itf;
+    if (cdcTask)
+        notifyTask(cdcTask);
+}
+
+void tud_cdc_tx_complete_cb(uint8_t itf)
+{
+    (void) itf;
+    if (cdcTask)
+        notifyTask(cdcTask);
+}
+
+void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
+{
+    (void) itf;
+    (void) dtr;
+    (void) rts;
+    if (cdcTask)
+        notifyTask(cdcTask);
+}
@@ -1,6 +1,7 @@
 #include "USBMIDITask.h"
 
 #include "FreeRTOS.h"
+#include "FreeRTOS_Tasks.h"
 #include "task.h"
 
 #include "UMPProcessing.h"
@@ -16,53 +17,98 @@ static void sendPacket(const midi::universal_packet &p)
     tud_ump_write(0, (uint32_t*)p.data, p.size());
 }
 
-static UMPProcessing USBMIDI("ProtoZOA USB MIDI", sendPacket);
+// one write per packet, so a full FIFO cuts the burst between two packets
+static size_t sendWords(const uint32_t *words, size_t numWords)
+{
+    size_t sent = 0;
+    while (sent < numWords)
+    {
+        const uint32_t size = midi::universal_packet{ words[sent] }.size();
+        if (tud_ump_write(0, (uint32_t*)words + sent, size) < size)
+            break;
+        sent += size;
+    }
+
+    TRACE_OUTGOING_WORDS("USB MIDI Out", words, sent);
+    return sent;
+}
+
+static UMPProcessing USBMIDI("ProtoZOA USB MIDI", sendPacket, sendWords);
+
+static TaskHandle_t usbMIDITask = nullptr;
+
+//! Assembles UMPs from the USB endpoint FIFO
+/***
+ *
+ * Words are read from the FIFO straight into the packet being assembled,
+ * the header word first to learn the packet size, then all missing words
+ * with a single read. Packets split across USB transfers are completed on
+ * the next call.
+ *
+ ***/
+struct USBUMPReader
+{
+    midi::universal_packet packet;
+    uint8_t numWords { 0 }; //!< words of packet received so far
+
+    //! returns true once packet is complete
+    bool read()
+    {
+        if (numWords == 0)
+        {
+            if (tud_ump_read(0, &packet.data[0], 1) == 0)
+                return false;
+            numWords = 1;
+        }
+
+        const uint8_t size = uint8_t(packet.size());
+        if (numWords < size)
+        {
+            numWords += tud_ump_read(0, &packet.data[numWords], size - numWords);
+            if (numWords < size)
+                return false;
+        }
+
+        numWords = 0;
+        return true;
+    }
+};
 
 extern "C" void pvrUSBMIDI(void *pvParameters)
 {
+    usbMIDITask = xTaskGetCurrentTaskHandle();
+    USBMIDI.addPendingUMPsReader(notifyTask, usbMIDITask);
+
     printf("USB MIDI task initialized.\n");
 
-    midi::universal_packet inPacket;
-    size_t numMissingWords = 0;
+    USBUMPReader reader;
+    uint32_t untilSend = UINT32_MAX;
 
     while (true)
     {
-        taskYIELD();
+        // wait for received UMPs, pending UMPs, an interface change or timed output;
+        // there is no UMP transmit callback, a full FIFO is retried on the next tick
+        ulTaskNotifyTake(pdTRUE, ticksUntil(untilSend));
 
+        untilSend = UINT32_MAX;
         if (tud_ump_n_mounted(0))
         {
-            USBMIDI.sendPendingUMPs();
+            untilSend = USBMIDI.sendPendingUMPs();
 
             // Read and process USB MIDI
-            while (auto ump_n_available = tud_ump_n_available(0))
+            while (reader.read())
             {
-                constexpr uint16_t maxUMPWords = 32;
-                uint32_t wordBuffer[maxUMPWords];
-                uint32_t wordCount = tud_ump_read(0, wordBuffer, maxUMPWords);
-                for (uint32_t w = 0; w < wordCount; ++w)
+                if (reader.packet.data[0] != 0)
                 {
-                    if (numMissingWords == 0)
-                    {
-                        inPacket.data[0] = wordBuffer[w];
-                        numMissingWords = inPacket.size()-1;
-                    }
-                    else
-                    {
-                        inPacket.data[inPacket.size() - numMissingWords] = wordBuffer[w];
-                        --numMissingWords;
-                    }
-
-                    if ((numMissingWords == 0) && (inPacket.data[0] != 0))
-                    {
-                        TRACE_INCOMING_PACKET("USB MIDI In", inPacket); 
-                        USBMIDI.process(inPacket);
-                    }
+                    TRACE_INCOMING_PACKET("USB MIDI In", reader.packet);
+                    USBMIDI.process(reader.packet);
                 }
             }
         }
         else
         {
             USBMIDI.clearPendingUMPs();
+            reader.numWords = 0;
         }
     }
 }
@@ -70,4 +116,12 @@ extern "C" void pvrUSBMIDI(void *pvParameters)
 void tud_ump_set_itf_cb(uint8_t itf, uint8_t alt) {
     (void) itf;
     printf("UMP on USB enabled: %d \n", (int)alt);
+    if (usbMIDITask)
+        notifyTask(usbMIDITask);
+}
+
+void tud_ump_rx_cb(uint8_t itf) {
+    (void) itf;
+    if (usbMIDITask)
+        notifyTask(usbMIDITask);
 }
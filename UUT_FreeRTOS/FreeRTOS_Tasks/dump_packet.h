@@ -1,5 +1,8 @@
 #pragma once
 
+#include "PrioritySendQueue.h"
+#include "UMPRingBuffer.h"
+
 #include <midi/universal_packet.h>
 #include <cstdio>
 
@@ -19,6 +22,48 @@ inline void dump_packet(const char *what, const midi::universal_packet &p)
   }
 }
 
+inline void dump_dropped(const char *what, UMPReadPtr &readPtr)
+{
+  if (readPtr.dropped)
+  {
+    printf("%s overrun, dropped %u packets\n", what, unsigned(readPtr.dropped));
+    readPtr.dropped = 0;
+  }
+}
+
+template <uint16_t capacity>
+inline void dump_dropped(const char *what, PrioritySendQueue<capacity> &queue)
+{
+  if (const uint32_t dropped = queue.takeDropped())
+    printf("%s overrun, dropped %u packets\n", what, unsigned(dropped));
+}
+
+template <uint16_t capacity>
+inline void dump_delay_stats(const char *what, const PrioritySendQueue<capacity> &queue)
+{
+  static const char *const classNames[] = { "realtime", "channel voice", "bulk" };
+  for (uint8_t c = 0; c < PrioritySendQueue<capacity>::numClasses; ++c)
+  {
+    const auto &stats = queue.delayStats(typename PrioritySendQueue<capacity>::Class(c));
+    printf("%s %s queue delay: avg %u us, max %u us (%u samples)\n", what, classNames[c],
+           unsigned(stats.averageUs()), unsigned(stats.maxUs), unsigned(stats.numSamples));
+  }
+}
+
+inline void dump_words(const char *what, const uint32_t *words, size_t numWords)
+{
+  while (numWords)
+  {
+    midi::universal_packet p { words[0] };
+    const size_t size = (p.size() < numWords) ? p.size() : numWords;
+    for (size_t w = 1; w < size; ++w)
+      p.data[w] = words[w];
+    dump_packet(what, p);
+    words += size;
+    numWords -= size;
+  }
+}
+
 #if PROTOZOA_TRACE_INCOMING_TRAFFIC
 # define TRACE_INCOMING_PACKET(what, packet) dump_packet(what, packet)
 #else
@@ -27,6 +72,8 @@ inline void dump_packet(const char *what, const midi::universal_packet &p)
 
 #if PROTOZOA_TRACE_OUTGOING_TRAFFIC
 # define TRACE_OUTGOING_PACKET(what, packet) dump_packet(what, packet)
+# define TRACE_OUTGOING_WORDS(what, words, numWords) dump_words(what, words, numWords)
 #else
 # define TRACE_OUTGOING_PACKET(what, packet) 
+# define TRACE_OUTGOING_WORDS(what, words, numWords) 
 #endif
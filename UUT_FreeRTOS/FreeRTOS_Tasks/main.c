@@ -43,6 +43,7 @@
 #include "BlinkTask.h"
 #include "CMEWidiTask.h"
 #include "DINSerialTask.h"
+#include "Entropy.h"
 #include "EthernetW5500Task.h"
 #include "PicoMainTask.h"
 #include "Type25SerialTask.h"
@@ -251,6 +252,9 @@ void vApplicationIdleHook( void )
 
     /* Remove compiler warning about xFreeHeapSpace being set but never used. */
     ( void ) xFreeHeapSpace;
+
+    /* Feed the entropy pool used for MUIDs, never blocks. */
+    entropyIdleHook();
 }
 /*-----------------------------------------------------------*/
 
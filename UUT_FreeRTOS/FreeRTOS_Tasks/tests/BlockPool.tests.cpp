@@ -0,0 +1,71 @@
+#include "../BlockPool.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------
+
+TEST(BlockPool, allocate_deallocate)
+{
+  static BlockPool<32, 4> pool;
+
+  void *blocks[4];
+  for (auto &b : blocks)
+  {
+    b = pool.allocate();
+    ASSERT_NE(nullptr, b);
+    EXPECT_TRUE(pool.owns(b));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t));
+  }
+  EXPECT_EQ(nullptr, pool.allocate());
+  EXPECT_EQ(1u, pool.numFailed());
+  EXPECT_EQ(4u, pool.numUsed());
+
+  pool.deallocate(blocks[2]);
+  pool.deallocate(blocks[0]);
+  EXPECT_EQ(2u, pool.numUsed());
+  EXPECT_EQ(4u, pool.highWater());
+
+  // most recently freed block first
+  EXPECT_EQ(blocks[0], pool.allocate());
+  EXPECT_EQ(blocks[2], pool.allocate());
+  EXPECT_EQ(nullptr, pool.allocate());
+
+  int other;
+  EXPECT_FALSE(pool.owns(&other));
+}
+
+TEST(BlockPool, concurrent)
+{
+  constexpr unsigned numThreads = 4;
+  static BlockPool<16, 64> pool;
+
+  std::vector<std::thread> threads;
+  for (unsigned t=0; t<numThreads; ++t)
+    threads.emplace_back([t]() {
+      for (unsigned i=0; i<10000; ++i)
+      {
+        void *blocks[16];
+        for (auto &b : blocks)
+        {
+          b = pool.allocate();
+          ASSERT_NE(nullptr, b);
+          *static_cast<unsigned*>(b) = t;
+        }
+        for (auto &b : blocks)
+        {
+          EXPECT_EQ(t, *static_cast<unsigned*>(b)); // never handed out twice
+          pool.deallocate(b);
+        }
+      }
+    });
+
+  for (auto &t : threads)
+    t.join();
+
+  EXPECT_EQ(0u, pool.numUsed());
+  EXPECT_EQ(0u, pool.numFailed());
+  EXPECT_LE(pool.highWater(), 64u);
+}
@@ -0,0 +1,71 @@
+#include "../Entropy.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+//-----------------------------------------------
+
+TEST(Entropy, random_range)
+{
+  EntropyPool pool;
+
+  unsigned histogram[6] {};
+  for (unsigned i=0; i<6000; ++i)
+  {
+    const uint32_t r = pool.random(5);
+    ASSERT_LE(r, 5u);
+    ++histogram[r];
+  }
+  for (auto h : histogram)
+    EXPECT_GT(h, 800u);
+}
+
+TEST(Entropy, outputs_differ)
+{
+  EntropyPool pool;
+
+  std::set<uint32_t> values;
+  for (unsigned i=0; i<10000; ++i)
+    values.insert(pool.random32());
+  EXPECT_GT(values.size(), 9990u);
+
+  // pools with different samples diverge
+  EntropyPool a, b;
+  a.addSample(1, 0);
+  b.addSample(2, 0);
+  EXPECT_NE(a.random32(), b.random32());
+}
+
+TEST(Entropy, entropy_estimate)
+{
+  EntropyPool pool;
+  EXPECT_EQ(0, pool.entropyBits());
+  pool.addSample(0x1234, 16);
+  EXPECT_EQ(16, pool.entropyBits());
+  for (unsigned i=0; i<100; ++i)
+    pool.addSample(i, 8);
+  EXPECT_EQ(256, pool.entropyBits());
+}
+
+TEST(Entropy, muid)
+{
+  EntropyPool pool;
+
+  for (unsigned i=0; i<10000; ++i)
+  {
+    const uint32_t muid = pool.makeMUID();
+    EXPECT_LT(muid, 0x0FFFFF00u);
+  }
+
+  // the MUIDs to avoid are never returned, however likely they are
+  uint32_t avoid[3];
+  for (auto &a : avoid)
+    a = pool.makeMUID();
+  for (unsigned i=0; i<1000; ++i)
+  {
+    const uint32_t muid = pool.makeMUID(avoid, 3);
+    for (auto a : avoid)
+      EXPECT_NE(a, muid);
+  }
+}
@@ -0,0 +1,92 @@
+#include "../JitterReduction.h"
+#include "../UMPRingBuffer.h"
+
+#include <gtest/gtest.h>
+
+//-----------------------------------------------
+
+TEST(JitterReduction, messages)
+{
+  const auto clock = jr::makeClock(0x1234);
+  EXPECT_EQ(0x00101234u, clock.data[0]);
+  EXPECT_EQ(jr::clockStatus, jr::status(clock));
+  EXPECT_EQ(0x1234u, jr::time(clock));
+
+  const auto timestamp = jr::makeTimestamp(0xFEDC);
+  EXPECT_EQ(0x0020FEDCu, timestamp.data[0]);
+  EXPECT_EQ(jr::timestampStatus, jr::status(timestamp));
+
+  EXPECT_EQ(0u, jr::ticks(31));
+  EXPECT_EQ(1u, jr::ticks(32));
+  EXPECT_EQ(0x0000u, jr::ticks(0x200000));
+}
+
+TEST(JitterReduction, clock_receiver)
+{
+  JRClockReceiver r;
+
+  uint32_t t;
+  EXPECT_FALSE(r.localTime(0, t));
+
+  // sender clock 100 ticks behind local time, plus transport delay
+  r.clock(1000, 1000 * 32 + 3200 + 500);
+  EXPECT_TRUE(r.localTime(1000, t));
+  EXPECT_EQ(1000u * 32 + 3200 + 500, t);
+  EXPECT_TRUE(r.localTime(1010, t));
+  EXPECT_EQ(1010u * 32 + 3200 + 500, t);
+  EXPECT_TRUE(r.localTime(990, t));
+  EXPECT_EQ(990u * 32 + 3200 + 500, t);
+
+  // less delayed clock improves the estimate, more delayed ones don't
+  r.clock(2000, 2000 * 32 + 3200 + 100);
+  r.clock(3000, 3000 * 32 + 3200 + 900);
+  EXPECT_TRUE(r.localTime(3000, t));
+  EXPECT_EQ(3000u * 32 + 3200 + 100, t);
+
+  r.reset();
+  EXPECT_FALSE(r.localTime(3000, t));
+}
+
+TEST(JitterReduction, clock_wrap_around)
+{
+  JRClockReceiver r;
+
+  uint32_t now = 0xFFFF0000;
+  uint16_t senderClock = 0xFF00;
+  for (unsigned i=0; i<100; ++i)
+  {
+    r.clock(senderClock, now);
+
+    uint32_t t;
+    EXPECT_TRUE(r.localTime(uint16_t(senderClock + 10), t));
+    EXPECT_EQ(now + 320, t);
+
+    senderClock += 7812; // 250ms
+    now += 7812 * 32;
+  }
+}
+
+TEST(JitterReduction, ingress_stamp)
+{
+  UMPRingBuffer<64> ring;
+  UMPReadPtr readPtr;
+  JRIngressStamp stamp;
+
+  // a timestamp ahead of every run of packets within one tick
+  stamp.write(ring, midi::universal_packet{ 0x20903C64 }, 3200);
+  stamp.write(ring, midi::universal_packet{ 0x20803C00 }, 3231);
+  stamp.write(ring, midi::universal_packet{ 0x20B00700 }, 6400);
+
+  const uint32_t expected[] = { 0x00200064, 0x20903C64, 0x20803C00, 0x002000C8, 0x20B00700 };
+  midi::universal_packet p;
+  for (const uint32_t word : expected)
+  {
+    ASSERT_TRUE(ring.read(readPtr, p));
+    EXPECT_EQ(word, p.data[0]);
+  }
+  EXPECT_FALSE(ring.read(readPtr, p));
+
+  EXPECT_TRUE(jr::isTimestamp(expected[0]));
+  EXPECT_FALSE(jr::isTimestamp(jr::makeClock(0x0064).data[0]));
+  EXPECT_FALSE(jr::isTimestamp(expected[1]));
+}
@@ -0,0 +1,146 @@
+#include "../Deflate.h"
+#include "../Mcoded7.h"
+#include "../PEReplyBody.h"
+
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------
+
+namespace {
+
+struct ByteSink
+{
+  std::vector<uint8_t> bytes;
+  void operator()(uint8_t b) { bytes.push_back(b); }
+};
+
+std::vector<uint8_t> inflate(const std::vector<uint8_t> &compressed, size_t size)
+{
+  std::vector<uint8_t> result(size + 16);
+  uLongf length = result.size();
+  EXPECT_EQ(Z_OK, uncompress(result.data(), &length, compressed.data(), compressed.size()));
+  result.resize(length);
+  return result;
+}
+
+template <uint16_t window_size = 256>
+std::vector<uint8_t> deflate(const std::vector<uint8_t> &data)
+{
+  ByteSink sink;
+  DeflateEncoder<ByteSink, window_size> encoder{ sink };
+  encoder.write(data.data(), data.size());
+  encoder.finish();
+  return sink.bytes;
+}
+
+const std::string json {
+R"({
+  "manufacturerId": [ 125 ],
+  "familyId": [ 0, 0 ],
+  "modelId": [ 0, 0 ],
+  "versionId": [ 1, 0, 0, 0 ],
+  "manufacturer": "ProtoZOA",
+  "family": "UUT_FreeRTOS_TASKS",
+  "model": "-",
+  "version": "0.0.1"
+})" };
+
+} // namespace
+
+//-----------------------------------------------
+
+TEST(PEEncoding, mcoded7)
+{
+  std::vector<uint8_t> data;
+  for (unsigned i=0; i<100; ++i)
+    data.push_back(uint8_t(i * 37 + 0x80 * (i & 1)));
+
+  ByteSink encoded;
+  Mcoded7Encoder<ByteSink> encoder{ encoded };
+  encoder.write(data.data(), data.size());
+  encoder.flush();
+
+  EXPECT_EQ(Mcoded7Encoder<ByteSink>::encoded_size(data.size()), encoded.bytes.size());
+  for (auto b : encoded.bytes)
+    EXPECT_EQ(0, b & 0x80);
+
+  ByteSink decoded;
+  Mcoded7Decoder<ByteSink> decoder{ decoded };
+  decoder.write(encoded.bytes.data(), encoded.bytes.size());
+  EXPECT_EQ(data, decoded.bytes);
+}
+
+TEST(PEEncoding, mcoded7_layout)
+{
+  ByteSink encoded;
+  Mcoded7Encoder<ByteSink> encoder{ encoded };
+  encoder(0x81);
+  encoder(0x02);
+  encoder(0xFF);
+  encoder.flush();
+
+  const std::vector<uint8_t> expected { 0x50, 0x01, 0x02, 0x7F };
+  EXPECT_EQ(expected, encoded.bytes);
+}
+
+TEST(PEEncoding, deflate_json)
+{
+  const std::vector<uint8_t> data(json.begin(), json.end());
+  const auto compressed = deflate(data);
+
+  EXPECT_LT(compressed.size(), data.size());
+  EXPECT_EQ(data, inflate(compressed, data.size()));
+}
+
+TEST(PEEncoding, deflate_empty)
+{
+  const auto compressed = deflate({});
+  EXPECT_EQ(std::vector<uint8_t>{}, inflate(compressed, 0));
+}
+
+TEST(PEEncoding, deflate_long_input)
+{
+  // much longer than the window, long runs and random data
+  std::vector<uint8_t> data;
+  for (unsigned i=0; i<40; ++i)
+    data.insert(data.end(), json.begin(), json.end());
+  data.insert(data.end(), 1000, 'x');
+  uint32_t r = 1;
+  for (unsigned i=0; i<3000; ++i)
+  {
+    r = r * 1103515245 + 12345;
+    data.push_back(uint8_t(r >> 16));
+  }
+
+  EXPECT_EQ(data, inflate(deflate(data), data.size()));
+  EXPECT_EQ(data, inflate(deflate<1024>(data), data.size()));
+}
+
+TEST(PEEncoding, reply_body)
+{
+  EXPECT_EQ(Encoding::ZlibMcoded7, parse_encoding("zlib+Mcoded7", 12));
+  EXPECT_EQ(Encoding::Mcoded7, parse_encoding("Mcoded7", 7));
+  EXPECT_EQ(Encoding::ASCII, parse_encoding("gzip", 4));
+
+  const PEReplyBody body{ json };
+
+  ByteSink ascii;
+  body.encode(Encoding::ASCII, ascii);
+  EXPECT_EQ(std::vector<uint8_t>(json.begin(), json.end()), ascii.bytes);
+
+  // Mcoded7 output is 7 bit clean, decoding it yields the zlib stream
+  ByteSink encoded;
+  body.encode(Encoding::ZlibMcoded7, encoded);
+  for (auto b : encoded.bytes)
+    EXPECT_EQ(0, b & 0x80);
+
+  ByteSink compressed;
+  Mcoded7Decoder<ByteSink> decoder{ compressed };
+  decoder.write(encoded.bytes.data(), encoded.bytes.size());
+  EXPECT_EQ(std::vector<uint8_t>(json.begin(), json.end()), inflate(compressed.bytes, json.size()));
+}
@@ -0,0 +1,169 @@
+#include "../PEHeaderParser.h"
+#include "../PerfectHash.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+//-----------------------------------------------
+
+static PEHeaderParser parser(const std::string &header)
+{
+  return PEHeaderParser{ header.data(), header.size() };
+}
+
+//-----------------------------------------------
+
+TEST(PEHeaderParser, resources)
+{
+  const std::pair<std::string, Resource> cases[] = {
+    { R"({"resource":"ResourceList"})", Resource::ResourceList },
+    { R"({"resource":"DeviceInfo"})", Resource::DeviceInfo },
+    { R"({"resource":"ChannelList"})", Resource::ChannelList },
+    { R"({"resource":"ChCtrlList"})", Resource::ChCtrlList },
+    { R"({"resource":"ProgramList","offset":0})", Resource::ProgramList },
+  };
+
+  for (const auto &c : cases)
+  {
+    Resource r { Resource::None };
+    auto p = parser(c.first);
+    EXPECT_EQ(0, p.get_resource(r)) << c.first;
+    EXPECT_EQ(c.second, r) << c.first;
+  }
+}
+
+TEST(PEHeaderParser, invalid_resources)
+{
+  // not supported
+  for (const std::string header : { R"({"resource":"DeviceInfx"})",
+                                    R"({"resource":"Device"})",
+                                    R"({"resource":"DeviceInfoX"})",
+                                    R"({"resId":"x","resource":"Device"})" })
+  {
+    Resource r { Resource::None };
+    auto p = parser(header);
+    EXPECT_EQ(-2, p.get_resource(r)) << header;
+  }
+
+  // missing or malformed
+  for (const std::string header : { R"({"resource":""})",
+                                    R"({"resource":"DeviceInfo")",
+                                    R"({"resource":"DeviceInfo)",
+                                    R"({"resource":)",
+                                    R"({"resId":"x"})",
+                                    R"({"resId":"x","resource":"")",
+                                    R"({"resId":"x)" })
+  {
+    Resource r { Resource::None };
+    auto p = parser(header);
+    EXPECT_EQ(-1, p.get_resource(r)) << header;
+  }
+}
+
+TEST(PEHeaderParser, resource_not_first)
+{
+  const std::string header { R"({"path":"a/b","resource":"ProgramList","offset":2})" };
+  auto p = parser(header);
+
+  Resource r { Resource::None };
+  ASSERT_EQ(0, p.get_resource(r));
+  EXPECT_EQ(Resource::ProgramList, r);
+
+  // the options start over with the first field
+  Option o;
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Resource, o.what);
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Offset, o.what);
+  EXPECT_EQ("2", std::string(o.value.string, o.value.length));
+  EXPECT_EQ(1, p.get_next_option(o));
+}
+
+TEST(PEHeaderParser, options)
+{
+  const std::string header { R"({"resource":"ChannelList","offset":10,"limit":5,"mutualEncoding":"zlib+Mcoded7","id":"x"})" };
+  auto p = parser(header);
+
+  Resource r;
+  ASSERT_EQ(0, p.get_resource(r));
+
+  Option o;
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Offset, o.what);
+  EXPECT_EQ("10", std::string(o.value.string, o.value.length));
+
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Limit, o.what);
+  EXPECT_EQ("5", std::string(o.value.string, o.value.length));
+
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Encoding, o.what);
+  EXPECT_EQ("zlib+Mcoded7", std::string(o.value.string, o.value.length));
+
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::ID, o.what);
+  EXPECT_EQ("x", std::string(o.value.string, o.value.length));
+
+  EXPECT_EQ(1, p.get_next_option(o));
+}
+
+TEST(PEHeaderParser, unknown_options)
+{
+  // unknown properties are skipped, whatever their value
+  const std::string header { R"({"resource":"ChannelList","offsets":10,"path":"a,b\"}","x-vendor":{"a":[1,{"b":"}"}],"c":true},"limit":5,"x-last":[]})" };
+  auto p = parser(header);
+
+  Resource r;
+  ASSERT_EQ(0, p.get_resource(r));
+
+  Option o;
+  ASSERT_EQ(0, p.get_next_option(o));
+  EXPECT_EQ(Option::What::Limit, o.what);
+  EXPECT_EQ("5", std::string(o.value.string, o.value.length));
+  EXPECT_EQ(1, p.get_next_option(o));
+}
+
+TEST(PEHeaderParser, invalid_option)
+{
+  for (const std::string header : { R"({"resource":"ChannelList","offsets":[10})",
+                                    R"({"resource":"ChannelList","path":"a)",
+                                    R"({"resource":"ChannelList","path"})",
+                                    R"({"resource":"ChannelList","limit")",
+                                    R"({"resource":"ChannelList","x":1])",
+                                    R"({"resource":"ChannelList";"limit":1})" })
+  {
+    auto p = parser(header);
+
+    Resource r;
+    ASSERT_EQ(0, p.get_resource(r)) << header;
+
+    Option o;
+    int result;
+    while ((result = p.get_next_option(o)) == 0)
+      ;
+    EXPECT_EQ(-1, result) << header;
+  }
+}
+
+TEST(PEHeaderParser, perfect_hash)
+{
+  static constexpr Keyword<int> keywords[] = {
+    { 0, "ResourceList" }, { 1, "DeviceInfo" }, { 2, "ChannelList" }, { 3, "ChCtrlList" },
+    { 4, "ProgramList" }, { 5, "X-ParameterList" }, { 6, "State" }, { 7, "AllCtrlList" },
+    { 8, "ModeList" }, { 9, "CurrentMode" }, { 10, "LocalOn" }, { 11, "ExternalSync" },
+  };
+  static constexpr PerfectHash table { keywords };
+  static_assert(table.valid(), "no perfect hash");
+
+  for (const auto &k : keywords)
+  {
+    const auto found = table.find(k.string.data(), k.string.size());
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(k.value, found->value);
+  }
+
+  EXPECT_EQ(nullptr, table.find("Stats", 5));
+  EXPECT_EQ(nullptr, table.find("", 0));
+}
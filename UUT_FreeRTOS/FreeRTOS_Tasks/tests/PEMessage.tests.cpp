@@ -0,0 +1,98 @@
+#include "../PEMessage.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------
+
+static std::vector<uint8_t> write(const PEMessage &m)
+{
+  std::vector<uint8_t> data(PEMessage::overhead + m.header.size() + m.data.size());
+  EXPECT_EQ(data.size(), m.write(data.data(), data.size()));
+  EXPECT_EQ(0u, m.write(data.data(), data.size() - 1));
+  return data;
+}
+
+static PEMessage chunk(uint16_t num_chunks, uint16_t chunk_number, std::string_view header, std::string_view data,
+                       uint32_t muid = 0x1234567, uint8_t request_id = 3)
+{
+  PEMessage m;
+  m.subtype = PEMessage::set_property_data_inquiry;
+  m.source_muid = muid;
+  m.destination_muid = 0x0ABCDEF;
+  m.request_id = request_id;
+  m.header = header;
+  m.num_chunks = num_chunks;
+  m.chunk_number = chunk_number;
+  m.data = data;
+  return m;
+}
+
+//-----------------------------------------------
+
+TEST(PEMessage, layout)
+{
+  const auto data = write(chunk(2, 1, "{}", "xyz"));
+
+  const std::vector<uint8_t> expected {
+    0x7F, 0x0D, 0x36, 0x02,
+    0x67, 0x0A, 0x0D, 0x09,     // source MUID, 7 bit LSB first
+    0x6F, 0x1B, 0x2F, 0x05,     // destination MUID
+    0x03,                       // request id
+    0x02, 0x00, '{', '}',       // header
+    0x02, 0x00, 0x01, 0x00,     // number of chunks, chunk number
+    0x03, 0x00, 'x', 'y', 'z',  // property data
+  };
+  EXPECT_EQ(expected, data);
+}
+
+TEST(PEMessage, round_trip)
+{
+  const std::string header { R"({"resource":"X-Settings","setPartial":true})" };
+  const std::string body(300, 'a');
+  const auto data = write(chunk(3, 2, header, body));
+
+  PEMessage m;
+  ASSERT_TRUE(m.parse(data.data(), data.size()));
+  EXPECT_EQ(PEMessage::set_property_data_inquiry, m.subtype);
+  EXPECT_EQ(0x1234567u, m.source_muid);
+  EXPECT_EQ(0x0ABCDEFu, m.destination_muid);
+  EXPECT_EQ(3, m.request_id);
+  EXPECT_EQ(header, m.header);
+  EXPECT_EQ(3, m.num_chunks);
+  EXPECT_EQ(2, m.chunk_number);
+  EXPECT_EQ(body, m.data);
+
+  // truncated messages are rejected
+  for (size_t size = 0; size < data.size(); ++size)
+    EXPECT_FALSE(m.parse(data.data(), size)) << size;
+}
+
+TEST(PEMessage, chunk_assembly)
+{
+  PEChunkAssembler<32, 8> assembler;
+
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(3, 1, "{h}", "abc")));
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(3, 2, "", "de")));
+  EXPECT_EQ(assembler.complete, assembler.add(chunk(3, 3, "", "f")));
+  EXPECT_EQ("{h}", assembler.header());
+  EXPECT_EQ("abcdef", std::string(reinterpret_cast<const char*>(assembler.data()), assembler.size()));
+
+  // a chunk of another request, a missing chunk
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(3, 1, "{h}", "abc")));
+  EXPECT_EQ(assembler.out_of_sequence, assembler.add(chunk(3, 2, "", "de", 0x7654321)));
+  EXPECT_EQ(assembler.out_of_sequence, assembler.add(chunk(3, 3, "", "f")));
+
+  // a new first chunk restarts
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(2, 1, "{h}", "abc")));
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(2, 1, "{i}", "xy")));
+  EXPECT_EQ(assembler.complete, assembler.add(chunk(2, 2, "", "z")));
+  EXPECT_EQ("{i}", assembler.header());
+  EXPECT_EQ(3u, assembler.size());
+
+  // data beyond capacity is reported once the last chunk arrived
+  EXPECT_EQ(assembler.incomplete, assembler.add(chunk(2, 1, "{h}", "abcdef")));
+  EXPECT_EQ(assembler.too_large, assembler.add(chunk(2, 2, "", "ghi")));
+}
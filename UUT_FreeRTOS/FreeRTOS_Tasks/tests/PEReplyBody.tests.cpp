@@ -0,0 +1,50 @@
+#include "../PEReplyBody.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <string>
+
+//-----------------------------------------------
+
+static std::string read_chunked(const PEReplyBody &body, size_t chunk_size)
+{
+  std::string result;
+  char chunk[64];
+  for (size_t c = 0; c < body.num_chunks(chunk_size); ++c)
+  {
+    const size_t n = body.read(c * chunk_size, chunk, chunk_size);
+    EXPECT_LE(n, chunk_size);
+    result.append(chunk, n);
+  }
+  return result;
+}
+
+TEST(PEReplyBody, value)
+{
+  const PEReplyBody body { std::string_view{ R"({"manufacturer":"ProtoZOA"})" } };
+  EXPECT_EQ(27u, body.size());
+  EXPECT_EQ(1u, body.num_chunks(64));
+  EXPECT_EQ(4u, body.num_chunks(7));
+  EXPECT_EQ(R"({"manufacturer":"ProtoZOA"})", read_chunked(body, 7));
+  EXPECT_EQ(R"({"manufacturer":"ProtoZOA"})", read_chunked(body, 64));
+}
+
+TEST(PEReplyBody, list)
+{
+  constexpr std::string_view entries[] { "{\"a\":1}", "{\"b\":2}", "{\"c\":3}", "{\"d\":4}" };
+
+  const PEReplyBody all { entries, std::size(entries), 0, SIZE_MAX };
+  EXPECT_EQ(R"([{"a":1},{"b":2},{"c":3},{"d":4}])", read_chunked(all, 5));
+  EXPECT_EQ(all.size(), read_chunked(all, 64).size());
+
+  const PEReplyBody page { entries, std::size(entries), 1, 2 };
+  EXPECT_EQ(R"([{"b":2},{"c":3}])", read_chunked(page, 3));
+
+  const PEReplyBody tail { entries, std::size(entries), 3, 10 };
+  EXPECT_EQ(R"([{"d":4}])", read_chunked(tail, 1));
+
+  const PEReplyBody empty { entries, std::size(entries), 10, 10 };
+  EXPECT_EQ("[]", read_chunked(empty, 8));
+  EXPECT_EQ(1u, empty.num_chunks(8));
+}
@@ -0,0 +1,123 @@
+#include "../PESubscriptions.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------
+
+namespace {
+
+struct Notification
+{
+  uint8_t id;
+  std::string patch;
+};
+
+std::vector<Notification> poll(PESubscriptions &subscriptions, const ControlState &state, uint32_t now)
+{
+  std::vector<Notification> notifications;
+  const auto current = state.snapshot();
+  subscriptions.poll(current, now, [&](const PESubscriptions::Subscription &s, const ControlState::Snapshot &previous) {
+    char patch[128];
+    const size_t size = ControlState::toJSONPatch(previous, current, patch, sizeof(patch));
+    notifications.push_back({ s.id, std::string(patch, size) });
+  });
+  return notifications;
+}
+
+} // namespace
+
+//-----------------------------------------------
+
+TEST(PESubscriptions, json)
+{
+  ControlState state;
+  state.setPot(0, 0x123);
+  state.setPot(1, 0xFFF);
+  state.setCap(2, true);
+  state.setCap(7, true); // no such CAP
+
+  char json[128];
+  const auto s = state.snapshot();
+  EXPECT_EQ(R"({"pots":[291,4095],"caps":[false,false,true,false,false,false,false]})",
+            std::string(json, ControlState::toJSON(s, json, sizeof(json))));
+  EXPECT_EQ(0u, ControlState::toJSON(s, json, 20));
+
+  state.setCap(2, false);
+  state.setPot(1, 0);
+  EXPECT_EQ(R"({"/pots/1":0,"/caps/2":false})",
+            std::string(json, ControlState::toJSONPatch(s, state.snapshot(), json, sizeof(json))));
+  EXPECT_EQ("{}", std::string(json, ControlState::toJSONPatch(s, s, json, sizeof(json))));
+}
+
+TEST(PESubscriptions, start_end)
+{
+  PESubscriptions subscriptions;
+  const ControlState::Snapshot s;
+  EXPECT_TRUE(subscriptions.empty());
+
+  uint8_t ids[PESubscriptions::max_subscriptions];
+  for (auto &id : ids)
+  {
+    id = subscriptions.start(0x100, Resource::XControlState, s, 0);
+    EXPECT_NE(0, id);
+  }
+  EXPECT_EQ(0, subscriptions.start(0x100, Resource::XControlState, s, 0));
+
+  EXPECT_FALSE(subscriptions.end(0x200, ids[1])); // wrong MUID
+  EXPECT_TRUE(subscriptions.end(0x100, ids[1]));
+  EXPECT_FALSE(subscriptions.end(0x100, ids[1]));
+
+  // ids are not reused while in use
+  const uint8_t id = subscriptions.start(0x200, Resource::XSettings, s, 0);
+  for (auto i : ids)
+    EXPECT_TRUE((i == ids[1]) || (i != id));
+
+  subscriptions.end_all(0x100);
+  EXPECT_FALSE(subscriptions.empty());
+  EXPECT_TRUE(subscriptions.end(0x200, id));
+  EXPECT_TRUE(subscriptions.empty());
+}
+
+TEST(PESubscriptions, rate_limit_and_coalescing)
+{
+  ControlState state;
+  PESubscriptions subscriptions;
+  const uint32_t interval = subscriptions.notify_interval();
+
+  uint32_t now = 1000000;
+  const uint8_t id = subscriptions.start(0x100, Resource::XControlState, state.snapshot(), now);
+  subscriptions.start(0x200, Resource::XSettings, state.snapshot(), now);
+
+  EXPECT_TRUE(poll(subscriptions, state, now).empty());
+
+  // the first change goes out right away
+  state.setPot(0, 100);
+  auto n = poll(subscriptions, state, ++now);
+  ASSERT_EQ(1u, n.size());
+  EXPECT_EQ(id, n[0].id);
+  EXPECT_EQ(R"({"/pots/0":100})", n[0].patch);
+
+  // changes within the interval are coalesced
+  for (uint16_t v = 101; v < 110; ++v)
+  {
+    state.setPot(0, v);
+    state.setCap(1, v & 1);
+    EXPECT_TRUE(poll(subscriptions, state, now += interval / 10).empty());
+  }
+  state.setPot(1, 7);
+
+  n = poll(subscriptions, state, now += interval / 10);
+  ASSERT_EQ(1u, n.size());
+  EXPECT_EQ(R"({"/pots/0":109,"/pots/1":7,"/caps/1":true})", n[0].patch);
+
+  // changes that cancel out are not notified
+  state.setPot(1, 8);
+  state.setPot(1, 7);
+  EXPECT_TRUE(poll(subscriptions, state, now += interval).empty());
+
+  subscriptions.set_notify_interval(0);
+  EXPECT_EQ(PESubscriptions::min_notify_interval, subscriptions.notify_interval());
+}
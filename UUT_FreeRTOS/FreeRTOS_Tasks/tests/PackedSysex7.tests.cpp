@@ -0,0 +1,69 @@
+#include "../PackedSysex7.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+//-----------------------------------------------
+
+TEST(PackedSysex7, single_packet)
+{
+  static constexpr uint8_t bytes[] { 0x7E, 0x7F, 0x06, 0x01 };
+  static constexpr PackedSysex7 sx { bytes, 3 };
+  static_assert(sx.numWords == 2, "one packet");
+
+  EXPECT_EQ(0x33047E7Fu, sx.words()[0]);
+  EXPECT_EQ(0x06010000u, sx.words()[1]);
+}
+
+TEST(PackedSysex7, multi_packet)
+{
+  static constexpr uint8_t bytes[] {
+    0x7E, 0x7F, 0x0D, 0x31, 0x02, 0x01,
+    0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09 };
+  static constexpr PackedSysex7 sx { bytes };
+
+  const std::vector<uint32_t> expected {
+    0x30167E7F, 0x0D310201,
+    0x30260203, 0x04050607,
+    0x30320809, 0x00000000,
+  };
+  EXPECT_EQ(expected, std::vector<uint32_t>(sx.words(), sx.words() + sx.numWords));
+}
+
+TEST(PackedSysex7, patch)
+{
+  static constexpr uint8_t bytes[] {
+    0x7E, 0x7F, 0x0D, 0x31, 0x02,
+    0, 0, 0, 0,
+    0, 0, 0, 0,
+    1, 0, 0 };
+  static constexpr PackedSysex7 reply { bytes };
+
+  auto sx = reply;
+  sx.setMUID(5, 0x0FFFFFFF);
+  sx.setMUID(9, 0x01234567);
+  sx.setByte(15, 0xFF); // 7 bit only
+
+  const uint8_t patched[] {
+    0x7E, 0x7F, 0x0D, 0x31, 0x02,
+    0x7F, 0x7F, 0x7F, 0x7F,
+    0x67, 0x0A, 0x0D, 0x09,
+    1, 0, 0x7F };
+  const PackedSysex7 expected { patched };
+
+  EXPECT_EQ(std::vector<uint32_t>(expected.words(), expected.words() + expected.numWords),
+            std::vector<uint32_t>(sx.words(), sx.words() + sx.numWords));
+}
+
+TEST(PackedSysex7, group)
+{
+  static constexpr uint8_t bytes[] { 0, 1, 2, 3, 4, 5, 6, 7 };
+  auto sx = PackedSysex7{ bytes };
+  sx.setGroup(0x0B);
+
+  const PackedSysex7 expected { bytes, 0x0B };
+  EXPECT_EQ(std::vector<uint32_t>(expected.words(), expected.words() + expected.numWords),
+            std::vector<uint32_t>(sx.words(), sx.words() + sx.numWords));
+}
@@ -0,0 +1,190 @@
+#include "../PrioritySendQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+//-----------------------------------------------
+
+using Queue = PrioritySendQueue<64>;
+
+static std::vector<uint32_t> drain(Queue &q, uint32_t now = 0)
+{
+  std::vector<uint32_t> words;
+  midi::universal_packet p;
+  while (q.read(p, now))
+    words.push_back(p.data[0]);
+  return words;
+}
+
+//-----------------------------------------------
+
+TEST(PrioritySendQueue, classify)
+{
+  EXPECT_EQ(Queue::Realtime, Queue::classOf(midi::universal_packet{ 0x10F80000 }));
+  EXPECT_EQ(Queue::Realtime, Queue::classOf(midi::universal_packet{ 0x10FA0000 }));
+  EXPECT_EQ(Queue::ChannelVoice, Queue::classOf(midi::universal_packet{ 0x10F21002 }));
+  EXPECT_EQ(Queue::ChannelVoice, Queue::classOf(midi::universal_packet{ 0x20903C64 }));
+  EXPECT_EQ(Queue::ChannelVoice, Queue::classOf(midi::universal_packet{ 0x40903C00, 0xFFFF0000 }));
+  EXPECT_EQ(Queue::Bulk, Queue::classOf(midi::universal_packet{ 0x30047E7F, 0x06010000 }));
+  EXPECT_EQ(Queue::Bulk, Queue::classOf(midi::universal_packet{ 0x50010000, 0, 0, 0 }));
+}
+
+TEST(PrioritySendQueue, priorities)
+{
+  Queue q;
+
+  q.write(midi::universal_packet{ 0x30047E7F, 0x06010000 });
+  q.write(midi::universal_packet{ 0x20903C64 });
+  q.write(midi::universal_packet{ 0x10F80000 });
+  q.write(midi::universal_packet{ 0x20803C00 });
+  q.write(midi::universal_packet{ 0x10FC0000 });
+
+  EXPECT_EQ((std::vector<uint32_t>{ 0x10F80000, 0x10FC0000, 0x20903C64, 0x20803C00, 0x30047E7F }), drain(q));
+  EXPECT_EQ(0u, q.takeDropped());
+}
+
+TEST(PrioritySendQueue, peek_and_consume)
+{
+  Queue q;
+  midi::universal_packet p;
+
+  q.write(midi::universal_packet{ 0x20903C64 });
+  EXPECT_TRUE(q.peek(p, 0));
+  EXPECT_EQ(0x20903C64, p.data[0]);
+
+  // not consumed, a real time message overtakes it
+  q.write(midi::universal_packet{ 0x10F80000 });
+  EXPECT_TRUE(q.peek(p, 0));
+  EXPECT_EQ(0x10F80000, p.data[0]);
+  q.consume(0);
+
+  EXPECT_TRUE(q.peek(p, 0));
+  EXPECT_EQ(0x20903C64, p.data[0]);
+  q.consume(0);
+  q.consume(0);
+
+  EXPECT_FALSE(q.peek(p, 0));
+}
+
+TEST(PrioritySendQueue, sysex_boundaries)
+{
+  Queue q;
+  midi::universal_packet p;
+
+  // F0 01 02 03 04 05 06 | 07 08 09 0A 0B 0C | 0D F7
+  q.write(midi::universal_packet{ 0x30160102, 0x03040506 });
+  q.write(midi::universal_packet{ 0x3026070A, 0x0B0C0D0E });
+
+  EXPECT_TRUE(q.read(p, 0));
+  EXPECT_EQ(0x30160102, p.data[0]);
+
+  // channel voice waits for the end of the message, real time does not
+  q.write(midi::universal_packet{ 0x20903C64 });
+  q.write(midi::universal_packet{ 0x10F80000 });
+  q.write(midi::universal_packet{ 0x30310D00 });
+
+  EXPECT_EQ((std::vector<uint32_t>{ 0x10F80000, 0x3026070A, 0x30310D00, 0x20903C64 }), drain(q));
+}
+
+TEST(PrioritySendQueue, stalled_sysex)
+{
+  Queue q;
+  midi::universal_packet p;
+
+  EXPECT_EQ(UINT32_MAX, q.untilSysexGivenUp(0));
+
+  q.write(midi::universal_packet{ 0x30160102, 0x03040506 });
+  EXPECT_TRUE(q.read(p, 1000));
+  EXPECT_EQ(Queue::sysexStallUs, q.untilSysexGivenUp(1000));
+
+  q.write(midi::universal_packet{ 0x20903C64 });
+  EXPECT_FALSE(q.peek(p, 1000 + Queue::sysexStallUs - 1));
+
+  // given up, the channel voice message goes out
+  EXPECT_EQ(0u, q.untilSysexGivenUp(1000 + Queue::sysexStallUs));
+  EXPECT_TRUE(q.read(p, 1000 + Queue::sysexStallUs));
+  EXPECT_EQ(0x20903C64, p.data[0]);
+  EXPECT_EQ(UINT32_MAX, q.untilSysexGivenUp(1000 + Queue::sysexStallUs));
+
+  // the late rest of the message is discarded, the next message is sent
+  q.write(midi::universal_packet{ 0x3026070A, 0x0B0C0D0E });
+  q.write(midi::universal_packet{ 0x30310D00 });
+  q.write(midi::universal_packet{ 0x30047E7F, 0x06010000 });
+  EXPECT_EQ((std::vector<uint32_t>{ 0x30047E7F }), drain(q));
+}
+
+TEST(PrioritySendQueue, delay_stats)
+{
+  Queue q;
+
+  for (unsigned i = 0; i < Queue::sampleInterval; ++i)
+    q.write(midi::universal_packet{ 0x20903C64 });
+  q.write(midi::universal_packet{ 0x10F80000 });
+  drain(q, board::timeUs() + 5000);
+
+  // a newer probe replaces one not consumed yet
+  for (unsigned i = 0; i < 2 * Queue::sampleInterval; ++i)
+    q.write(midi::universal_packet{ 0x20903C64 });
+  drain(q, board::timeUs() + 5000);
+
+  const auto &voice = q.delayStats(Queue::ChannelVoice);
+  EXPECT_EQ(2u, voice.numSamples);
+  EXPECT_GE(voice.maxUs, 5000u);
+  EXPECT_GE(voice.averageUs(), 5000u);
+  EXPECT_LT(voice.maxUs, 5000000u);
+
+  // every sampleInterval-th packet of a class
+  EXPECT_EQ(0u, q.delayStats(Queue::Realtime).numSamples);
+  EXPECT_EQ(0u, q.delayStats(Queue::Bulk).numSamples);
+
+  q.resetDelayStats();
+  EXPECT_EQ(0u, q.delayStats(Queue::ChannelVoice).numSamples);
+  EXPECT_EQ(0u, q.delayStats(Queue::ChannelVoice).maxUs);
+}
+
+TEST(PrioritySendQueue, overrun)
+{
+  Queue q;
+
+  for (unsigned i = 0; i < 100; ++i)
+    q.write(midi::universal_packet{ 0x20903C00 | i });
+
+  // lapped, continues with the packets written after the overrun
+  EXPECT_TRUE(drain(q).empty());
+  EXPECT_EQ(100u, q.takeDropped());
+  EXPECT_EQ(0u, q.takeDropped());
+
+  q.write(midi::universal_packet{ 0x20903C64 });
+  EXPECT_EQ((std::vector<uint32_t>{ 0x20903C64 }), drain(q));
+}
+
+TEST(PrioritySendQueue, sysex_per_group)
+{
+  Queue q;
+  midi::universal_packet p;
+
+  // a SysEx message half sent on group 1
+  q.write(midi::universal_packet{ 0x31160102, 0x03040506 });
+  EXPECT_TRUE(q.read(p, 1000));
+
+  // holds back channel voice of its group only
+  q.write(midi::universal_packet{ 0x23903C64 });
+  EXPECT_TRUE(q.read(p, 1000));
+  EXPECT_EQ(0x23903C64, p.data[0]);
+
+  q.write(midi::universal_packet{ 0x21903C64 });
+  EXPECT_FALSE(q.peek(p, 1000));
+
+  // giving it up discards the rest of the group 1 message only
+  q.write(midi::universal_packet{ 0x33160102, 0x03040506 });
+  EXPECT_TRUE(q.read(p, 1000));
+  EXPECT_EQ(0x33160102, p.data[0]);
+  EXPECT_TRUE(q.read(p, 1000 + Queue::sysexStallUs));
+  EXPECT_EQ(0x21903C64, p.data[0]);
+
+  q.write(midi::universal_packet{ 0x3126070A, 0x0B0C0D0E });
+  q.write(midi::universal_packet{ 0x33310D00 });
+  q.write(midi::universal_packet{ 0x31310D00 });
+  EXPECT_EQ((std::vector<uint32_t>{ 0x33310D00 }), drain(q, 1000 + Queue::sysexStallUs));
+}
@@ -0,0 +1,125 @@
+#include "../ProfileRegistry.h"
+
+#include <gtest/gtest.h>
+
+//-----------------------------------------------
+
+static constexpr ProfileRegistry::ProfileId drawbar { 0x7E, 0x21, 0x01, 0x01, 0x02 };
+static constexpr ProfileRegistry::ProfileId other { 0x7E, 0x61, 0x00, 0x01, 0x01 };
+
+static bool dropNotes(midi::universal_packet &p)
+{
+  const uint8_t status = (p.data[0] >> 20) & 0x0F;
+  return (status != 0x8) && (status != 0x9);
+}
+
+static bool fixedVelocity(midi::universal_packet &p)
+{
+  if (((p.data[0] >> 20) & 0x0F) == 0x9)
+    p.data[0] = (p.data[0] & 0xFFFFFF00) | 0x64;
+  return true;
+}
+
+//-----------------------------------------------
+
+TEST(ProfileRegistry, targets)
+{
+  ProfileRegistry r;
+  EXPECT_EQ(0, r.add(drawbar, 0, 0x0003, false));
+  EXPECT_EQ(1, r.add(other, 1, 0, true));
+
+  EXPECT_EQ(0, r.find(drawbar, 0, 1));
+  EXPECT_EQ(-1, r.find(drawbar, 0, 2));
+  EXPECT_EQ(-1, r.find(drawbar, 0, ProfileRegistry::groupTarget));
+  EXPECT_EQ(-1, r.find(drawbar, 1, 0));
+  EXPECT_EQ(1, r.find(other, 1, ProfileRegistry::groupTarget));
+  EXPECT_EQ(-1, r.find(other, 1, 0));
+
+  EXPECT_TRUE(r.supportsGroup(0));
+  EXPECT_TRUE(r.supportsGroup(1));
+  EXPECT_FALSE(r.supportsGroup(2));
+
+  unsigned n = 0;
+  r.forEach(0, 1, [&n](uint8_t index, const ProfileRegistry::Profile &p) {
+    EXPECT_EQ(0u, index);
+    EXPECT_EQ(drawbar, p.id);
+    ++n;
+  });
+  EXPECT_EQ(1u, n);
+}
+
+TEST(ProfileRegistry, enable_disable)
+{
+  ProfileRegistry r;
+  r.add(drawbar, 0, 0x0001, false);
+  r.add(other, 0, 0, true);
+
+  EXPECT_FALSE(r.enable(drawbar, 0, 1)); // not supported on channel 2
+  EXPECT_EQ(0u, r.active(0, 0));
+
+  EXPECT_TRUE(r.enable(drawbar, 0, 0));
+  EXPECT_TRUE(r.isEnabled(0, 0, 0));
+  EXPECT_EQ(0x01u, r.active(0, 0));
+  EXPECT_EQ(0x00u, r.active(0, 1));
+
+  // group wide profiles apply to all channels
+  EXPECT_TRUE(r.enable(other, 0, ProfileRegistry::groupTarget));
+  EXPECT_EQ(0x03u, r.active(0, 0));
+  EXPECT_EQ(0x02u, r.active(0, 15));
+  EXPECT_EQ(0x00u, r.active(1, 0));
+
+  EXPECT_TRUE(r.disable(drawbar, 0, 0));
+  EXPECT_FALSE(r.isEnabled(0, 0, 0));
+  EXPECT_EQ(0x02u, r.active(0, 0));
+
+  r.reset();
+  EXPECT_EQ(0x00u, r.active(0, 0));
+}
+
+TEST(ProfileRegistry, capacity)
+{
+  ProfileRegistry r;
+  for (uint8_t i = 0; i < ProfileRegistry::maxProfiles; ++i)
+    EXPECT_EQ(int(i), r.add(ProfileRegistry::ProfileId{ 0x7E, i, 0, 1, 1 }, 0, ProfileRegistry::allChannels, false));
+  EXPECT_EQ(-1, r.add(drawbar, 0, ProfileRegistry::allChannels, false));
+  EXPECT_EQ(ProfileRegistry::maxProfiles, r.size());
+}
+
+TEST(ProfileRegistry, filter)
+{
+  ProfileRegistry r;
+  r.add(drawbar, 0, ProfileRegistry::allChannels, false, dropNotes);
+  r.add(other, 0, ProfileRegistry::allChannels, false, fixedVelocity);
+  r.add(ProfileRegistry::ProfileId{ 0x7E, 0x40, 0, 1, 1 }, 0, ProfileRegistry::allChannels, false);
+
+  midi::universal_packet noteOn { 0x20923C20 };
+  midi::universal_packet cc { 0x20B20740 };
+  const midi::universal_packet sysex { 0x30010000 };
+
+  // nothing enabled: untouched
+  EXPECT_TRUE(r.filter(noteOn));
+  EXPECT_EQ(0x20923C20u, noteOn.data[0]);
+
+  // profiles without filter do not affect packets
+  EXPECT_TRUE(r.enable(ProfileRegistry::ProfileId{ 0x7E, 0x40, 0, 1, 1 }, 0, 2));
+  EXPECT_TRUE(r.filter(noteOn));
+  EXPECT_EQ(0x20923C20u, noteOn.data[0]);
+
+  r.enable(other, 0, 2);
+  EXPECT_TRUE(r.filter(noteOn));
+  EXPECT_EQ(0x20923C64u, noteOn.data[0]);
+
+  // other channels are not affected
+  midi::universal_packet noteOnCh1 { 0x20903C20 };
+  EXPECT_TRUE(r.filter(noteOnCh1));
+  EXPECT_EQ(0x20903C20u, noteOnCh1.data[0]);
+
+  r.enable(drawbar, 0, 2);
+  EXPECT_FALSE(r.filter(noteOn));
+  EXPECT_TRUE(r.filter(cc));
+
+  // only channel voice messages are filtered
+  midi::universal_packet p = sysex;
+  EXPECT_TRUE(r.filter(p));
+  EXPECT_EQ(sysex, p);
+}
@@ -0,0 +1,98 @@
+#include "../ProtocolTranslator.h"
+
+#include <gtest/gtest.h>
+
+//-----------------------------------------------
+
+TEST(ProtocolTranslator, scaling)
+{
+  EXPECT_EQ(0x0000u, scaling::scale7To16(0));
+  EXPECT_EQ(0x8000u, scaling::scale7To16(64));
+  EXPECT_EQ(0xFFFFu, scaling::scale7To16(127));
+  EXPECT_EQ(0x00000000u, scaling::scale7To32(0));
+  EXPECT_EQ(0x80000000u, scaling::scale7To32(64));
+  EXPECT_EQ(0xFFFFFFFFu, scaling::scale7To32(127));
+  EXPECT_EQ(0x80000000u, scaling::scale14To32(0x2000));
+  EXPECT_EQ(0xFFFFFFFFu, scaling::scale14To32(0x3FFF));
+
+  // round trips
+  for (uint8_t v=0; v<128; ++v)
+  {
+    EXPECT_EQ(v, scaling::scale16To7(scaling::scale7To16(v)));
+    EXPECT_EQ(v, scaling::scale32To7(scaling::scale7To32(v)));
+  }
+  for (uint16_t v=0; v<0x4000; ++v)
+    EXPECT_EQ(v, scaling::scale32To14(scaling::scale14To32(v)));
+}
+
+TEST(ProtocolTranslator, to_midi2)
+{
+  ProtocolTranslator t;
+  midi::universal_packet out[ProtocolTranslator::maxPackets];
+
+  // note on / off
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x23923C40 }, out));
+  EXPECT_EQ(midi::universal_packet(0x43923C00, 0x80000000), out[0]);
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x23923C00 }, out));
+  EXPECT_EQ(midi::universal_packet(0x43823C00, 0x80000000), out[0]);
+
+  // pitch bend center
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x20E50040 }, out));
+  EXPECT_EQ(midi::universal_packet(0x40E50000, 0x80000000), out[0]);
+
+  // bank select is sent with program change
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B00001 }, out));
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B02002 }, out));
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x20C00500 }, out));
+  EXPECT_EQ(midi::universal_packet(0x40C00001, 0x05000102), out[0]);
+
+  // RPN pitch bend sensitivity
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B16500 }, out));
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B16400 }, out));
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x20B1060C }, out));
+  EXPECT_EQ(midi::universal_packet(0x40210000, scaling::scale14To32(0x0C << 7)), out[0]);
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x20B12632 }, out));
+  EXPECT_EQ(midi::universal_packet(0x40210000, scaling::scale14To32((0x0C << 7) | 0x32)), out[0]);
+
+  // RPN null
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B1657F }, out));
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B1647F }, out));
+  EXPECT_EQ(0, t.toMIDI2(midi::universal_packet{ 0x20B10601 }, out));
+
+  // data entry without parameter is a plain controller
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x20B20601 }, out));
+  EXPECT_EQ(midi::universal_packet(0x40B20600, scaling::scale7To32(1)), out[0]);
+
+  // other packets pass
+  EXPECT_EQ(1, t.toMIDI2(midi::universal_packet{ 0x10F80000 }, out));
+  EXPECT_EQ(midi::universal_packet(0x10F80000), out[0]);
+}
+
+TEST(ProtocolTranslator, to_midi1)
+{
+  midi::universal_packet out[ProtocolTranslator::maxPackets];
+
+  EXPECT_EQ(1, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x41903C00, 0x80000000 }, out));
+  EXPECT_EQ(midi::universal_packet(0x21903C40), out[0]);
+
+  // note on velocity never becomes 0
+  EXPECT_EQ(1, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x41903C00, 0x00100000 }, out));
+  EXPECT_EQ(midi::universal_packet(0x21903C01), out[0]);
+
+  EXPECT_EQ(1, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x40E50000, 0x80000000 }, out));
+  EXPECT_EQ(midi::universal_packet(0x20E50040), out[0]);
+
+  EXPECT_EQ(3, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x40C00001, 0x05000102 }, out));
+  EXPECT_EQ(midi::universal_packet(0x20B00001), out[0]);
+  EXPECT_EQ(midi::universal_packet(0x20B02002), out[1]);
+  EXPECT_EQ(midi::universal_packet(0x20C00500), out[2]);
+
+  EXPECT_EQ(4, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x40310102, 0xFFFFFFFF }, out));
+  EXPECT_EQ(midi::universal_packet(0x20B16301), out[0]);
+  EXPECT_EQ(midi::universal_packet(0x20B16202), out[1]);
+  EXPECT_EQ(midi::universal_packet(0x20B1067F), out[2]);
+  EXPECT_EQ(midi::universal_packet(0x20B1267F), out[3]);
+
+  // per note messages are dropped
+  EXPECT_EQ(0, ProtocolTranslator::toMIDI1(midi::universal_packet{ 0x40603C00, 0x80000000 }, out));
+}
@@ -0,0 +1,137 @@
+#include "../RunningStatusEncoder.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+//-----------------------------------------------
+
+using bytes = std::vector<uint8_t>;
+
+static bytes encode(RunningStatusEncoder &e, uint32_t w0, uint32_t w1 = 0, uint32_t now = 0)
+{
+  uint8_t bs[RunningStatusEncoder::maxBytes];
+  const uint8_t n = e.encode(midi::universal_packet{ w0, w1 }, bs, now);
+  return bytes(bs, bs + n);
+}
+
+//-----------------------------------------------
+
+TEST(RunningStatusEncoder, channel_voice)
+{
+  RunningStatusEncoder e;
+
+  EXPECT_EQ((bytes{ 0x90, 0x3C, 0x64 }), encode(e, 0x21903C64));
+  EXPECT_EQ((bytes{ 0x3E, 0x64 }), encode(e, 0x21903E64));
+  EXPECT_EQ((bytes{ 0x3C, 0x00 }), encode(e, 0x21903C00));
+  EXPECT_EQ((bytes{ 0x80, 0x3E, 0x00 }), encode(e, 0x21803E00));
+  EXPECT_EQ((bytes{ 0x91, 0x3C, 0x64 }), encode(e, 0x21913C64));
+
+  // two byte messages
+  EXPECT_EQ((bytes{ 0xC1, 0x05 }), encode(e, 0x21C10500));
+  EXPECT_EQ((bytes{ 0x06 }), encode(e, 0x21C10600));
+  EXPECT_EQ((bytes{ 0xD1, 0x40 }), encode(e, 0x21D14000));
+}
+
+TEST(RunningStatusEncoder, system_messages)
+{
+  RunningStatusEncoder e;
+
+  EXPECT_EQ((bytes{ 0xB0, 0x07, 0x7F }), encode(e, 0x20B0077F));
+
+  // real time keeps running status
+  EXPECT_EQ((bytes{ 0xF8 }), encode(e, 0x10F80000));
+  EXPECT_EQ((bytes{ 0x07, 0x70 }), encode(e, 0x20B00770));
+
+  // system common cancels it
+  EXPECT_EQ((bytes{ 0xF2, 0x10, 0x02 }), encode(e, 0x10F21002));
+  EXPECT_EQ((bytes{ 0xB0, 0x07, 0x60 }), encode(e, 0x20B00760));
+  EXPECT_EQ((bytes{ 0xF1, 0x21 }), encode(e, 0x10F12100));
+  EXPECT_EQ((bytes{ 0xF6 }), encode(e, 0x10F60000));
+  EXPECT_EQ((bytes{ 0xB0, 0x07, 0x50 }), encode(e, 0x20B00750));
+
+  e.reset();
+  EXPECT_EQ((bytes{ 0xB0, 0x07, 0x40 }), encode(e, 0x20B00740));
+}
+
+TEST(RunningStatusEncoder, sysex7)
+{
+  RunningStatusEncoder e;
+
+  EXPECT_EQ((bytes{ 0x90, 0x3C, 0x64 }), encode(e, 0x20903C64));
+
+  // F0 7E 7F 06 01 F7
+  EXPECT_EQ((bytes{ 0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7 }), encode(e, 0x30047E7F, 0x06010000));
+  EXPECT_EQ((bytes{ 0x90, 0x3C, 0x00 }), encode(e, 0x20903C00));
+
+  // start, continue, end
+  EXPECT_EQ((bytes{ 0xF0, 0x7D, 0x01, 0x02, 0x03, 0x04, 0x05 }), encode(e, 0x30167D01, 0x02030405));
+  EXPECT_EQ((bytes{ 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B }), encode(e, 0x30260607, 0x08090A0B));
+  EXPECT_EQ((bytes{ 0x0C, 0xF7 }), encode(e, 0x30310C00));
+}
+
+TEST(RunningStatusEncoder, ignored_packets)
+{
+  RunningStatusEncoder e;
+
+  EXPECT_TRUE(encode(e, 0x00000000).empty()); // NOOP
+  EXPECT_TRUE(encode(e, 0x40903C00, 0xFFFF0000).empty()); // MIDI 2.0 note on
+  EXPECT_TRUE(encode(e, 0x20003C00).empty()); // no status
+}
+
+TEST(RunningStatusEncoder, status_refresh)
+{
+  RunningStatusEncoder e { 1000 };
+
+  EXPECT_EQ((bytes{ 0xB0, 0x01, 0x10 }), encode(e, 0x20B00110, 0, 0));
+  EXPECT_EQ((bytes{ 0x01, 0x11 }), encode(e, 0x20B00111, 0, 500));
+  EXPECT_EQ((bytes{ 0x01, 0x12 }), encode(e, 0x20B00112, 0, 999));
+  EXPECT_EQ((bytes{ 0xB0, 0x01, 0x13 }), encode(e, 0x20B00113, 0, 1000));
+  EXPECT_EQ((bytes{ 0x01, 0x14 }), encode(e, 0x20B00114, 0, 1500));
+
+  // wraps with the microsecond counter
+  RunningStatusEncoder w { 1000 };
+  EXPECT_EQ((bytes{ 0xB0, 0x01, 0x10 }), encode(w, 0x20B00110, 0, 0xFFFFFF00));
+  EXPECT_EQ((bytes{ 0x01, 0x11 }), encode(w, 0x20B00111, 0, 0x00000100));
+  EXPECT_EQ((bytes{ 0xB0, 0x01, 0x12 }), encode(w, 0x20B00112, 0, 0x00000300));
+
+  // no refresh
+  RunningStatusEncoder n { 0 };
+  EXPECT_EQ((bytes{ 0xB0, 0x01, 0x10 }), encode(n, 0x20B00110, 0, 0));
+  EXPECT_EQ((bytes{ 0x01, 0x11 }), encode(n, 0x20B00111, 0, 100000000));
+}
+
+TEST(RunningStatusEncoder, active_sensing)
+{
+  uint8_t fe = 0;
+
+  RunningStatusEncoder off;
+  EXPECT_EQ(UINT32_MAX, off.untilIdle(0));
+  EXPECT_EQ(0, off.idle(&fe, 1000000));
+
+  RunningStatusEncoder e { RunningStatusEncoder::defaultStatusRefreshUs, 300 };
+  EXPECT_EQ((bytes{ 0xF8 }), encode(e, 0x10F80000, 0, 1000));
+  EXPECT_EQ(300u, e.untilIdle(1000));
+  EXPECT_EQ(100u, e.untilIdle(1200));
+  EXPECT_EQ(0, e.idle(&fe, 1200));
+
+  EXPECT_EQ(0u, e.untilIdle(1300));
+  EXPECT_EQ(1, e.idle(&fe, 1300));
+  EXPECT_EQ(0xFE, fe);
+  EXPECT_EQ(300u, e.untilIdle(1300));
+
+  // any output restarts the interval, active sensing keeps running status
+  EXPECT_EQ((bytes{ 0x90, 0x3C, 0x64 }), encode(e, 0x20903C64, 0, 1500));
+  EXPECT_EQ(0, e.idle(&fe, 1700));
+  EXPECT_EQ(1, e.idle(&fe, 1800));
+  EXPECT_EQ((bytes{ 0x3C, 0x00 }), encode(e, 0x20903C00, 0, 1900));
+}
+
+TEST(RunningStatusEncoder, is_realtime)
+{
+  EXPECT_TRUE(RunningStatusEncoder::isRealtime(midi::universal_packet{ 0x10F80000 }));
+  EXPECT_TRUE(RunningStatusEncoder::isRealtime(midi::universal_packet{ 0x13FC0000 }));
+  EXPECT_FALSE(RunningStatusEncoder::isRealtime(midi::universal_packet{ 0x10F21002 }));
+  EXPECT_FALSE(RunningStatusEncoder::isRealtime(midi::universal_packet{ 0x20903C64 }));
+  EXPECT_FALSE(RunningStatusEncoder::isRealtime(midi::universal_packet{ 0x30047E7F, 0x06010000 }));
+}
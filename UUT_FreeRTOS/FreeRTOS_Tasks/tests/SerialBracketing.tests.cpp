@@ -0,0 +1,158 @@
+#include "../SerialBracketing.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+//-----------------------------------------------
+
+static std::vector<uint8_t> encodeAll(const std::vector<midi::universal_packet> &packets)
+{
+  std::vector<uint8_t> bytes;
+  for (const auto &p : packets)
+  {
+    uint8_t buffer[32];
+    const uint8_t n = SerialBracketing::encode(p, buffer);
+    bytes.insert(bytes.end(), buffer, buffer + n);
+  }
+  return bytes;
+}
+
+static const std::vector<midi::universal_packet> testPackets {
+  midi::universal_packet{ 0x20903C64 },
+  midi::universal_packet{ 0x20803C00 },
+  midi::universal_packet{ 0x00000000 },
+  midi::universal_packet{ 0x10F80000 },
+  midi::universal_packet{ 0x40903C00, 0xFFFF0000 },
+  midi::universal_packet{ 0x30167E7F, 0x0D700201 },
+  midi::universal_packet{ 0x50010000, 0x00000000, 0x01020304, 0x00000005 },
+  midi::universal_packet{ 0xF0010101, 0x01010101, 0x01010101, 0x01010101 },
+  midi::universal_packet{ 0xD0100101, 0x02020202, 0x03030303, 0x04040404 },
+};
+
+//-----------------------------------------------
+
+TEST(SerialBracketing, bulk_decode)
+{
+  const auto bytes = encodeAll(testPackets);
+
+  SerialBracketing decoder;
+  midi::universal_packet packets[16];
+  size_t numPackets = 0;
+  EXPECT_EQ(bytes.size(), decoder.feed(bytes.data(), bytes.size(), packets, 16, numPackets));
+
+  ASSERT_EQ(testPackets.size(), numPackets);
+  for (size_t i = 0; i < numPackets; ++i)
+    EXPECT_EQ(testPackets[i], packets[i]) << i;
+  EXPECT_EQ(0u, decoder.takeErrors());
+}
+
+TEST(SerialBracketing, split_input)
+{
+  const auto bytes = encodeAll(testPackets);
+
+  // every chunk size, the output limited to one packet per call
+  for (size_t chunk = 1; chunk <= bytes.size(); ++chunk)
+  {
+    SerialBracketing decoder;
+    std::vector<midi::universal_packet> decoded;
+    for (size_t pos = 0; pos < bytes.size(); pos += chunk)
+    {
+      const size_t n = std::min(chunk, bytes.size() - pos);
+      size_t consumed = 0;
+      while (consumed < n)
+      {
+        midi::universal_packet p;
+        size_t numPackets = 0;
+        consumed += decoder.feed(bytes.data() + pos + consumed, n - consumed, &p, 1, numPackets);
+        if (numPackets)
+          decoded.push_back(p);
+      }
+    }
+    EXPECT_EQ(testPackets, decoded) << chunk;
+  }
+}
+
+TEST(SerialBracketing, byte_feed)
+{
+  const auto bytes = encodeAll(testPackets);
+
+  SerialBracketing decoder;
+  std::vector<midi::universal_packet> decoded;
+  for (const uint8_t b : bytes)
+  {
+    if (decoder.feed(b) == SerialBracketing::SUCCESS)
+      decoded.push_back(decoder.ump);
+  }
+  EXPECT_EQ(testPackets, decoded);
+}
+
+TEST(SerialBracketing, long_blocks)
+{
+  // 100 packets without zero bytes in one frame, blocks of 254 data bytes
+  std::vector<midi::universal_packet> packets;
+  std::vector<uint8_t> data;
+  for (uint32_t i = 0; i < 100; ++i)
+  {
+    packets.push_back(midi::universal_packet{ 0x20903C01 + i });
+    for (unsigned b = 0; b < 4; ++b)
+      data.push_back(uint8_t(packets.back().data[0] >> (24 - 8 * b)));
+  }
+
+  std::vector<uint8_t> frame;
+  for (size_t pos = 0; pos < data.size(); pos += 254)
+  {
+    const size_t n = std::min<size_t>(254, data.size() - pos);
+    frame.push_back(uint8_t((n == 254) ? 0xFF : n + 1));
+    frame.insert(frame.end(), data.begin() + pos, data.begin() + pos + n);
+  }
+  frame.push_back(0);
+
+  SerialBracketing decoder;
+  midi::universal_packet decoded[100];
+  size_t numPackets = 0;
+  // the output is full with the last packet, the delimiter behind it is consumed nonetheless
+  EXPECT_EQ(frame.size(), decoder.feed(frame.data(), frame.size(), decoded, 100, numPackets));
+  ASSERT_EQ(100u, numPackets);
+  for (size_t i = 0; i < packets.size(); ++i)
+    EXPECT_EQ(packets[i], decoded[i]) << i;
+  EXPECT_EQ(0u, decoder.takeErrors());
+}
+
+TEST(SerialBracketing, output_full)
+{
+  const auto bytes = encodeAll(testPackets);
+
+  SerialBracketing decoder;
+  midi::universal_packet packets[2];
+  size_t numPackets = 0;
+
+  // stops in front of the third packet
+  const size_t consumed = decoder.feed(bytes.data(), bytes.size(), packets, 2, numPackets);
+  EXPECT_EQ(2u, numPackets);
+  EXPECT_EQ(12u, consumed); // 05 20 90 3C 64 00, 04 20 80 3C 01 00
+  EXPECT_EQ(testPackets[1], packets[1]);
+
+  EXPECT_EQ(0u, decoder.feed(bytes.data() + consumed, bytes.size() - consumed, packets, 0, numPackets));
+  decoder.feed(bytes.data() + consumed, bytes.size() - consumed, packets, 1, numPackets);
+  ASSERT_EQ(1u, numPackets);
+  EXPECT_EQ(testPackets[2], packets[0]);
+}
+
+TEST(SerialBracketing, broken_frames)
+{
+  SerialBracketing decoder;
+  midi::universal_packet packets[4];
+  size_t numPackets = 0;
+
+  // truncated MIDI 2.0 note on, partial word, then a note on
+  const uint8_t bytes[] = { 0x05, 0x40, 0x90, 0x3C, 0x01, 0x00,
+                            0x03, 0xFF, 0xFF, 0x00,
+                            0x05, 0x20, 0x90, 0x3C, 0x64, 0x00 };
+  EXPECT_EQ(sizeof(bytes), decoder.feed(bytes, sizeof(bytes), packets, 4, numPackets));
+  ASSERT_EQ(1u, numPackets);
+  EXPECT_EQ(midi::universal_packet{ 0x20903C64 }, packets[0]);
+  EXPECT_EQ(2u, decoder.takeErrors());
+  EXPECT_EQ(0u, decoder.takeErrors());
+}
@@ -0,0 +1,104 @@
+#include "SimulatedEndpoint.h"
+
+#include "../DINSerialTask.h"
+#include "../PicoMainTask.h"
+#include "../UMPSources.h"
+
+//-----------------------------------------------
+// board buffers, defined by the FreeRTOS tasks on the RP2040
+
+PrioritySendQueue<dinSendQueueCapacity> DINPortSendBuffers[numDINPorts];
+UMPRingBuffer<1024> DINPortReceiveBuffer;
+UMPRingBuffer<128> ControlMessageBuffer;
+
+static const uint8_t dinSource = umpSources.add(DINPortReceiveBuffer, "DIN Serial In", midi::protocol::midi1);
+static const uint8_t controlSource = umpSources.add(ControlMessageBuffer, "Control", midi::protocol::midi2);
+
+//-----------------------------------------------
+
+SimulatedEndpoint *SimulatedEndpoint::current = nullptr;
+
+SimulatedEndpoint::SimulatedEndpoint(std::string_view name) :
+  processing(name, sendPacket, sendWords)
+{
+  current = this;
+}
+
+SimulatedEndpoint::~SimulatedEndpoint()
+{
+  if (current == this)
+    current = nullptr;
+}
+
+void SimulatedEndpoint::sendPacket(const midi::universal_packet &p)
+{
+  if (!current)
+    return;
+
+  ++current->numSentPackets;
+  if (current->recording)
+    current->sent.push_back(p);
+}
+
+size_t SimulatedEndpoint::sendWords(const uint32_t *words, size_t numWords)
+{
+  size_t sent = 0;
+  while (current && (sent < numWords))
+  {
+    midi::universal_packet p { words[sent] };
+    const size_t size = p.size();
+    if ((sent + size > numWords) || (size > current->sinkWords))
+      break;
+    for (size_t w = 1; w < size; ++w)
+      p.data[w] = words[sent + w];
+
+    current->sinkWords -= size;
+    sendPacket(p);
+    sent += size;
+  }
+  return sent;
+}
+
+void SimulatedEndpoint::receiveSysex7(midi::group_t group, const std::vector<uint8_t> &bytes)
+{
+  const size_t numPackets = bytes.size() ? (bytes.size() + 5) / 6 : 1;
+  for (size_t p = 0; p < numPackets; ++p)
+  {
+    const size_t first = 6 * p;
+    const size_t count = (bytes.size() - first < 6) ? bytes.size() - first : 6;
+    const uint32_t status = (numPackets == 1) ? 0x0 : (p == 0) ? 0x1 : (p + 1 < numPackets) ? 0x2 : 0x3;
+
+    uint8_t b[6] {};
+    for (size_t i = 0; i < count; ++i)
+      b[i] = bytes[first + i];
+
+    receive(midi::universal_packet{
+      0x30000000u | (uint32_t(group & 0x0F) << 24) | (status << 20) | (uint32_t(count) << 16) | (b[0] << 8) | b[1],
+      (uint32_t(b[2]) << 24) | (b[3] << 16) | (b[4] << 8) | b[5] });
+  }
+}
+
+std::vector<std::vector<uint8_t>> SimulatedEndpoint::sentSysex7() const
+{
+  std::vector<std::vector<uint8_t>> messages;
+  std::vector<uint8_t> message;
+
+  for (const auto &p : sent)
+  {
+    if (p.type() != midi::packet_type::data)
+      continue;
+
+    const uint8_t status = (p.data[0] >> 20) & 0x0F;
+    const uint8_t count = (p.data[0] >> 16) & 0x0F;
+    if ((status == 0x0) || (status == 0x1))
+      message.clear();
+
+    for (uint8_t i = 0; (i < count) && (i < 6); ++i)
+      message.push_back((i < 2) ? (p.data[0] >> (8 - 8 * i)) & 0x7F : (p.data[1] >> (40 - 8 * i)) & 0x7F);
+
+    if ((status == 0x0) || (status == 0x3))
+      messages.push_back(message);
+  }
+
+  return messages;
+}
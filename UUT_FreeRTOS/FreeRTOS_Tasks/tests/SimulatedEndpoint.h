@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../UMPProcessing.h"
+
+#include <midi/universal_packet.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//-----------------------------------------------
+//! UMPProcessing endpoint with an in-memory transport
+/***
+ *
+ * Host builds replace the USB / serial transports with a sendPacket
+ * which records (or only counts) everything the endpoint sends. The board
+ * side buffers (DIN, controls) are defined by SimulatedEndpoint.cpp instead
+ * of the FreeRTOS tasks, so tests and the replay driver can inject packets
+ * as if they came from the DIN port, and read what was routed to it.
+ *
+ * sendPacketProc is a plain function, so one endpoint is active at a time:
+ * the most recently constructed one.
+ *
+ ***/
+class SimulatedEndpoint
+{
+public:
+  explicit SimulatedEndpoint(std::string_view name = "ProtoZOA Simulated");
+  ~SimulatedEndpoint();
+
+  //! a packet from the host
+  void receive(const midi::universal_packet &p) { processing.process(p); }
+  //! a complete SysEx7 message from the host, bytes without F0 / F7
+  void receiveSysex7(midi::group_t, const std::vector<uint8_t> &bytes);
+  //! forward the packets pending in the board buffers
+  void sendPending() { processing.sendPendingUMPs(); }
+
+  //! keep the sent packets, otherwise they are only counted
+  bool recording { true };
+  std::vector<midi::universal_packet> sent;
+  size_t numSentPackets { 0 };
+  //! words sendWords accepts before the simulated USB FIFO is full
+  size_t sinkWords { SIZE_MAX };
+
+  //! payloads (without F0 / F7) of the complete SysEx7 messages in sent
+  std::vector<std::vector<uint8_t>> sentSysex7() const;
+
+  UMPProcessing processing;
+
+private:
+  static void sendPacket(const midi::universal_packet&);
+  static size_t sendWords(const uint32_t *words, size_t numWords);
+
+  static SimulatedEndpoint *current;
+};
+
+//-----------------------------------------------
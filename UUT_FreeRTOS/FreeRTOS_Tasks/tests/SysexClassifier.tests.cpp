@@ -0,0 +1,68 @@
+#include "../SysexClassifier.h"
+
+#include <gtest/gtest.h>
+
+//-----------------------------------------------
+
+static constexpr uint8_t mainClasses =
+  SysexClassifier::CapabilityInquiry | SysexClassifier::IdentityRequest | SysexClassifier::OwnManufacturer;
+
+//-----------------------------------------------
+
+TEST(SysexClassifier, classify)
+{
+  const SysexClassifier c { mainClasses, 0x7D };
+
+  // F0 7E 7F 0D 70 02 ... (MIDI-CI discovery)
+  EXPECT_EQ(SysexClassifier::CapabilityInquiry, c.classify(midi::universal_packet{ 0x30167E7F, 0x0D700201 }));
+  // F0 7E 7F 06 01 F7 (identity request)
+  EXPECT_EQ(SysexClassifier::IdentityRequest, c.classify(midi::universal_packet{ 0x30047E7F, 0x06010000 }));
+  // F0 7E 7F 06 02 ... (identity reply of another device)
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30167E7F, 0x06020000 }));
+  // F0 7E 00 01 ... (sample dump header)
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30167E00, 0x01000000 }));
+  // F0 7F 7F 0D ... (realtime, not MIDI-CI)
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30167F7F, 0x0D000000 }));
+  // F0 7D 02 ... (our routing configuration)
+  EXPECT_EQ(SysexClassifier::OwnManufacturer, c.classify(midi::universal_packet{ 0x30037D02, 0x00000000 }));
+  // F0 00 20 33 ... (other manufacturer)
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30160020, 0x33000000 }));
+
+  // too short to tell
+  EXPECT_EQ(SysexClassifier::Undetermined, c.classify(midi::universal_packet{ 0x30127E7F, 0 }));
+  EXPECT_EQ(SysexClassifier::Undetermined, c.classify(midi::universal_packet{ 0x30137E7F, 0x06000000 }));
+}
+
+TEST(SysexClassifier, three_byte_manufacturer_id)
+{
+  const SysexClassifier c { SysexClassifier::OwnManufacturer, 0x002133 };
+
+  EXPECT_EQ(SysexClassifier::OwnManufacturer, c.classify(midi::universal_packet{ 0x30160021, 0x33010000 }));
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30160021, 0x34010000 }));
+  EXPECT_EQ(SysexClassifier::Foreign, c.classify(midi::universal_packet{ 0x30167D01, 0x00000000 }));
+  EXPECT_EQ(SysexClassifier::Undetermined, c.classify(midi::universal_packet{ 0x30120021, 0 }));
+}
+
+TEST(SysexClassifier, stream)
+{
+  SysexClassifier c { SysexClassifier::CapabilityInquiry, 0x7D };
+
+  // a long foreign message is never collected
+  EXPECT_FALSE(c.collect(midi::universal_packet{ 0x30160020, 0x33000000 }));
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_FALSE(c.collect(midi::universal_packet{ 0x30260102, 0x03040506 }));
+  EXPECT_FALSE(c.collect(midi::universal_packet{ 0x30310000, 0 }));
+
+  // a MIDI-CI message is collected up to its end
+  EXPECT_TRUE(c.collect(midi::universal_packet{ 0x30167E7F, 0x0D700201 }));
+  EXPECT_TRUE(c.collecting());
+  EXPECT_TRUE(c.collect(midi::universal_packet{ 0x30260102, 0x03040506 }));
+  EXPECT_TRUE(c.collect(midi::universal_packet{ 0x30310000, 0 }));
+
+  // identity requests are not collected here
+  EXPECT_FALSE(c.collect(midi::universal_packet{ 0x30047E7F, 0x06010000 }));
+
+  // undetermined messages are collected
+  EXPECT_TRUE(c.collect(midi::universal_packet{ 0x30117E00, 0 }));
+  EXPECT_TRUE(c.collect(midi::universal_packet{ 0x30360000, 0 }));
+}
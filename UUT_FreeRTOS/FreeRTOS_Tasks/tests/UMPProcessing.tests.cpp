@@ -0,0 +1,200 @@
+#include "SimulatedEndpoint.h"
+
+#include "../Board.h"
+#include "../DINSerialTask.h"
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <vector>
+
+//-----------------------------------------------
+
+static constexpr uint32_t hostMUID { 0x0123456 };
+static constexpr uint32_t broadcastMUID { 0x0FFFFFFF };
+
+static void appendMUID(std::vector<uint8_t> &bytes, uint32_t muid)
+{
+  for (int i = 0; i < 4; ++i, muid >>= 7)
+    bytes.push_back(muid & 0x7F);
+}
+
+static uint32_t readMUID(const std::vector<uint8_t> &bytes, size_t index)
+{
+  return bytes[index] | (bytes[index + 1] << 7) | (bytes[index + 2] << 14) | (uint32_t(bytes[index + 3]) << 21);
+}
+
+static std::vector<uint8_t> ciMessage(uint8_t deviceId, uint8_t subtype, uint32_t destination, std::vector<uint8_t> body = {})
+{
+  std::vector<uint8_t> bytes { 0x7E, deviceId, 0x0D, subtype, 0x02 };
+  appendMUID(bytes, hostMUID);
+  appendMUID(bytes, destination);
+  bytes.insert(bytes.end(), body.begin(), body.end());
+  return bytes;
+}
+
+static std::vector<uint8_t> discoveryInquiry()
+{
+  return ciMessage(0x7F, 0x70, broadcastMUID, {
+    0x00, 0x21, 0x09, 0, 0, 0, 0, 0, 0, 0, 0,  // identity
+    0x0E, 0, 4, 0, 0, 0                        // categories, max sysex size, output path
+  });
+}
+
+//-----------------------------------------------
+
+TEST(UMPProcessing, product_instance_id)
+{
+  board::setFakeIdString("0123456789ABCDEF");
+  SimulatedEndpoint endpoint;
+
+  // endpoint discovery, product instance id only
+  endpoint.receive(midi::universal_packet{ 0xF0000101, 0x00000008, 0, 0 });
+
+  ASSERT_FALSE(endpoint.sent.empty());
+  const auto &p = endpoint.sent.front();
+  EXPECT_EQ(0x004u, (p.data[0] >> 16) & 0x3FF);
+  EXPECT_EQ(uint32_t('0'), (p.data[0] >> 8) & 0xFF);
+  EXPECT_EQ(uint32_t('1'), p.data[0] & 0xFF);
+}
+
+TEST(UMPProcessing, ci_discovery)
+{
+  SimulatedEndpoint endpoint;
+  endpoint.receiveSysex7(0, discoveryInquiry());
+
+  const auto replies = endpoint.sentSysex7();
+  ASSERT_EQ(1u, replies.size());
+  const auto &reply = replies[0];
+  ASSERT_GE(reply.size(), 31u);
+  EXPECT_EQ(0x71, reply[3]);
+  EXPECT_EQ(hostMUID, readMUID(reply, 9));
+  EXPECT_EQ(0, reply[30]); // function block
+}
+
+TEST(UMPProcessing, invalidate_muid)
+{
+  SimulatedEndpoint endpoint;
+  endpoint.receiveSysex7(0, discoveryInquiry());
+  const uint32_t muid = readMUID(endpoint.sentSysex7().at(0), 5);
+
+  // the target MUID in the body is invalidated, not the sender
+  std::vector<uint8_t> otherDevice;
+  appendMUID(otherDevice, 0x0654321);
+  endpoint.receiveSysex7(0, ciMessage(0x7F, 0x7E, broadcastMUID, otherDevice));
+  endpoint.sent.clear();
+  endpoint.receiveSysex7(0, discoveryInquiry());
+  EXPECT_EQ(muid, readMUID(endpoint.sentSysex7().at(0), 5));
+
+  // ours, a new one is generated
+  std::vector<uint8_t> ours;
+  appendMUID(ours, muid);
+  endpoint.receiveSysex7(0, ciMessage(0x7F, 0x7E, broadcastMUID, ours));
+  endpoint.sent.clear();
+  endpoint.receiveSysex7(0, discoveryInquiry());
+  EXPECT_NE(muid, readMUID(endpoint.sentSysex7().at(0), 5));
+}
+
+TEST(UMPProcessing, foreign_sysex_passes)
+{
+  SimulatedEndpoint endpoint;
+
+  // a sample dump for another device is neither answered nor does it disturb MIDI-CI
+  std::vector<uint8_t> dump { 0x00, 0x20, 0x33, 0x01 };
+  for (unsigned i = 0; i < 2000; ++i)
+    dump.push_back(i & 0x7F);
+  endpoint.receiveSysex7(0, dump);
+  EXPECT_TRUE(endpoint.sentSysex7().empty());
+
+  endpoint.receiveSysex7(0, discoveryInquiry());
+  EXPECT_EQ(1u, endpoint.sentSysex7().size());
+}
+
+TEST(UMPProcessing, profiles)
+{
+  SimulatedEndpoint endpoint;
+  const std::vector<uint8_t> drawbar { 0x7E, 0x21, 0x01, 0x01, 0x02 };
+
+  // the device MUID is random, take it from the discovery reply
+  endpoint.receiveSysex7(0, discoveryInquiry());
+  const uint32_t deviceMUID = readMUID(endpoint.sentSysex7().at(0), 5);
+  endpoint.sent.clear();
+
+  // channel 1: the drawbar organ profile, disabled
+  endpoint.receiveSysex7(0, ciMessage(0x00, 0x20, deviceMUID));
+  auto replies = endpoint.sentSysex7();
+  ASSERT_EQ(1u, replies.size());
+  EXPECT_EQ(0x21, replies[0][3]);
+  const std::vector<uint8_t> disabled { 0, 0, 1, 0, 0x7E, 0x21, 0x01, 0x01, 0x02 };
+  EXPECT_EQ(disabled, std::vector<uint8_t>(replies[0].begin() + 13, replies[0].end()));
+  endpoint.sent.clear();
+
+  // set on, reported to all MUIDs
+  std::vector<uint8_t> setOn = drawbar;
+  setOn.insert(setOn.end(), { 1, 0 });
+  endpoint.receiveSysex7(0, ciMessage(0x00, 0x22, deviceMUID, setOn));
+  replies = endpoint.sentSysex7();
+  ASSERT_EQ(1u, replies.size());
+  EXPECT_EQ(0x24, replies[0][3]);
+  EXPECT_EQ(broadcastMUID, readMUID(replies[0], 9));
+  EXPECT_TRUE(endpoint.processing.profiles().isEnabled(0, 0, 0));
+  endpoint.sent.clear();
+
+  // not supported on channel 2
+  endpoint.receiveSysex7(0, ciMessage(0x01, 0x22, deviceMUID, setOn));
+  replies = endpoint.sentSysex7();
+  ASSERT_EQ(1u, replies.size());
+  EXPECT_EQ(0x7F, replies[0][3]);
+}
+
+TEST(UMPProcessing, full_sink_keeps_packets_pending)
+{
+  SimulatedEndpoint endpoint;
+  endpoint.sendPending();
+  endpoint.sent.clear();
+
+  for (uint32_t i = 0; i < 6; ++i)
+    DINPortReceiveBuffer.write(midi::universal_packet{ 0x20903C00 | i });
+  DINPortReceiveBuffer.write(midi::universal_packet{ 0x30160102, 0x03040506 });
+
+  // room for three packets, the rest waits for the next call
+  endpoint.sinkWords = 3;
+  endpoint.sendPending();
+  ASSERT_EQ(3u, endpoint.sent.size());
+
+  endpoint.sinkWords = SIZE_MAX;
+  endpoint.sendPending();
+  ASSERT_EQ(7u, endpoint.sent.size());
+  for (uint32_t i = 0; i < 6; ++i)
+    EXPECT_EQ(0x20903C00 | i, endpoint.sent[i].data[0]);
+  EXPECT_EQ(0x03040506u, endpoint.sent[6].data[1]);
+}
+
+TEST(UMPProcessing, jr_ingress_timestamps)
+{
+  SimulatedEndpoint endpoint;
+  endpoint.sendPending();
+  endpoint.processing.curExtensions = jr::transmit;
+  endpoint.sendPending(); // JR Clock
+  endpoint.sent.clear();
+
+  // each run of packets is preceded by the time it arrived at
+  JRIngressStamp stamp;
+  stamp.write(DINPortReceiveBuffer, midi::universal_packet{ 0x20903C64 }, 3200);
+  stamp.write(DINPortReceiveBuffer, midi::universal_packet{ 0x20803C00 }, 3200);
+  stamp.write(DINPortReceiveBuffer, midi::universal_packet{ 0x20B00700 }, 6400);
+  endpoint.sendPending();
+
+  const uint32_t expected[] = { 0x00200064, 0x20903C64, 0x20803C00, 0x002000C8, 0x20B00700 };
+  ASSERT_EQ(std::size(expected), endpoint.sent.size());
+  for (size_t i = 0; i < std::size(expected); ++i)
+    EXPECT_EQ(expected[i], endpoint.sent[i].data[0]);
+
+  // without Jitter Reduction the timestamps are skipped
+  endpoint.processing.curExtensions = 0;
+  endpoint.sent.clear();
+  stamp.write(DINPortReceiveBuffer, midi::universal_packet{ 0x20903C64 }, 9600);
+  endpoint.sendPending();
+  ASSERT_EQ(1u, endpoint.sent.size());
+  EXPECT_EQ(0x20903C64u, endpoint.sent[0].data[0]);
+}
@@ -0,0 +1,213 @@
+// Replays recorded UMP captures through the UMP stack at maximum speed
+//
+//   umpreplay [-n repeat] [-serial] capture...
+//
+// Captures are text files with one UMP per line, as hexadecimal words:
+//
+//   # MIDI-CI discovery on group 0
+//   30167E7F 0D700201
+//   din 20903C64
+//
+// Packets are fed to a SimulatedEndpoint as if they came from the host,
+// lines starting with "din" as if they came from the DIN port. With -serial
+// every packet takes a round trip through SerialBracketing (COBS) first, as
+// on the serial transports. Reported are packets per second and the number
+// of heap allocations per packet.
+
+#include "SimulatedEndpoint.h"
+
+#include "../DINSerialTask.h"
+#include "../SerialBracketing.h"
+#include "../dump_packet.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------
+// heap allocation counters
+
+static std::atomic<size_t> numAllocations { 0 };
+static std::atomic<size_t> numAllocatedBytes { 0 };
+
+void *operator new(std::size_t size)
+{
+  ++numAllocations;
+  numAllocatedBytes += size;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+//-----------------------------------------------
+
+struct CapturedPacket
+{
+  midi::universal_packet packet;
+  bool fromDIN;
+};
+
+static bool loadCapture(const char *path, std::vector<CapturedPacket> &capture)
+{
+  std::ifstream file { path };
+  if (!file)
+  {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+
+  std::string line;
+  for (unsigned lineNumber = 1; std::getline(file, line); ++lineNumber)
+  {
+    std::istringstream words { line.substr(0, line.find('#')) };
+    CapturedPacket c { {}, false };
+
+    std::string word;
+    size_t numWords = 0;
+    while (words >> word)
+    {
+      if ((numWords == 0) && (word == "din") && !c.fromDIN)
+      {
+        c.fromDIN = true;
+        continue;
+      }
+
+      char *end;
+      const unsigned long w = std::strtoul(word.c_str(), &end, 16);
+      if (*end || (numWords == 4))
+      {
+        fprintf(stderr, "%s:%u: invalid UMP\n", path, lineNumber);
+        return false;
+      }
+      c.packet.data[numWords++] = uint32_t(w);
+    }
+
+    if (!numWords)
+      continue;
+    if (numWords != c.packet.size())
+    {
+      fprintf(stderr, "%s:%u: %u words for a %u word UMP\n", path, lineNumber, unsigned(numWords), unsigned(c.packet.size()));
+      return false;
+    }
+    capture.push_back(c);
+  }
+
+  return true;
+}
+
+//! encode and decode p like the serial transports do
+static midi::universal_packet serialRoundTrip(const midi::universal_packet &p, SerialBracketing &decoder)
+{
+  uint8_t bytes[32];
+  const uint8_t numBytes = SerialBracketing::encode(p, bytes);
+
+  midi::universal_packet decoded;
+  size_t numPackets;
+  decoder.feed(bytes, numBytes, &decoded, 1, numPackets);
+  if (numPackets)
+    return decoded;
+
+  fprintf(stderr, "serial bracketing: UMP 0x%08x not decoded\n", p.data[0]);
+  return midi::universal_packet{};
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned repeat = 1;
+  bool serial = false;
+  std::vector<CapturedPacket> capture;
+
+  for (int a = 1; a < argc; ++a)
+  {
+    if (!strcmp(argv[a], "-n") && (a + 1 < argc))
+      repeat = unsigned(std::strtoul(argv[++a], nullptr, 10));
+    else if (!strcmp(argv[a], "-serial"))
+      serial = true;
+    else if (!loadCapture(argv[a], capture))
+      return 1;
+  }
+
+  if (capture.empty())
+  {
+    fprintf(stderr, "usage: %s [-n repeat] [-serial] capture...\n", argv[0]);
+    return 1;
+  }
+
+  SimulatedEndpoint endpoint;
+  endpoint.recording = false;
+  SerialBracketing decoder;
+  size_t numDINPackets = 0;
+  size_t numDINDropped = 0;
+  midi::universal_packet p;
+
+  const size_t allocationsBefore = numAllocations;
+  const size_t bytesBefore = numAllocatedBytes;
+  const auto start = std::chrono::steady_clock::now();
+
+  for (unsigned r = 0; r < repeat; ++r)
+  {
+    for (const auto &c : capture)
+    {
+      const midi::universal_packet &in = serial ? (p = serialRoundTrip(c.packet, decoder)) : c.packet;
+      if (c.fromDIN)
+        DINPortReceiveBuffer.write(in);
+      else
+        endpoint.receive(in);
+
+      endpoint.sendPending();
+      for (auto &queue : DINPortSendBuffers)
+      {
+        while (queue.read(p, board::timeUs()))
+          ++numDINPackets;
+        numDINDropped += queue.takeDropped();
+      }
+    }
+  }
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const size_t numPackets = capture.size() * repeat;
+  const size_t allocations = numAllocations - allocationsBefore;
+
+  printf("packets in:          %zu\n", numPackets);
+  printf("packets to host:     %zu\n", endpoint.numSentPackets);
+  printf("packets to DIN:      %zu (%zu dropped)\n", numDINPackets, numDINDropped);
+  printf("time:                %.3f s\n", seconds);
+  printf("packets / second:    %.0f\n", seconds > 0 ? numPackets / seconds : 0.0);
+  printf("heap allocations:    %zu (%zu bytes)\n", allocations, size_t(numAllocatedBytes - bytesBefore));
+  printf("allocations / 1000:  %.2f\n", numPackets ? 1000.0 * allocations / numPackets : 0.0);
+  dump_delay_stats("DIN", DINPortSendBuffers[0]);
+
+  return 0;
+}
@@ -2,62 +2,306 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 //-----------------------------------------------
 
 TEST(UMPRingBuffer, basics)
 {
   UMPRingBuffer<16> b;
 
-  uint16_t readPtr = 0;
+  UMPReadPtr readPtr;
   EXPECT_FALSE(b.itemsAvail(readPtr));
 
-  uint32_t word;
-  EXPECT_FALSE(b.read(readPtr, word));
+  midi::universal_packet p;
+  EXPECT_FALSE(b.read(readPtr, p));
 
-  b.write(0x20901234);
-  EXPECT_TRUE(b.read(readPtr, word));
-  EXPECT_EQ(0x20901234, word);
-  EXPECT_EQ(1u, readPtr);
+  b.write(midi::universal_packet{ 0x20901234 });
+  EXPECT_TRUE(b.itemsAvail(readPtr));
+  EXPECT_TRUE(b.read(readPtr, p));
+  EXPECT_EQ(0x20901234, p.data[0]);
+  EXPECT_EQ(1u, readPtr.pos);
 
-  EXPECT_FALSE(b.read(readPtr, word));
-  EXPECT_EQ(0x20901234, word);
-  EXPECT_EQ(1u, readPtr);
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_EQ(0x20901234, p.data[0]);
+  EXPECT_EQ(1u, readPtr.pos);
 
-  b.write(0x10F10000);
-  b.write(0x30041122);
-  b.write(0x33445566);
+  b.write(midi::universal_packet{ 0x10F10000 });
+  b.write(midi::universal_packet{ 0x40901234, 0x12345678 });
+  b.write(midi::universal_packet{ 0x30041122, 0x33445566 });
 
-  EXPECT_TRUE(b.read(readPtr, word));
-  EXPECT_EQ(0x10F10000, word);
-  EXPECT_EQ(2u, readPtr);
+  EXPECT_TRUE(b.read(readPtr, p));
+  EXPECT_EQ(0x10F10000, p.data[0]);
+  EXPECT_EQ(2u, readPtr.pos);
 
-  EXPECT_TRUE(b.read(readPtr, word));
-  EXPECT_EQ(0x30041122, word);
-  EXPECT_EQ(3u, readPtr);
+  EXPECT_TRUE(b.read(readPtr, p));
+  EXPECT_EQ(0x40901234, p.data[0]);
+  EXPECT_EQ(0x12345678, p.data[1]);
+  EXPECT_EQ(4u, readPtr.pos);
 
-  EXPECT_TRUE(b.read(readPtr, word));
-  EXPECT_EQ(0x33445566, word);
-  EXPECT_EQ(4u, readPtr);
+  EXPECT_TRUE(b.read(readPtr, p));
+  EXPECT_EQ(0x30041122, p.data[0]);
+  EXPECT_EQ(0x33445566, p.data[1]);
+  EXPECT_EQ(0u, p.data[2]);
+  EXPECT_EQ(6u, readPtr.pos);
+  EXPECT_EQ(4u, readPtr.count);
 
-  EXPECT_FALSE(b.read(readPtr, word));
-  EXPECT_FALSE(b.read(readPtr, word));
-  EXPECT_FALSE(b.read(readPtr, word));
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_EQ(0u, readPtr.dropped);
 }
 
 TEST(UMPRingBuffer, wrap_around)
 {
   UMPRingBuffer<128> b;
 
-  uint16_t readPtr = 0;
+  UMPReadPtr readPtr;
   EXPECT_FALSE(b.itemsAvail(readPtr));
 
-  uint32_t word;
+  midi::universal_packet p;
   for (unsigned i=0; i<1000; ++i)
   {
-    b.write(1000+i);
+    b.write(midi::universal_packet{ 0x10000000 + i });
+
+    EXPECT_TRUE(b.read(readPtr, p));
+    EXPECT_EQ(0x10000000 + i, p.data[0]);
+    EXPECT_EQ(uint16_t(i+1), readPtr.pos);
+  }
+  EXPECT_EQ(0u, readPtr.dropped);
+}
+
+TEST(UMPRingBuffer, variable_length_wrap_around)
+{
+  UMPRingBuffer<16> b;
+
+  UMPReadPtr readPtr;
+  midi::universal_packet p;
+  for (uint32_t i=0; i<1000; ++i)
+  {
+    const auto in = (i % 3 == 0) ? midi::universal_packet{ 0xF0000000 + i, 1, 2, 3 }
+                  : (i % 3 == 1) ? midi::universal_packet{ 0x40000000 + i, ~i }
+                  : midi::universal_packet{ 0x20000000 + i };
+    b.write(in);
+
+    EXPECT_TRUE(b.read(readPtr, p));
+    EXPECT_EQ(in, p);
+  }
+  EXPECT_FALSE(b.itemsAvail(readPtr));
+  EXPECT_EQ(0u, readPtr.dropped);
+}
+
+TEST(UMPRingBuffer, packed_storage)
+{
+  UMPRingBuffer<16> b;
+
+  // 12 one word packets fit where only 3 full size packets would
+  UMPReadPtr readPtr;
+  for (unsigned i=0; i<12; ++i)
+    b.write(midi::universal_packet{ 0x20000000 + i });
+
+  midi::universal_packet p;
+  for (unsigned i=0; i<12; ++i)
+  {
+    EXPECT_TRUE(b.read(readPtr, p));
+    EXPECT_EQ(0x20000000 + i, p.data[0]);
+  }
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_EQ(0u, readPtr.dropped);
+}
+
+TEST(UMPRingBuffer, overrun)
+{
+  UMPRingBuffer<16> b;
+
+  UMPReadPtr readPtr;
+  for (unsigned i=0; i<40; ++i)
+    b.write(midi::universal_packet{ 0x10000000 + i });
+
+  // a lapped reader restarts at the write position
+  midi::universal_packet p;
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_EQ(40u, readPtr.dropped);
+
+  b.write(midi::universal_packet{ 0x10000000 + 40 });
+  EXPECT_TRUE(b.read(readPtr, p));
+  EXPECT_EQ(0x10000000 + 40, p.data[0]);
+  EXPECT_FALSE(b.read(readPtr, p));
+  EXPECT_EQ(40u, readPtr.dropped);
+}
+
+TEST(UMPRingBuffer, independent_readers)
+{
+  UMPRingBuffer<16> b;
+
+  UMPReadPtr fast, slow;
+  midi::universal_packet p;
+  for (unsigned i=0; i<20; ++i)
+  {
+    b.write(midi::universal_packet{ 0x10000000 + i });
+    EXPECT_TRUE(b.read(fast, p));
+  }
+
+  EXPECT_FALSE(b.read(slow, p));
+  EXPECT_EQ(20u, slow.dropped);
+  EXPECT_EQ(0u, fast.dropped);
+
+  b.resetReadPtr(slow);
+  EXPECT_FALSE(b.itemsAvail(slow));
+  EXPECT_EQ(0u, slow.dropped);
+}
+
+TEST(UMPRingBuffer, multi_producer)
+{
+  constexpr unsigned numWriters = 4;
+  constexpr unsigned numPackets = 10000;
 
-    EXPECT_TRUE(b.read(readPtr, word));
-    EXPECT_EQ(1000+i, word);
-    EXPECT_EQ((i+1) % 128, readPtr);
+  UMPRingBuffer<1024, true> b;
+
+  std::atomic<unsigned> numDone { 0 };
+  std::vector<std::thread> writers;
+  for (unsigned w=0; w<numWriters; ++w)
+    writers.emplace_back([&b, &numDone, w]() {
+      for (uint32_t i=0; i<numPackets; ++i)
+        b.write(midi::universal_packet{ 0x40000000 | (w << 24) | i, ~i });
+      ++numDone;
+    });
+
+  UMPReadPtr readPtr;
+  std::vector<uint32_t> next(numWriters, 0);
+  unsigned received = 0;
+
+  midi::universal_packet p;
+  bool done = false;
+  while (!done)
+  {
+    done = (numDone == numWriters);
+    while (b.read(readPtr, p))
+    {
+      const unsigned w = (p.data[0] >> 24) & 0x0F;
+      const uint32_t i = p.data[0] & 0x00FFFFFF;
+      ASSERT_LT(w, numWriters);
+      EXPECT_EQ(~i, p.data[1]); // never torn
+      EXPECT_GE(i, next[w]);    // per writer order is kept
+      next[w] = i + 1;
+      ++received;
+    }
   }
+
+  for (auto &t : writers)
+    t.join();
+
+  EXPECT_EQ(numWriters * numPackets, received + readPtr.dropped);
+}
+
+TEST(UMPRingBuffer, read_batch)
+{
+  UMPRingBuffer<16> b;
+
+  UMPReadPtr readPtr;
+  uint32_t words[8];
+  EXPECT_EQ(0u, b.readBatch(readPtr, words, 8));
+
+  b.write(midi::universal_packet{ 0x20901234 });
+  b.write(midi::universal_packet{ 0x40901234, 0x12345678 });
+  b.write(midi::universal_packet{ 0xF0000000, 1, 2, 3 });
+
+  // only complete packets are copied
+  EXPECT_EQ(3u, b.readBatch(readPtr, words, 6));
+  EXPECT_EQ(0x20901234, words[0]);
+  EXPECT_EQ(0x40901234, words[1]);
+  EXPECT_EQ(0x12345678, words[2]);
+  EXPECT_EQ(2u, readPtr.count);
+
+  EXPECT_EQ(4u, b.readBatch(readPtr, words, 8));
+  EXPECT_EQ(0xF0000000, words[0]);
+  EXPECT_EQ(3u, words[3]);
+
+  // packets do not straddle the end of the buffer
+  b.write(midi::universal_packet{ 0x20901235 });
+  b.write(midi::universal_packet{ 0xF0000001, 4, 5, 6 });
+  b.write(midi::universal_packet{ 0x40901235, 7 });
+  EXPECT_EQ(7u, b.readBatch(readPtr, words, 8));
+  EXPECT_EQ(0x20901235, words[0]);
+  EXPECT_EQ(0xF0000001, words[1]);
+  EXPECT_EQ(7u, words[6]);
+  b.write(midi::universal_packet{ 0xF0000002, 8, 9, 10 });
+  EXPECT_EQ(4u, b.readBatch(readPtr, words, 8));
+  EXPECT_EQ(0xF0000002, words[0]);
+  EXPECT_EQ(10u, words[3]);
+  EXPECT_EQ(7u, readPtr.count);
+  EXPECT_EQ(20u, readPtr.pos);
+  EXPECT_FALSE(b.itemsAvail(readPtr));
+}
+
+TEST(UMPRingBuffer, peek_span)
+{
+  UMPRingBuffer<16> b;
+
+  UMPReadPtr readPtr;
+  auto span = b.peekSpan(readPtr);
+  EXPECT_EQ(0u, span.numWords);
+
+  for (uint32_t i=0; i<6; ++i)
+    b.write(midi::universal_packet{ 0x40900000 + i, i });
+
+  span = b.peekSpan(readPtr);
+  EXPECT_EQ(12u, span.numWords);
+  EXPECT_EQ(6u, span.numPackets);
+  EXPECT_EQ(0x40900000, span.words[0]);
+  EXPECT_EQ(5u, span.words[11]);
+
+  // limited number of packets
+  auto limited = b.peekSpan(readPtr, 4);
+  EXPECT_EQ(8u, limited.numWords);
+  EXPECT_EQ(4u, limited.numPackets);
+  EXPECT_TRUE(b.commit(readPtr, span));
+
+  // wrap: span ends at the buffer end, padding is skipped
+  b.write(midi::universal_packet{ 0x20901234 });
+  b.write(midi::universal_packet{ 0xF0000000, 1, 2, 3 });
+
+  span = b.peekSpan(readPtr);
+  EXPECT_EQ(1u, span.numWords);
+  EXPECT_EQ(0x20901234, span.words[0]);
+  EXPECT_TRUE(b.commit(readPtr, span));
+
+  span = b.peekSpan(readPtr);
+  EXPECT_EQ(4u, span.numWords);
+  EXPECT_EQ(1u, span.numPackets);
+  EXPECT_EQ(0xF0000000, span.words[0]);
+  EXPECT_TRUE(b.commit(readPtr, span));
+
+  EXPECT_FALSE(b.itemsAvail(readPtr));
+  EXPECT_EQ(8u, readPtr.count);
+
+  // overwritten while in use
+  b.write(midi::universal_packet{ 0x20901234 });
+  span = b.peekSpan(readPtr);
+  for (uint32_t i=0; i<16; ++i)
+    b.write(midi::universal_packet{ 0x20000000 + i });
+  EXPECT_FALSE(b.commit(readPtr, span));
+  EXPECT_EQ(17u, readPtr.dropped);
+  EXPECT_FALSE(b.itemsAvail(readPtr));
+}
+
+TEST(UMPRingBuffer, reader_notification)
+{
+  UMPRingBuffer<16> b;
+
+  unsigned numNotified[5] { 0 };
+  auto notify = [](void *reader) { ++*static_cast<unsigned*>(reader); };
+
+  for (unsigned r=0; r<4; ++r)
+    EXPECT_TRUE(b.addReader(notify, &numNotified[r]));
+  EXPECT_FALSE(b.addReader(notify, &numNotified[4]));
+
+  b.write(midi::universal_packet{ 0x20901234 });
+  b.write(midi::universal_packet{ 0x40901234, 0x12345678 });
+  b.write(midi::universal_packet{ 0 }); // NOOPs are not stored
+
+  for (unsigned r=0; r<4; ++r)
+    EXPECT_EQ(2u, numNotified[r]);
+  EXPECT_EQ(0u, numNotified[4]);
 }
@@ -0,0 +1,110 @@
+#include "../UMPRouter.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+//-----------------------------------------------
+
+static std::vector<midi::universal_packet> dinSent;
+static std::vector<midi::universal_packet> widiSent;
+
+static void defaultRoutes(UMPRouter &router)
+{
+  router.setSink(UMPRouter::DINPortDestination, [](const midi::universal_packet &p) { dinSent.push_back(p); });
+  router.setSink(UMPRouter::CMEWidiDestination, [](const midi::universal_packet &p) { widiSent.push_back(p); });
+
+  router.setRoute(0, UMPRouter::MainDestination, UMPRouter::allMessageTypes);
+  router.setRoute(1, UMPRouter::DINPortDestination, UMPRouter::allMessageTypes, UMPRouter::Translation::MIDI1);
+  router.setRoute(4, UMPRouter::DINPortDestination, UMPRouter::allMessageTypes, UMPRouter::Translation::MIDI1);
+  router.setRoute(2, UMPRouter::CMEWidiDestination, UMPRouter::allMessageTypes, UMPRouter::Translation::MIDI1);
+}
+
+class UMPRouterTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    dinSent.clear();
+    widiSent.clear();
+  }
+
+  UMPRouter router { defaultRoutes };
+};
+
+//-----------------------------------------------
+
+TEST_F(UMPRouterTest, default_routes)
+{
+  EXPECT_TRUE(router.route(midi::universal_packet{ 0x20903C64 }));
+  EXPECT_TRUE(dinSent.empty());
+  EXPECT_TRUE(widiSent.empty());
+
+  // MIDI 2.0 channel voice reaches the byte stream ports as MIDI 1.0
+  EXPECT_FALSE(router.route(midi::universal_packet{ 0x41903C00, 0x80000000 }));
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x21903C40 } }), dinSent);
+  EXPECT_TRUE(widiSent.empty());
+
+  EXPECT_EQ(UMPRouter::allMessageTypes, router.messageTypes(1, UMPRouter::DINPortDestination));
+  EXPECT_EQ(UMPRouter::Translation::MIDI1, router.translation(1, UMPRouter::DINPortDestination));
+  EXPECT_EQ(0u, router.messageTypes(1, UMPRouter::CMEWidiDestination));
+}
+
+TEST_F(UMPRouterTest, per_group_sinks)
+{
+  router.route(midi::universal_packet{ 0x21903C64 });
+  router.route(midi::universal_packet{ 0x24803C00 });
+  router.route(midi::universal_packet{ 0x22B00700 });
+  EXPECT_FALSE(router.route(midi::universal_packet{ 0x25903C64 }));
+
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x21903C64 }, midi::universal_packet{ 0x24803C00 } }), dinSent);
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x22B00700 } }), widiSent);
+
+  // fan-out, messages of one type only
+  router.setRoute(1, UMPRouter::CMEWidiDestination, UMPRouter::messageTypeBit(midi::packet_type::system));
+  dinSent.clear();
+  widiSent.clear();
+  router.route(midi::universal_packet{ 0x11F80000 });
+  router.route(midi::universal_packet{ 0x21903C64 });
+  EXPECT_EQ(2u, dinSent.size());
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x11F80000 } }), widiSent);
+}
+
+TEST_F(UMPRouterTest, reset)
+{
+  router.clear();
+  EXPECT_FALSE(router.route(midi::universal_packet{ 0x20903C64 }));
+  router.route(midi::universal_packet{ 0x21903C64 });
+  EXPECT_TRUE(dinSent.empty());
+
+  // the default sinks come back together with the routes
+  router.setSink(UMPRouter::DINPortDestination, nullptr);
+  router.reset();
+  EXPECT_TRUE(router.route(midi::universal_packet{ 0x20903C64 }));
+  router.route(midi::universal_packet{ 0x21903C64 });
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x21903C64 } }), dinSent);
+}
+
+TEST_F(UMPRouterTest, config_messages)
+{
+  uint8_t reply[UMPRouter::maxConfigReplySize];
+
+  // route system messages of group 3 to Widi, untranslated
+  const uint8_t setRoute[] = { UMPRouter::configSetRoute, 3, UMPRouter::CMEWidiDestination, 0, 0x02, 0, 0 };
+  EXPECT_EQ(0, router.processConfigMessage(setRoute, sizeof(setRoute), reply));
+  router.route(midi::universal_packet{ 0x13F80000 });
+  router.route(midi::universal_packet{ 0x23903C64 });
+  EXPECT_EQ((std::vector<midi::universal_packet>{ midi::universal_packet{ 0x13F80000 } }), widiSent);
+
+  const uint8_t getRoute[] = { UMPRouter::configGetRoute, 1, UMPRouter::DINPortDestination };
+  ASSERT_EQ(7, router.processConfigMessage(getRoute, sizeof(getRoute), reply));
+  EXPECT_EQ((std::vector<uint8_t>{ UMPRouter::configRouteReply, 1, UMPRouter::DINPortDestination, 1, 0x7F, 0x7F, 0x03 }),
+            std::vector<uint8_t>(reply, reply + 7));
+
+  const uint8_t reset[] = { UMPRouter::configReset };
+  EXPECT_EQ(0, router.processConfigMessage(reset, sizeof(reset), reply));
+  EXPECT_EQ(0u, router.messageTypes(3, UMPRouter::CMEWidiDestination));
+
+  const uint8_t invalid[] = { UMPRouter::configSetRoute, 16, UMPRouter::CMEWidiDestination, 0, 0x02, 0, 0 };
+  EXPECT_EQ(-1, router.processConfigMessage(invalid, sizeof(invalid), reply));
+}
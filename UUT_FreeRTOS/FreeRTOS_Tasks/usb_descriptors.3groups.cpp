@@ -114,6 +114,9 @@ enum StringDescrIDs
   MainStrID         = 0x06,
   ExtInStrID        = 0x07,
   ExtOutStrID       = 0x08,
+  DIN2StrID         = 0x09,
+  DIN3StrID         = 0x0A,
+  DIN4StrID         = 0x0B,
 };
 
 enum MIDI1JackIDs
@@ -133,15 +136,21 @@ enum MIDI2GrpTrmIDs
   MIDI2GrpTrmMain   = 0x01,
   MIDI2GrpTrmExtIn  = 0x02,
   MIDI2GrpTrmExtOut = 0x03,
+  MIDI2GrpTrmDIN2   = 0x04,
+  MIDI2GrpTrmDIN3   = 0x05,
+  MIDI2GrpTrmDIN4   = 0x06,
 };
 
+// one bidirectional group terminal block per additional DIN port, see Groups.h
+constexpr uint8_t numExtraDINPorts = PROTOZOA_DIN_PORTS - 1;
+
 // full speed configuration
 uint8_t const desc_fs_configuration[] =
 {
     // ----- Configuration Descriptor
     0x09,                   // (  9) bLength
     0x02,                   // (  2) bDescriptorType
-    245, //179+(CFG_TUD_CDC * TUD_CDC_DESC_LEN), // (179 + CDC) wTotalLengthLSB
+    245 + 2 * numExtraDINPorts, //179+(CFG_TUD_CDC * TUD_CDC_DESC_LEN), // (179 + CDC) wTotalLengthLSB
     0x00,                   // (  0) wTotalLengthMSB
     ITF_NUM_TOTAL,          // (  4) bNumInterfaces
     0x01,                   // (  1) bConfigurationValue
@@ -343,12 +352,21 @@ uint8_t const desc_fs_configuration[] =
     0x00,                   // (  0) bInterval
 
     // ----- Audio MS Descriptor - CS Endpoint - MS General 2.0
-    0x06,                   // (  6) bLength
+    0x06 + numExtraDINPorts, // (  6) bLength
     0x25,                   // ( 37) bDescriptorType
     0x02,                   // (  2) bDescriptorSubtype
-    0x02,                   // (  2) bNumGrpTrmBlock
+    0x02 + numExtraDINPorts, // (  2) bNumGrpTrmBlock
     MIDI2GrpTrmMain,        // (  1) baAssoGrpTrmBlkID #1 - ProtoZOA Main
     MIDI2GrpTrmExtOut,      // (  3) baAssoGrpTrmBlkID #2 - ProtoZOA Ext OUT
+#if PROTOZOA_DIN_PORTS >= 2
+    MIDI2GrpTrmDIN2,        // (  4) baAssoGrpTrmBlkID #3 - ProtoZOA DIN 2
+#endif
+#if PROTOZOA_DIN_PORTS >= 3
+    MIDI2GrpTrmDIN3,        // (  5) baAssoGrpTrmBlkID #4 - ProtoZOA DIN 3
+#endif
+#if PROTOZOA_DIN_PORTS >= 4
+    MIDI2GrpTrmDIN4,        // (  6) baAssoGrpTrmBlkID #5 - ProtoZOA DIN 4
+#endif
 
     // ----- EP Descriptor - Endpoint - MIDI IN
     0x07,                   // (  7) bLength
@@ -360,15 +378,25 @@ uint8_t const desc_fs_configuration[] =
     0x00,                   // (  0) bInterval
 
     // ----- Audio MS Descriptor - CS Endpoint - MS General 2.0
-    0x06,                   // (  6) bLength
+    0x06 + numExtraDINPorts, // (  6) bLength
     0x25,                   // ( 37) bDescriptorType
     0x02,                   // (  2) bDescriptorSubtype
-    0x02,                   // (  2) bNumGrpTrmBlock
+    0x02 + numExtraDINPorts, // (  2) bNumGrpTrmBlock
     MIDI2GrpTrmMain,        // (  1) baAssoGrpTrmBlkID #1 - ProtoZOA Main
     MIDI2GrpTrmExtIn,       // (  2) baAssoGrpTrmBlkID #2 - ProtoZOA Ext IN
+#if PROTOZOA_DIN_PORTS >= 2
+    MIDI2GrpTrmDIN2,        // (  4) baAssoGrpTrmBlkID #3 - ProtoZOA DIN 2
+#endif
+#if PROTOZOA_DIN_PORTS >= 3
+    MIDI2GrpTrmDIN3,        // (  5) baAssoGrpTrmBlkID #4 - ProtoZOA DIN 3
+#endif
+#if PROTOZOA_DIN_PORTS >= 4
+    MIDI2GrpTrmDIN4,        // (  6) baAssoGrpTrmBlkID #5 - ProtoZOA DIN 4
+#endif
 };
 
 constexpr unsigned cgfsize = sizeof(desc_fs_configuration);
+static_assert(cgfsize == 245 + 2 * numExtraDINPorts, "wTotalLength does not match the configuration descriptor");
 
 // device qualifier is mostly similar to device descriptor since we don't change configuration based on speed
 tusb_desc_device_qualifier_t const desc_device_qualifier =
@@ -435,6 +463,9 @@ uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
                     "ProtoZOA Main",               // 6: MIDI Main
                     "ProtoZOA Ext IN",             // 7: EXT MIDI IN Jack
                     "ProtoZOA Ext OUT",            // 8: EXT MIDI OUT Jack
+                    "ProtoZOA DIN 2",              // 9: additional DIN ports
+                    "ProtoZOA DIN 3",              // 10
+                    "ProtoZOA DIN 4",              // 11
             };
 
   uint8_t chr_count;
@@ -479,7 +510,7 @@ constexpr uint8_t default_protocol =
 0x01; // MIDI 1.0, Support UMP up to 64 bits in size
 //0x02; // MIDI 2.0
 
-static midi2_cs_interface_desc_group_terminal_blocks_n_t(3) group_terminal_blocks_descr =
+static midi2_cs_interface_desc_group_terminal_blocks_n_t(3 + numExtraDINPorts) group_terminal_blocks_descr =
 {
   .header = {
     .bLength             = 5,
@@ -529,7 +560,55 @@ static midi2_cs_interface_desc_group_terminal_blocks_n_t(3) group_terminal_block
       .bMIDIProtocol       = 0x01,   // MIDI 1.0, Support UMP up to 64 bits in size
       .wMaxInputBandwidth  = 0x0001, // 31.25kb/s
       .wMaxOutputBandwidth = 0x0000  // Unknown or Not Fixed
-    }
+    },
+#if PROTOZOA_DIN_PORTS >= 2
+    // 5-PIN DIN Port 2 Function Block
+    {
+      .bLength             = 13,
+      .bDescriptorType     = MIDI_CS_INTERFACE_GR_TRM_BLOCK,
+      .bDescriptorSubType  = MIDI_GR_TRM_BLOCK,
+      .bGrpTrmBlkID        = MIDI2GrpTrmDIN2,
+      .bGrpTrmBlkType      = 0x00,   // bi-directional
+      .nGroupTrm           = DINPort2Group,
+      .nNumGroupTrm        = 1,
+      .iBlockItem          = DIN2StrID,// ProtoZOA DIN 2
+      .bMIDIProtocol       = 0x01,   // MIDI 1.0, Support UMP up to 64 bits in size
+      .wMaxInputBandwidth  = 0x0001, // 31.25kb/s
+      .wMaxOutputBandwidth = 0x0001  // 31.25kb/s
+    },
+#endif
+#if PROTOZOA_DIN_PORTS >= 3
+    // 5-PIN DIN Port 3 Function Block
+    {
+      .bLength             = 13,
+      .bDescriptorType     = MIDI_CS_INTERFACE_GR_TRM_BLOCK,
+      .bDescriptorSubType  = MIDI_GR_TRM_BLOCK,
+      .bGrpTrmBlkID        = MIDI2GrpTrmDIN3,
+      .bGrpTrmBlkType      = 0x00,   // bi-directional
+      .nGroupTrm           = DINPort3Group,
+      .nNumGroupTrm        = 1,
+      .iBlockItem          = DIN3StrID,// ProtoZOA DIN 3
+      .bMIDIProtocol       = 0x01,   // MIDI 1.0, Support UMP up to 64 bits in size
+      .wMaxInputBandwidth  = 0x0001, // 31.25kb/s
+      .wMaxOutputBandwidth = 0x0001  // 31.25kb/s
+    },
+#endif
+#if PROTOZOA_DIN_PORTS >= 4
+    // 5-PIN DIN Port 4 Function Block
+    {
+      .bLength             = 13,
+      .bDescriptorType     = MIDI_CS_INTERFACE_GR_TRM_BLOCK,
+      .bDescriptorSubType  = MIDI_GR_TRM_BLOCK,
+      .bGrpTrmBlkID        = MIDI2GrpTrmDIN4,
+      .bGrpTrmBlkType      = 0x00,   // bi-directional
+      .nGroupTrm           = DINPort4Group,
+      .nNumGroupTrm        = 1,
+      .iBlockItem          = DIN4StrID,// ProtoZOA DIN 4
+      .bMIDIProtocol       = 0x01,   // MIDI 1.0, Support UMP up to 64 bits in size
+      .wMaxInputBandwidth  = 0x0001, // 31.25kb/s
+      .wMaxOutputBandwidth = 0x0001  // 31.25kb/s
+    },
+#endif
   }
 };
 